@@ -0,0 +1,270 @@
+/* bench_support.cpp
+ *
+ * SPDX-FileCopyrightText: 2025  Andrew C. Starritt
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "bench_support.h"
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#define nl        '\n'
+
+//------------------------------------------------------------------------------
+//
+uint64_t benchNow ()
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return uint64_t (ts.tv_sec) * 1000000000u + uint64_t (ts.tv_nsec);
+}
+
+//==============================================================================
+// BenchNullStream
+//==============================================================================
+//
+int BenchNullStream::NullBuffer::overflow (int c)
+{
+   return c;
+}
+
+//------------------------------------------------------------------------------
+//
+std::streamsize BenchNullStream::NullBuffer::xsputn (const char*, std::streamsize n)
+{
+   return n;
+}
+
+//------------------------------------------------------------------------------
+//
+BenchNullStream::BenchNullStream () : std::ostream (&m_buffer) { }
+
+//------------------------------------------------------------------------------
+//
+BenchNullStream::~BenchNullStream () { }
+
+
+//==============================================================================
+// BenchRunner
+//==============================================================================
+//
+BenchRunner::BenchRunner (const std::string& suite, const double minSeconds) :
+   m_suite (suite),
+   m_minSeconds (minSeconds)
+{ }
+
+//------------------------------------------------------------------------------
+//
+BenchRunner::~BenchRunner () { }
+
+//------------------------------------------------------------------------------
+//
+BenchResult& BenchRunner::add (const std::string& name,
+                               const std::string& variant,
+                               const long specSize,
+                               const long argvSize,
+                               const uint64_t iterations,
+                               const uint64_t totalNs)
+{
+   BenchResult result;
+   result.name = name;
+   result.variant = variant;
+   result.specSize = specSize;
+   result.argvSize = argvSize;
+   result.iterations = iterations;
+   result.totalNs = totalNs;
+   result.nsPerOp = iterations > 0 ? double (totalNs) / double (iterations) : 0.0;
+
+   this->m_results.push_back (result);
+   return this->m_results.back ();
+}
+
+//------------------------------------------------------------------------------
+//
+const std::vector<BenchResult>& BenchRunner::results () const
+{
+   return this->m_results;
+}
+
+//------------------------------------------------------------------------------
+//
+void BenchRunner::report (std::ostream& os, const BenchResult& result) const
+{
+   std::string sizes = "";
+   if (result.specSize >= 0) sizes += " spec=" + std::to_string (result.specSize);
+   if (result.argvSize >= 0) sizes += " argv=" + std::to_string (result.argvSize);
+
+   os << std::left << std::setw (16) << result.name
+      << std::setw (14) << result.variant
+      << std::setw (26) << sizes
+      << std::right << std::setw (16) << std::fixed << std::setprecision (1)
+      << result.nsPerOp << " ns/op"
+      << std::setw (12) << result.iterations << " iters";
+
+   for (auto item : result.extra) {
+      os << "  " << item.first << "=" << item.second;
+   }
+   os << nl;
+   os.unsetf (std::ios_base::floatfield);
+}
+
+//------------------------------------------------------------------------------
+//
+std::string benchJsonEscape (const std::string& str)
+{
+   std::string result;
+   result.reserve (str.size ());
+   for (char c : str) {
+      switch (c) {
+         case '"':  result += "\\\""; break;
+         case '\\': result += "\\\\"; break;
+         case '\n': result += "\\n";  break;
+         case '\t': result += "\\t";  break;
+         default:
+            if ((unsigned char) c < 0x20) {
+               char buffer [8];
+               snprintf (buffer, sizeof (buffer), "\\u%04x", (unsigned char) c);
+               result += buffer;
+            } else {
+               result += c;
+            }
+            break;
+      }
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+std::ostream& BenchRunner::writeJson (std::ostream& os) const
+{
+   const time_t now = time (nullptr);
+   char stamp [40];
+   strftime (stamp, sizeof (stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime (&now));
+
+   os << "{" << nl;
+   os << "  \"suite\": \"" << benchJsonEscape (this->m_suite) << "\"," << nl;
+   os << "  \"parsley_version\": \"" << PARSLEY_VERSION_STRING << "\"," << nl;
+   os << "  \"timestamp\": \"" << stamp << "\"," << nl;
+   os << "  \"min_seconds\": " << this->m_minSeconds << "," << nl;
+   os << "  \"results\": [" << nl;
+
+   bool first = true;
+   for (const BenchResult& r : this->m_results) {
+      if (!first) os << "," << nl;
+      first = false;
+
+      os << "    { \"name\": \"" << benchJsonEscape (r.name) << "\""
+         << ", \"variant\": \"" << benchJsonEscape (r.variant) << "\"";
+      if (r.specSize >= 0) os << ", \"spec_size\": " << r.specSize;
+      if (r.argvSize >= 0) os << ", \"argv_size\": " << r.argvSize;
+      os << ", \"iterations\": " << r.iterations
+         << ", \"total_ns\": " << r.totalNs
+         << ", \"ns_per_op\": " << std::fixed << std::setprecision (2) << r.nsPerOp;
+      os.unsetf (std::ios_base::floatfield);
+      for (auto item : r.extra) {
+         os << ", \"" << benchJsonEscape (item.first) << "\": " << item.second;
+      }
+      os << " }";
+   }
+
+   os << nl << "  ]" << nl;
+   os << "}" << nl;
+   return os;
+}
+
+//------------------------------------------------------------------------------
+//
+bool BenchRunner::writeJson (const std::string& filename) const
+{
+   std::ofstream file (filename);
+   if (!file) return false;
+   this->writeJson (file);
+   return bool (file);
+}
+
+
+//==============================================================================
+// Workloads
+//==============================================================================
+//
+static const Parsley::EnumOptions benchColours = { "red", "green", "blue" };
+
+//------------------------------------------------------------------------------
+//
+std::string benchOptionName (const long j)
+{
+   char buffer [40];
+   snprintf (buffer, sizeof (buffer), "option-%ld", j);
+   return std::string (buffer);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecifications benchMakeSpecs (const long specSize)
+{
+   Parsley::OptionSpecifications result;
+
+   for (long j = 0; j < specSize; j++) {
+      const std::string name = benchOptionName (j);
+      const char shortName = j < 26 ? char ('a' + j) : '\0';
+      const std::string description =
+            "The synthetic " + name + " option, used for benchmarking only.";
+
+      switch (j % 5) {
+         case 0:
+            result.push_back (Parsley::flagSpec (name, shortName, description));
+            break;
+         case 1:
+            result.push_back (Parsley::strSpec (name, shortName, description)->defStr ("none"));
+            break;
+         case 2:
+            result.push_back (Parsley::enumSpec (name, shortName, description, benchColours)->defStr ("red"));
+            break;
+         case 3:
+            result.push_back (Parsley::intSpec (name, shortName, description)->intRange (-1000000000, 1000000000));
+            break;
+         default:
+            result.push_back (Parsley::realSpec (name, shortName, description)->defReal (1.5));
+            break;
+      }
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Arguments benchMakeArguments (const long specSize,
+                                       const long argvSize)
+{
+   Parsley::Arguments result;
+   result.reserve (argvSize);
+   if (argvSize <= 0) return result;
+
+   result.push_back ("bench_program");
+
+   long j = 0;
+   while ((j < specSize) && (long (result.size ()) + 2 <= argvSize)) {
+      result.push_back ("--" + benchOptionName (j));
+      switch (j % 5) {
+         case 0: break;
+         case 1: result.push_back ("value-" + std::to_string (j)); break;
+         case 2: result.push_back ("green"); break;
+         case 3: result.push_back (std::to_string (j)); break;
+         default: result.push_back (std::to_string (j) + ".25"); break;
+      }
+      j++;
+   }
+
+   long k = 0;
+   while (long (result.size ()) < argvSize) {
+      result.push_back ("parameter-" + std::to_string (k++));
+   }
+
+   return result;
+}
+
+// end
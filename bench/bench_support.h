@@ -0,0 +1,149 @@
+/* bench_support.h
+ *
+ * Description:
+ * Small, self-contained timing and reporting support used by the parsley
+ * benchmark programs. No third party dependencies.
+ *
+ * SPDX-FileCopyrightText: 2025  Andrew C. Starritt
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#ifndef BENCH_SUPPORT_H
+#define BENCH_SUPPORT_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <parsley.h>
+
+//------------------------------------------------------------------------------
+// Monotonic clock, nano-seconds.
+//
+uint64_t benchNow ();
+
+//------------------------------------------------------------------------------
+// Prevents the optimiser discarding a result.
+//
+template <typename T>
+inline void benchKeep (const T& value)
+{
+   asm volatile ("" : : "g" (&value) : "memory");
+}
+
+//------------------------------------------------------------------------------
+// An output stream that discards everything - used to time formatting
+// without also timing the growth of a string buffer.
+//
+class BenchNullStream : public std::ostream {
+public:
+   explicit BenchNullStream ();
+   ~BenchNullStream ();
+
+private:
+   class NullBuffer : public std::streambuf {
+   protected:
+      int overflow (int c);
+      std::streamsize xsputn (const char* s, std::streamsize n);
+   };
+   NullBuffer m_buffer;
+};
+
+//------------------------------------------------------------------------------
+// One benchmark measurement.
+//
+struct BenchResult {
+   std::string name;       // e.g. "process"
+   std::string variant;    // e.g. "parsley" or "getopt_long"
+   long specSize;          // -1 when not applicable
+   long argvSize;          // -1 when not applicable
+   uint64_t iterations;
+   uint64_t totalNs;
+   double nsPerOp;
+   std::vector<std::pair<std::string, double> > extra;   // additional metrics
+};
+
+//------------------------------------------------------------------------------
+// Runs and collects benchmark measurements, and writes them as JSON.
+//
+class BenchRunner {
+public:
+   explicit BenchRunner (const std::string& suite, const double minSeconds);
+   ~BenchRunner ();
+
+   // Runs the given operation repeatedly until at least minSeconds have elapsed
+   // (and at least once). The operation returns nothing, and should call
+   // benchKeep on anything it computes.
+   //
+   template <typename Operation>
+   BenchResult& run (const std::string& name,
+                     const std::string& variant,
+                     const long specSize,
+                     const long argvSize,
+                     Operation operation)
+   {
+      const uint64_t minNs = uint64_t (this->m_minSeconds * 1.0e9);
+      uint64_t iterations = 0;
+      uint64_t batch = 1;
+      const uint64_t start = benchNow ();
+      uint64_t elapsed = 0;
+      while (true) {
+         for (uint64_t j = 0; j < batch; j++) operation ();
+         iterations += batch;
+         elapsed = benchNow () - start;
+         if (elapsed >= minNs) break;
+         if (batch < (uint64_t (1) << 20)) batch *= 2;
+      }
+      return this->add (name, variant, specSize, argvSize, iterations, elapsed);
+   }
+
+   // Adds an externally measured result.
+   //
+   BenchResult& add (const std::string& name,
+                     const std::string& variant,
+                     const long specSize,
+                     const long argvSize,
+                     const uint64_t iterations,
+                     const uint64_t totalNs);
+
+   const std::vector<BenchResult>& results () const;
+
+   // Output a human readable summary line for the last result.
+   //
+   void report (std::ostream& os, const BenchResult& result) const;
+
+   // Writes all results as a single JSON document.
+   //
+   std::ostream& writeJson (std::ostream& os) const;
+   bool writeJson (const std::string& filename) const;
+
+private:
+   const std::string m_suite;
+   const double m_minSeconds;
+   std::vector<BenchResult> m_results;
+};
+
+//------------------------------------------------------------------------------
+// Escapes a string for inclusion in a JSON document (without the quotes).
+//
+std::string benchJsonEscape (const std::string& str);
+
+//------------------------------------------------------------------------------
+// Synthetic specification and argument workloads shared by the benchmarks.
+// Option j is named "option-<j>", and the kinds cycle through flag, string,
+// enum, integer and real.
+//
+Parsley::OptionSpecifications benchMakeSpecs (const long specSize);
+
+// Forms an argument list of argvSize items (including the program name)
+// for a spec of specSize items. The first arguments are options (each option
+// is used at most once), the remainder are parameters.
+//
+Parsley::Arguments benchMakeArguments (const long specSize,
+                                       const long argvSize);
+
+// The long name of the j-th synthetic option.
+//
+std::string benchOptionName (const long j);
+
+#endif  // BENCH_SUPPORT_H
@@ -0,0 +1,154 @@
+// parsley cold start tool generator
+//
+// Writes the source of a representative short-lived tool to standard output.
+// The tool has a statically initialised OptionSpecifications list of the
+// requested size (as real tools do), and reports its start up time stamps
+// to file descriptor 3 when the cold start driver provides one.
+//
+// usage: coldstart_gen <number of options>
+//        coldstart_gen none      - same tool, but without parsley
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//------------------------------------------------------------------------------
+//
+static void header (const bool useParsley)
+{
+   printf ("// Generated by coldstart_gen - do not edit.\n");
+   printf ("//\n\n");
+   printf ("#include <ctime>\n");
+   printf ("#include <cstdint>\n");
+   printf ("#include <unistd.h>\n");
+   if (useParsley) {
+      printf ("#include <parsley.h>\n");
+   } else {
+      printf ("#include <iostream>\n");
+   }
+   printf ("\n");
+   printf ("static uint64_t now ()\n"
+           "{\n"
+           "   struct timespec ts;\n"
+           "   clock_gettime (CLOCK_MONOTONIC, &ts);\n"
+           "   return uint64_t (ts.tv_sec) * 1000000000u + uint64_t (ts.tv_nsec);\n"
+           "}\n\n");
+
+   // Runs before any other static initialisation within this executable,
+   // but after the shared libraries have been initialised.
+   //
+   printf ("static uint64_t initTime = 0;\n"
+           "__attribute__((constructor(101))) static void earlyInit () { initTime = now (); }\n\n");
+}
+
+//------------------------------------------------------------------------------
+// The specification is built by a number of functions of chunkSize options
+// each, as one very large initialiser list takes an age to compile.
+// It is still built during static initialisation, as it is in real tools.
+//
+static const long chunkSize = 50;
+
+static void specification (const long size)
+{
+   printf ("static const Parsley::EnumOptions colours = { \"red\", \"green\", \"blue\" };\n\n");
+
+   const long chunks = (size + chunkSize - 1) / chunkSize;
+   for (long c = 0; c < chunks; c++) {
+      printf ("static void chunk%ld (Parsley::OptionSpecifications& specs)\n", c);
+      printf ("{\n");
+      printf ("   const Parsley::OptionSpecifications part = {\n");
+
+      const long last = (c + 1) * chunkSize < size ? (c + 1) * chunkSize : size;
+      for (long j = c * chunkSize; j < last; j++) {
+         char shortName [8] = "'\\0'";
+         if ((j < 26) && (j != 'h' - 'a')) {   // -h is the help option
+            snprintf (shortName, sizeof (shortName), "'%c'", char ('a' + j));
+         }
+
+         const char* desc = "A representative option description, of typical length.";
+         switch (j % 5) {
+            case 0:
+               printf ("      Parsley::flagSpec (\"option-%ld\", %s, \"%s\"),\n", j, shortName, desc);
+               break;
+            case 1:
+               printf ("      Parsley::strSpec (\"option-%ld\", %s, \"%s\")->defStr (\"none\"),\n",
+                       j, shortName, desc);
+               break;
+            case 2:
+               printf ("      Parsley::enumSpec (\"option-%ld\", %s, \"%s\", colours)->defStr (\"red\"),\n",
+                       j, shortName, desc);
+               break;
+            case 3:
+               printf ("      Parsley::intSpec (\"option-%ld\", %s, \"%s\")->intRange (0, 1000)->"
+                       "envVar (\"COLDSTART_OPTION_%ld\"),\n", j, shortName, desc, j);
+               break;
+            default:
+               printf ("      Parsley::realSpec (\"option-%ld\", %s, \"%s\")->defReal (1.5),\n",
+                       j, shortName, desc);
+               break;
+         }
+      }
+      printf ("   };\n");
+      printf ("   specs.insert (specs.end (), part.begin (), part.end ());\n");
+      printf ("}\n\n");
+   }
+
+   printf ("static Parsley::OptionSpecifications makeSpecs ()\n");
+   printf ("{\n");
+   printf ("   Parsley::OptionSpecifications specs;\n");
+   for (long c = 0; c < chunks; c++) {
+      printf ("   chunk%ld (specs);\n", c);
+   }
+   printf ("   specs.push_back (Parsley::version ());\n");
+   printf ("   specs.push_back (Parsley::help ());\n");
+   printf ("   return specs;\n");
+   printf ("}\n\n");
+
+   printf ("static const Parsley::OptionSpecifications optionsSpec = makeSpecs ();\n\n");
+}
+
+//------------------------------------------------------------------------------
+//
+static void mainFunction (const bool useParsley)
+{
+   printf ("int main (int argc, char** argv)\n");
+   printf ("{\n");
+   printf ("   const uint64_t mainTime = now ();\n");
+   if (useParsley) {
+      printf ("   Parsley parser (optionsSpec);\n");
+      printf ("   const bool status = parser.process (Parsley::formArguments (argc, argv), true);\n");
+      printf ("   if (!status) std::cerr << \"error: \" << parser.errorMessage () << '\\n';\n");
+   } else {
+      printf ("   const bool status = argc > 0;\n");
+   }
+   printf ("   const uint64_t parsedTime = now ();\n\n");
+
+   // Report to the driver if and only if it gave us a file descriptor 3.
+   //
+   printf ("   const uint64_t stamps [3] = { initTime, mainTime, parsedTime };\n");
+   printf ("   if (write (3, stamps, sizeof (stamps)) < 0) { /* not under the driver */ }\n");
+   printf ("   return status ? 0 : 2;\n");
+   printf ("}\n\n");
+   printf ("// end\n");
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   if (argc != 2) {
+      fprintf (stderr, "usage: coldstart_gen <number of options> | none\n");
+      return 2;
+   }
+
+   const bool useParsley = strcmp (argv[1], "none") != 0;
+   const long size = useParsley ? atol (argv[1]) : 0;
+
+   header (useParsley);
+   if (useParsley) specification (size);
+   mainFunction (useParsley);
+   return 0;
+}
+
+// end
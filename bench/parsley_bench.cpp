@@ -0,0 +1,751 @@
+// parsley micro-benchmarks
+//
+// Times the principal parsley operations over a range of specification and
+// argument list sizes, together with a getopt_long baseline run over the same
+// workloads. Results are written as JSON so that runs may be compared.
+//
+
+#include <getopt.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <parsley.h>
+#include "bench_support.h"
+
+#define nl                '\n'
+#define ARRAY_LENGTH(xx)  (int (sizeof (xx) /sizeof (xx [0])))
+
+static const long specSizes [] = { 10, 100, 1000, 10000 };
+static const long argvSizes [] = { 1, 100, 10000, 1000000 };
+
+//------------------------------------------------------------------------------
+//
+static const Parsley::OptionSpecifications optionsSpec = {
+   Parsley::strSpec  ("output", 'o', "JSON results output file.")->defStr ("parsley_bench.json"),
+   Parsley::realSpec ("min-time", 't', "Minimum time (seconds) spent on each measurement.")->
+                                       realRange (0.001, 60.0)->defReal (0.2),
+   Parsley::intSpec  ("max-spec", 's', "Largest specification size measured.")->
+                                       intRange (10, 10000)->defInt (10000),
+   Parsley::intSpec  ("max-argv", 'a', "Largest argument list size measured.")->
+                                       intRange (1, 1000000)->defInt (1000000),
+   Parsley::strSpec  ("filter", 'f', "Only run benchmarks whose name contains this string.")->defStr (""),
+   Parsley::flagSpec ("quick", 'q', "Quick run: limits sizes to 1000 options and 10000 arguments."),
+   Parsley::version(),
+   Parsley::help ()
+};
+
+//------------------------------------------------------------------------------
+// The getopt_long baseline. The option table is built once per spec size,
+// as would be the case for a real program.
+//
+class GetoptBaseline {
+public:
+   explicit GetoptBaseline (const long specSize);
+   ~GetoptBaseline ();
+
+   // Parses and converts the given arguments, returns number of options found.
+   //
+   long process (std::vector<char*>& argv);
+
+private:
+   std::vector<std::string> m_names;
+   std::vector<struct option> m_options;
+   std::string m_shortOptions;
+
+   std::vector<char> m_flags;
+   std::vector<const char*> m_strs;
+   std::vector<int> m_ints;
+   std::vector<double> m_reals;
+   long m_parameters;
+};
+
+//------------------------------------------------------------------------------
+//
+GetoptBaseline::GetoptBaseline (const long specSize)
+{
+   this->m_names.reserve (specSize);
+   for (long j = 0; j < specSize; j++) {
+      this->m_names.push_back (benchOptionName (j));
+   }
+
+   this->m_shortOptions = "+";   // stop at first parameter, as does parsley
+   for (long j = 0; j < specSize; j++) {
+      const bool hasArg = (j % 5) != 0;
+      struct option item;
+      item.name = this->m_names[j].c_str();
+      item.has_arg = hasArg ? required_argument : no_argument;
+      item.flag = nullptr;
+      item.val = int (256 + j);
+      this->m_options.push_back (item);
+
+      if (j < 26) {
+         this->m_shortOptions += char ('a' + j);
+         if (hasArg) this->m_shortOptions += ':';
+      }
+   }
+   struct option terminator = { nullptr, 0, nullptr, 0 };
+   this->m_options.push_back (terminator);
+
+   this->m_flags.assign (specSize, 0);
+   this->m_strs.assign (specSize, nullptr);
+   this->m_ints.assign (specSize, 0);
+   this->m_reals.assign (specSize, 0.0);
+   this->m_parameters = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+GetoptBaseline::~GetoptBaseline () { }
+
+//------------------------------------------------------------------------------
+//
+long GetoptBaseline::process (std::vector<char*>& argv)
+{
+   static const char* const colours [] = { "red", "green", "blue" };
+
+   const int argc = int (argv.size ());
+   long found = 0;
+
+   optind = 0;   // glibc: full re-initialisation
+   opterr = 0;
+
+   while (true) {
+      const int c = getopt_long (argc, argv.data (), this->m_shortOptions.c_str (),
+                                 this->m_options.data (), nullptr);
+      if (c == -1) break;
+      if (c == '?') return -1;
+
+      const long j = c >= 256 ? c - 256 : c - 'a';
+      switch (j % 5) {
+         case 0:
+            this->m_flags[j] = 1;
+            break;
+         case 1:
+            this->m_strs[j] = optarg;
+            break;
+         case 2:
+            this->m_ints[j] = -1;
+            for (int k = 0; k < ARRAY_LENGTH (colours); k++) {
+               if (strcmp (optarg, colours[k]) == 0) {
+                  this->m_ints[j] = k;
+                  break;
+               }
+            }
+            break;
+         case 3:
+            this->m_ints[j] = int (strtol (optarg, nullptr, 10));
+            break;
+         default:
+            this->m_reals[j] = strtod (optarg, nullptr);
+            break;
+      }
+      found++;
+   }
+
+   this->m_parameters = argc - optind;
+   return found;
+}
+
+
+//------------------------------------------------------------------------------
+//
+static bool selected (const std::string& filter, const std::string& name)
+{
+   return filter.empty () || (name.find (filter) != std::string::npos);
+}
+
+//------------------------------------------------------------------------------
+//
+static void conversionBenchmarks (BenchRunner& runner, const std::string& filter)
+{
+   static const char* const intSamples [] = {
+      "0", "42", "-17", "  1024 ", "+99999", "2147483647", "-2147483648", "12x"
+   };
+   static const char* const realSamples [] = {
+      "0.0", "3.14159", "-2.71828", " 1.0e10 ", "+451.451", "6.02214076e23", "1e-9", "abc"
+   };
+
+   Parsley::Arguments ints (intSamples, intSamples + ARRAY_LENGTH (intSamples));
+   Parsley::Arguments reals (realSamples, realSamples + ARRAY_LENGTH (realSamples));
+
+   if (selected (filter, "str2int")) {
+      BenchResult& r = runner.run ("str2int", "parsley", -1, -1, [&] () {
+         for (const std::string& s : ints) {
+            Parsley::intp_t value = 0;
+            bool status = Parsley::str2int (s, value);
+            benchKeep (status);
+            benchKeep (value);
+         }
+      });
+      r.nsPerOp /= ints.size ();
+      runner.report (std::cout, r);
+
+      BenchResult& b = runner.run ("str2int", "strtol", -1, -1, [&] () {
+         for (const std::string& s : ints) {
+            char* end = nullptr;
+            long value = strtol (s.c_str (), &end, 10);
+            benchKeep (value);
+            benchKeep (end);
+         }
+      });
+      b.nsPerOp /= ints.size ();
+      runner.report (std::cout, b);
+   }
+
+   if (selected (filter, "str2real")) {
+      BenchResult& r = runner.run ("str2real", "parsley", -1, -1, [&] () {
+         for (const std::string& s : reals) {
+            double value = 0.0;
+            bool status = Parsley::str2real (s, value);
+            benchKeep (status);
+            benchKeep (value);
+         }
+      });
+      r.nsPerOp /= reals.size ();
+      runner.report (std::cout, r);
+
+      BenchResult& b = runner.run ("str2real", "strtod", -1, -1, [&] () {
+         for (const std::string& s : reals) {
+            char* end = nullptr;
+            double value = strtod (s.c_str (), &end);
+            benchKeep (value);
+            benchKeep (end);
+         }
+      });
+      b.nsPerOp /= reals.size ();
+      runner.report (std::cout, b);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Format checks on string options: process matching each value against the
+// option's pattern, compiled to a DFA when the specification was built, as
+// against std::regex_match on the same values after process, with the
+// expressions compiled once or, as each run of a program would, every time.
+//
+static void patternBenchmarks (BenchRunner& runner, const std::string& filter)
+{
+   if (!selected (filter, "pattern")) return;
+
+   static const char* const names [] = { "host", "name", "pair", "file" };
+   static const char* const patterns [] = {
+      "[a-z0-9]([a-z0-9-]{0,61}[a-z0-9])?(\\.[a-z0-9]([a-z0-9-]{0,61}[a-z0-9])?)*",
+      "[A-Za-z_]\\w*",
+      "[^:]+:[^:]+",
+      ".*\\.(txt|csv)"
+   };
+   static const char* const values [] = {
+      "build-server-07.eu-west.example.com", "max_retry_count", "timeout:250", "results-2025.csv"
+   };
+   const int number = ARRAY_LENGTH (names);
+
+   Parsley::OptionSpecifications plain;
+   Parsley::OptionSpecifications checked;
+   Parsley::Arguments args = { "tool" };
+   for (int j = 0; j < number; j++) {
+      plain.push_back (Parsley::strSpec (names[j], '\0', "A string option."));
+      checked.push_back (Parsley::strSpec (names[j], '\0', "A string option.")->pattern (patterns[j]));
+      args.push_back (std::string ("--") + names[j]);
+      args.push_back (values[j]);
+   }
+
+   Parsley unchecked (plain);
+   BenchResult& u = runner.run ("pattern", "none", number, long (args.size ()), [&] () {
+      benchKeep (unchecked.process (args, true));
+   });
+   runner.report (std::cout, u);
+
+   Parsley dfa (checked);
+   BenchResult& d = runner.run ("pattern", "dfa", number, long (args.size ()), [&] () {
+      benchKeep (dfa.process (args, true));
+   });
+   runner.report (std::cout, d);
+
+   std::vector<std::regex> expressions;
+   for (int j = 0; j < number; j++) expressions.push_back (std::regex (patterns[j]));
+
+   BenchResult& r = runner.run ("pattern", "std_regex", number, long (args.size ()), [&] () {
+      bool okay = unchecked.process (args, true);
+      for (int j = 0; j < number; j++) {
+         okay = okay && std::regex_match (args[2 * j + 2], expressions[j]);
+      }
+      benchKeep (okay);
+   });
+   runner.report (std::cout, r);
+
+   BenchResult& c = runner.run ("pattern", "std_regex_compile", number, long (args.size ()), [&] () {
+      bool okay = unchecked.process (args, true);
+      for (int j = 0; j < number; j++) {
+         const std::regex expression (patterns[j]);
+         okay = okay && std::regex_match (args[2 * j + 2], expression);
+      }
+      benchKeep (okay);
+   });
+   runner.report (std::cout, c);
+
+   // The cost of compiling the patterns to DFAs, paid once per run.
+   //
+   BenchResult& b = runner.run ("pattern", "dfa_compile", number, -1, [&] () {
+      for (int j = 0; j < number; j++) {
+         benchKeep (Parsley::strSpec (names[j], '\0', "A string option.")->pattern (patterns[j]));
+      }
+   });
+   runner.report (std::cout, b);
+}
+
+//------------------------------------------------------------------------------
+// Checks 32 path options, on one thread and on up to the default eight. On a
+// local filesystem the checks finish before the other threads are started;
+// the gain is on network filesystems, where each stat is a round trip.
+//
+static void pathBenchmarks (BenchRunner& runner, const std::string& filter)
+{
+   if (!selected (filter, "path")) return;
+
+   static const char* const paths [] = { "/tmp", "/usr/bin", "/etc/hosts", "/nonexistent/x" };
+   const int number = 32;
+
+   Parsley::OptionSpecifications specs;
+   Parsley::Arguments args = { "tool" };
+   for (int j = 0; j < number; j++) {
+      const std::string name = "path-" + std::to_string (j);
+      const char* path = paths [j % ARRAY_LENGTH (paths)];
+      const unsigned checks = (j % ARRAY_LENGTH (paths) == 2) ? Parsley::kPathIsFile
+                                                               : Parsley::kPathWritable;
+      specs.push_back (Parsley::pathSpec (name, '\0', "A path option.")->checkPath (checks));
+      args.push_back ("--" + name);
+      args.push_back (path);
+   }
+
+   static const int threads [] = { 1, 8 };
+   for (const int number_threads : threads) {
+      Parsley parser (specs);
+      parser.setPathCheckThreads (number_threads);
+      BenchResult& r = runner.run ("path", "threads_" + std::to_string (number_threads),
+                                   number, long (args.size ()), [&] () {
+         benchKeep (parser.process (args, true));
+      });
+      runner.report (std::cout, r);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Expands patterns over a scratch tree of 64 directories of 200 files, with
+// glob(3) as the baseline for a pattern without **. The gain of the threads
+// is greater on network filesystems, where each directory read is slow.
+//
+static void globBenchmarks (BenchRunner& runner, const std::string& filter)
+{
+   if (!selected (filter, "glob")) return;
+
+   char root [] = "/tmp/parsley_glob_XXXXXX";
+   if (!mkdtemp (root)) return;
+
+   std::vector<std::string> created;
+   for (int d = 0; d < 64; d++) {
+      const std::string directory = std::string (root) + "/run" + std::to_string (d);
+      mkdir (directory.c_str(), 0755);
+      for (int f = 0; f < 200; f++) {
+         const std::string file = directory + "/part" + std::to_string (f) +
+                                  ((f % 4) ? ".h5" : ".log");
+         const int fd = open (file.c_str(), O_CREAT | O_WRONLY, 0644);
+         if (fd >= 0) close (fd);
+         created.push_back (file);
+      }
+      created.push_back (directory);
+   }
+
+   const std::string flat = std::string (root) + "/*/*.h5";
+   const std::string deep = std::string (root) + "/**/*.h5";
+
+   BenchResult& g = runner.run ("glob", "glob3", 64, -1, [&] () {
+      glob_t matches;
+      benchKeep (glob (flat.c_str(), 0, nullptr, &matches) == 0 ? matches.gl_pathc : 0);
+      globfree (&matches);
+   });
+   runner.report (std::cout, g);
+
+   static const int threads [] = { 1, 8 };
+   for (const int number_threads : threads) {
+      const std::string suffix = "_threads_" + std::to_string (number_threads);
+      BenchResult& r = runner.run ("glob", "flat" + suffix, 64, -1, [&] () {
+         size_t count = 0;
+         for (const char* path : Parsley::Glob (flat, number_threads)) count += (path != nullptr);
+         benchKeep (count);
+      });
+      runner.report (std::cout, r);
+
+      BenchResult& t = runner.run ("glob", "recursive" + suffix, 64, -1, [&] () {
+         size_t count = 0;
+         for (const char* path : Parsley::Glob (deep, number_threads)) count += (path != nullptr);
+         benchKeep (count);
+      });
+      runner.report (std::cout, t);
+   }
+
+   for (const std::string& path : created) remove (path.c_str());
+   rmdir (root);
+}
+
+//------------------------------------------------------------------------------
+// Executes a recorded script of 256 admin commands (one op is the script), by the interpreter (one
+// parser per verb, built once) and by the usual approach of tokenizing each
+// line with an istringstream and building a fresh parser for it.
+//
+class CountingHandler : public Parsley::Interpreter::Handler {
+public:
+   bool onCommand (const char*, Parsley& parser, const Parsley::OptionValues& options)
+   {
+      this->count += parser.parameterCount () + size_t (options.view ("force").flag);
+      return true;
+   }
+   size_t count = 0;
+};
+
+static void interpreterBenchmarks (BenchRunner& runner, const std::string& filter)
+{
+   if (!selected (filter, "interpreter")) return;
+
+   const Parsley::OptionSpecifications addSpec = {
+      Parsley::strSpec  ("name", 'n', "The user name.", true),
+      Parsley::strSpec  ("group", 'g', "The user's group."),
+      Parsley::intSpec  ("quota", 'q', "The quota in MB.")->intRange (0, 100000),
+      Parsley::flagSpec ("force", 'f', "Replace an existing user.")
+   };
+   const Parsley::OptionSpecifications removeSpec = {
+      Parsley::strSpec  ("name", 'n', "The user name.", true),
+      Parsley::flagSpec ("force", 'f', "Remove the user's files.")
+   };
+   const Parsley::OptionSpecifications showSpec = {
+      Parsley::flagSpec ("force", 'f', "Include disabled users."),
+      Parsley::flagSpec ("json", 'j', "Show as json.")
+   };
+
+   const int number = 256;
+   std::vector<std::string> script;
+   for (int j = 0; j < number; j++) {
+      const std::string user = "user" + std::to_string (j);
+      switch (j % 4) {
+         case 0:  script.push_back ("add --name " + user + " --group staff --quota " +
+                                    std::to_string (j * 10)); break;
+         case 1:  script.push_back ("add -n " + user + " -g \"lab users\" -f"); break;
+         case 2:  script.push_back ("show --json " + user + " " + user + "x"); break;
+         default: script.push_back ("remove --name " + user + " --force"); break;
+      }
+   }
+
+   CountingHandler handler;
+   Parsley::Interpreter interpreter;
+   interpreter.addVerb ("add", addSpec, handler);
+   interpreter.addVerb ("remove", removeSpec, handler);
+   interpreter.addVerb ("show", showSpec, handler);
+
+   std::vector<char> buffer;
+   BenchResult& r = runner.run ("interpreter", "interpreter", number, -1, [&] () {
+      for (const std::string& line : script) {
+         buffer.assign (line.c_str(), line.c_str() + line.size() + 1);
+         benchKeep (interpreter.execute (buffer.data()));
+      }
+   });
+   r.extra.push_back (std::make_pair ("ns_per_command", r.nsPerOp / number));
+   r.extra.push_back (std::make_pair ("commands_per_second", 1.0e9 * number / r.nsPerOp));
+   runner.report (std::cout, r);
+
+   // The baseline does not handle quotes; the quoted group is split in two,
+   // which the parser takes as an extra parameter.
+   //
+   BenchResult& b = runner.run ("interpreter", "parser_per_line", number, -1, [&] () {
+      for (const std::string& line : script) {
+         std::istringstream words (line);
+         Parsley::Arguments args;
+         std::string word;
+         while (words >> word) args.push_back (word);
+         const Parsley::OptionSpecifications& spec =
+            args [0] == "add" ? addSpec : args [0] == "remove" ? removeSpec : showSpec;
+         Parsley parser (spec);
+         if (parser.process (args, true)) {
+            const Parsley::OptionValues options = parser.options ();
+            benchKeep (options.view ("force").flag);
+         }
+      }
+   });
+   b.extra.push_back (std::make_pair ("ns_per_command", b.nsPerOp / number));
+   b.extra.push_back (std::make_pair ("commands_per_second", 1.0e9 * number / b.nsPerOp));
+   runner.report (std::cout, b);
+   benchKeep (handler.count);
+}
+
+//------------------------------------------------------------------------------
+//
+static void formArgumentsBenchmarks (BenchRunner& runner, const std::string& filter,
+                                     const long maxArgv)
+{
+   if (!selected (filter, "formArguments")) return;
+
+   for (int a = 0; a < ARRAY_LENGTH (argvSizes); a++) {
+      const long argvSize = argvSizes[a];
+      if (argvSize > maxArgv) continue;
+
+      const Parsley::Arguments args = benchMakeArguments (100, argvSize);
+      std::vector<const char*> argv;
+      for (const std::string& s : args) argv.push_back (s.c_str ());
+
+      BenchResult& r = runner.run ("formArguments", "parsley", -1, argvSize, [&] () {
+         Parsley::Arguments result = Parsley::formArguments (int (argv.size ()), argv.data ());
+         benchKeep (result);
+      });
+      runner.report (std::cout, r);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Keeps just a count of the values visited, as a caller needing only a few
+// values would.
+//
+class CountingVisitor : public Parsley::Visitor {
+public:
+   explicit CountingVisitor () : count (0) { }
+   bool onFlag (const int) { this->count++; return true; }
+   bool onInt (const int, const Parsley::intp_t) { this->count++; return true; }
+   bool onReal (const int, const double) { this->count++; return true; }
+   bool onStr (const int, const char*, const size_t) { this->count++; return true; }
+   bool onParameter (const char*, const size_t) { this->count++; return true; }
+   long count;
+};
+
+//------------------------------------------------------------------------------
+//
+static void specBenchmarks (BenchRunner& runner, const std::string& filter,
+                            const long maxSpec, const long maxArgv)
+{
+   for (int s = 0; s < ARRAY_LENGTH (specSizes); s++) {
+      const long specSize = specSizes[s];
+      if (specSize > maxSpec) continue;
+
+      const Parsley::OptionSpecifications specs = benchMakeSpecs (specSize);
+
+      if (selected (filter, "construct")) {
+         BenchResult& r = runner.run ("construct", "parsley", specSize, -1, [&] () {
+            Parsley parser (specs);
+            benchKeep (parser);
+         });
+         runner.report (std::cout, r);
+
+         // The same options in ten groups, each compiled once, as libraries
+         // would contribute them.
+         //
+         Parsley::OptionGroups groups;
+         Parsley::OptionSpecifications part;
+         const long groupSize = specSize >= 10 ? specSize / 10 : 1;
+         for (const Parsley::OptionSpecPointer& spec : specs) {
+            part.push_back (spec);
+            if (long (part.size ()) == groupSize) {
+               groups.push_back (Parsley::optionGroup ("Group", part));
+               part.clear ();
+            }
+         }
+         if (!part.empty ()) groups.push_back (Parsley::optionGroup ("Group", part));
+
+         BenchResult& g = runner.run ("construct", "parsley_groups", specSize, -1, [&] () {
+            Parsley parser (groups);
+            benchKeep (parser);
+         });
+         runner.report (std::cout, g);
+      }
+
+      if (selected (filter, "optionHelp")) {
+         Parsley parser (specs);
+         BenchNullStream nullStream;
+         BenchResult& r = runner.run ("optionHelp", "parsley", specSize, -1, [&] () {
+            parser.optionHelp (nullStream);
+         });
+         runner.report (std::cout, r);
+      }
+
+      if (selected (filter, "completionQuery")) {
+         // Long names matching the last option's name less its final digit,
+         // and the values of the first enumeration option (option-2).
+         //
+         const std::string last = benchOptionName (specSize - 1);
+         const Parsley::Arguments names = {
+            "tool", "--parsley-complete", "1", "tool", "--" + last.substr (0, last.size() - 1)
+         };
+         const Parsley::Arguments values = {
+            "tool", "--parsley-complete", "2", "tool", "--option-2", "r"
+         };
+
+         Parsley parser (specs);
+         BenchNullStream nullStream;
+         BenchResult& n = runner.run ("completionQuery", "long_name", specSize, -1, [&] () {
+            benchKeep (parser.completionQuery (names, true, nullStream));
+         });
+         runner.report (std::cout, n);
+
+         BenchResult& v = runner.run ("completionQuery", "enum_value", specSize, -1, [&] () {
+            benchKeep (parser.completionQuery (values, true, nullStream));
+         });
+         runner.report (std::cout, v);
+
+         // Each key press is a new invocation, so includes the construction.
+         //
+         BenchResult& c = runner.run ("completionQuery", "construct", specSize, -1, [&] () {
+            Parsley fresh (specs);
+            benchKeep (fresh.completionQuery (names, true, nullStream));
+         });
+         runner.report (std::cout, c);
+      }
+
+      if (selected (filter, "environment")) {
+         // Every option may be set by BENCH_OPTION_<j>, either given by each
+         // spec's envVar or mapped by the envPrefix. A few string options
+         // (and one unknown variable) are set.
+         //
+         Parsley::OptionSpecifications named;
+         long j = 0;
+         for (const Parsley::OptionSpecPointer& spec : specs) {
+            std::string evName = "BENCH_" + benchOptionName (j++);
+            for (char& c : evName) c = (c == '-') ? '_' : char (toupper ((unsigned char) c));
+            named.push_back (spec->envVar (evName));
+         }
+
+         const Parsley::Arguments args = { "tool" };
+         for (long j = 1; j < specSize && j < 40; j += 5) {
+            setenv (("BENCH_OPTION_" + std::to_string (j)).c_str (), "value", 1);
+         }
+         setenv ("BENCH_OPTOIN_1", "typo", 1);
+
+         Parsley perSpec (named);
+         BenchResult& e = runner.run ("environment", "envVar", specSize, -1, [&] () {
+            benchKeep (perSpec.process (args, true));
+         });
+         runner.report (std::cout, e);
+
+         Parsley prefixed (specs);
+         prefixed.envPrefix ("BENCH_");
+         BenchResult& p = runner.run ("environment", "envPrefix", specSize, -1, [&] () {
+            benchKeep (prefixed.process (args, true));
+         });
+         runner.report (std::cout, p);
+
+         for (long j = 1; j < specSize && j < 40; j += 5) {
+            unsetenv (("BENCH_OPTION_" + std::to_string (j)).c_str ());
+         }
+         unsetenv ("BENCH_OPTOIN_1");
+      }
+
+      if (!selected (filter, "process")) continue;
+
+      Parsley parser (specs);
+      GetoptBaseline baseline (specSize);
+
+      for (int a = 0; a < ARRAY_LENGTH (argvSizes); a++) {
+         const long argvSize = argvSizes[a];
+         if (argvSize > maxArgv) continue;
+
+         const Parsley::Arguments args = benchMakeArguments (specSize, argvSize);
+
+         bool okay = true;
+         BenchResult& r = runner.run ("process", "parsley", specSize, argvSize, [&] () {
+            okay = parser.process (args, true);
+            benchKeep (okay);
+         });
+         if (!okay) {
+            std::cerr << "parsley bench: process failed: " << parser.errorMessage () << nl;
+         }
+         runner.report (std::cout, r);
+
+         CountingVisitor visitor;
+         BenchResult& v = runner.run ("process", "parsley_visit", specSize, argvSize, [&] () {
+            okay = parser.visit (args, true, visitor);
+            benchKeep (okay);
+         });
+         if (!okay) {
+            std::cerr << "parsley bench: visit failed: " << parser.errorMessage () << nl;
+         }
+         benchKeep (visitor.count);
+         runner.report (std::cout, v);
+
+         // getopt_long needs non-const char* arguments.
+         //
+         std::vector<std::string> copy (args);
+         std::vector<char*> argv;
+         for (std::string& item : copy) argv.push_back (&item[0]);
+         if (argv.empty ()) continue;   // getopt needs at least the program name
+
+         long found = 0;
+         BenchResult& b = runner.run ("process", "getopt_long", specSize, argvSize, [&] () {
+            found = baseline.process (argv);
+            benchKeep (found);
+         });
+         if (found < 0) {
+            std::cerr << "parsley bench: getopt_long baseline failed" << nl;
+         }
+         runner.report (std::cout, b);
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   Parsley parser (optionsSpec);
+
+   bool status = parser.process (Parsley::formArguments (argc, argv), true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      std::cerr << nl;
+      parser.optionHelp (std::cerr);
+      std::cerr << nl;
+      return 2;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      std::cout << "usage: parsley_bench [options]" << nl << nl;
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["version"].flag) {
+      std::cout << PARSLEY_VERSION_STRING << nl;
+      return 0;
+   }
+
+   const bool quick = options["quick"].flag;
+   const std::string filter = options["filter"].str;
+   long maxSpec = options["max-spec"].ival;
+   long maxArgv = options["max-argv"].ival;
+   if (quick) {
+      if (maxSpec > 1000) maxSpec = 1000;
+      if (maxArgv > 10000) maxArgv = 10000;
+   }
+
+   BenchRunner runner ("parsley_bench", options["min-time"].real);
+
+   conversionBenchmarks (runner, filter);
+   patternBenchmarks (runner, filter);
+   pathBenchmarks (runner, filter);
+   globBenchmarks (runner, filter);
+   interpreterBenchmarks (runner, filter);
+   formArgumentsBenchmarks (runner, filter, maxArgv);
+   specBenchmarks (runner, filter, maxSpec, maxArgv);
+
+   const std::string output = options["output"].str;
+   if (!runner.writeJson (output)) {
+      std::cerr << "parsley bench: failed to write " << output << nl;
+      return 1;
+   }
+   std::cout << "results written to " << output << nl;
+   return 0;
+}
+
+// end
@@ -0,0 +1,274 @@
+// parsley cold start benchmark driver
+//
+// Repeatedly executes each of a set of short-lived tools (see coldstart_gen)
+// and reports the wall time, page faults and, where the kernel allows it,
+// user space instruction counts. Each tool reports its own time stamps which
+// allows the total to be broken down into time before main (exec, dynamic
+// linking, static initialisation) and time spent in parsley.
+//
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <parsley.h>
+#include "bench_support.h"
+
+#define nl                '\n'
+
+//------------------------------------------------------------------------------
+//
+static const Parsley::OptionSpecifications optionsSpec = {
+   Parsley::intSpec  ("runs", 'n', "Number of times each tool is executed.")->
+                                   intRange (1, 1000000)->defInt (2000),
+   Parsley::strSpec  ("output", 'o', "JSON results output file.")->defStr ("parsley_coldstart.json"),
+   Parsley::strSpec  ("tool-dir", 'd', "Directory containing the tools.")->defStr ("."),
+   Parsley::version(),
+   Parsley::help ()
+};
+
+static const char* const defaultTools [] = {
+   "coldstart_none", "coldstart_small", "coldstart_medium", "coldstart_huge"
+};
+
+// The arguments given to each tool.
+//
+static const char* const toolArguments [] = {
+   "--option-0", "--option-1", "some value", "parameter", nullptr
+};
+
+//------------------------------------------------------------------------------
+// Measurements for a single execution.
+//
+struct Sample {
+   uint64_t wallNs;
+   uint64_t beforeMainNs;    // fork release to main
+   uint64_t staticInitNs;    // executable's static initialisation to main
+   uint64_t parsleyNs;       // main to process() complete
+   long minorFaults;
+   long majorFaults;
+   long long instructions;   // -1 if not available
+   bool stampsOkay;
+};
+
+//------------------------------------------------------------------------------
+//
+static int openInstructionCounter (const pid_t pid)
+{
+   struct perf_event_attr attr;
+   memset (&attr, 0, sizeof (attr));
+   attr.size = sizeof (attr);
+   attr.type = PERF_TYPE_HARDWARE;
+   attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+   attr.disabled = 1;
+   attr.enable_on_exec = 1;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.inherit = 1;
+
+   return int (syscall (__NR_perf_event_open, &attr, pid, -1, -1, 0));
+}
+
+//------------------------------------------------------------------------------
+//
+static bool runOnce (const std::string& path, const bool tryPerf, Sample& sample)
+{
+   int go [2];
+   int report [2];
+   if (pipe (go) != 0) return false;
+   if (pipe (report) != 0) return false;
+
+   const pid_t pid = fork ();
+   if (pid < 0) return false;
+
+   if (pid == 0) {
+      // Child - wait until released, then become the tool.
+      //
+      close (go[1]);
+      close (report[0]);
+      char c;
+      if (read (go[0], &c, 1) != 1) _exit (126);
+      close (go[0]);
+      dup2 (report[1], 3);
+      if (report[1] != 3) close (report[1]);
+
+      const int devNull = open ("/dev/null", O_WRONLY);
+      if (devNull >= 0) {
+         dup2 (devNull, 1);
+         dup2 (devNull, 2);
+      }
+
+      std::vector<char*> argv;
+      argv.push_back (const_cast<char*> (path.c_str ()));
+      for (int j = 0; toolArguments[j]; j++) {
+         argv.push_back (const_cast<char*> (toolArguments[j]));
+      }
+      argv.push_back (nullptr);
+      execv (path.c_str (), argv.data ());
+      _exit (127);
+   }
+
+   close (go[0]);
+   close (report[1]);
+
+   const int perfFd = tryPerf ? openInstructionCounter (pid) : -1;
+
+   const uint64_t start = benchNow ();
+   if (write (go[1], "g", 1) != 1) { /* child will exit */ }
+   close (go[1]);
+
+   int status = 0;
+   struct rusage usage;
+   wait4 (pid, &status, 0, &usage);
+   const uint64_t finish = benchNow ();
+
+   uint64_t stamps [3] = { 0, 0, 0 };
+   const ssize_t n = read (report[0], stamps, sizeof (stamps));
+   close (report[0]);
+
+   sample.wallNs = finish - start;
+   sample.minorFaults = usage.ru_minflt;
+   sample.majorFaults = usage.ru_majflt;
+   sample.stampsOkay = (n == ssize_t (sizeof (stamps))) && (stamps[1] >= start);
+   sample.beforeMainNs = sample.stampsOkay ? stamps[1] - start : 0;
+   sample.staticInitNs = sample.stampsOkay && stamps[0] ? stamps[1] - stamps[0] : 0;
+   sample.parsleyNs = sample.stampsOkay ? stamps[2] - stamps[1] : 0;
+
+   sample.instructions = -1;
+   if (perfFd >= 0) {
+      long long count = 0;
+      if (read (perfFd, &count, sizeof (count)) == ssize_t (sizeof (count))) {
+         sample.instructions = count;
+      }
+      close (perfFd);
+   }
+
+   return WIFEXITED (status) && (WEXITSTATUS (status) == 0);
+}
+
+//------------------------------------------------------------------------------
+//
+static double percentile (std::vector<uint64_t>& values, const double p)
+{
+   if (values.empty ()) return 0.0;
+   std::sort (values.begin (), values.end ());
+   size_t index = size_t (p * double (values.size () - 1) + 0.5);
+   return double (values[index]);
+}
+
+//------------------------------------------------------------------------------
+//
+static bool measureTool (BenchRunner& runner, const std::string& dir,
+                         const std::string& tool, const int runs)
+{
+   const std::string path = dir + "/" + tool;
+   if (access (path.c_str (), X_OK) != 0) {
+      std::cerr << "parsley coldstart: " << path << ": " << strerror (errno) << nl;
+      return false;
+   }
+
+   // One warm up run, so that the page cache is populated, and to find
+   // out if hardware counters are available to us.
+   //
+   Sample sample;
+   if (!runOnce (path, true, sample)) {
+      std::cerr << "parsley coldstart: " << path << " failed" << nl;
+      return false;
+   }
+   const bool usePerf = sample.instructions >= 0;
+
+   std::vector<uint64_t> walls;
+   walls.reserve (runs);
+   uint64_t totalWall = 0;
+   double beforeMain = 0.0, staticInit = 0.0, parsley = 0.0;
+   double minor = 0.0, major = 0.0, instructions = 0.0;
+   int failures = 0;
+
+   for (int j = 0; j < runs; j++) {
+      if (!runOnce (path, usePerf, sample)) failures++;
+      walls.push_back (sample.wallNs);
+      totalWall += sample.wallNs;
+      beforeMain += sample.beforeMainNs;
+      staticInit += sample.staticInitNs;
+      parsley += sample.parsleyNs;
+      minor += sample.minorFaults;
+      major += sample.majorFaults;
+      if (sample.instructions >= 0) instructions += double (sample.instructions);
+   }
+
+   BenchResult& r = runner.add ("coldstart", tool, -1, -1, runs, totalWall);
+   r.extra.push_back (std::make_pair ("p50_ns", percentile (walls, 0.50)));
+   r.extra.push_back (std::make_pair ("p99_ns", percentile (walls, 0.99)));
+   r.extra.push_back (std::make_pair ("before_main_ns", beforeMain / runs));
+   r.extra.push_back (std::make_pair ("static_init_ns", staticInit / runs));
+   r.extra.push_back (std::make_pair ("parsley_ns", parsley / runs));
+   r.extra.push_back (std::make_pair ("minor_faults", minor / runs));
+   r.extra.push_back (std::make_pair ("major_faults", major / runs));
+   if (usePerf) {
+      r.extra.push_back (std::make_pair ("instructions", instructions / runs));
+   }
+   if (failures > 0) {
+      r.extra.push_back (std::make_pair ("failures", double (failures)));
+   }
+   runner.report (std::cout, r);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   Parsley parser (optionsSpec);
+
+   bool status = parser.process (Parsley::formArguments (argc, argv), true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      std::cerr << nl;
+      parser.optionHelp (std::cerr);
+      std::cerr << nl;
+      return 2;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      std::cout << "usage: parsley_coldstart [options] [tools...]" << nl << nl;
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["version"].flag) {
+      std::cout << PARSLEY_VERSION_STRING << nl;
+      return 0;
+   }
+
+   Parsley::Arguments tools = parser.parameters ();
+   if (tools.empty ()) {
+      for (const char* tool : defaultTools) tools.push_back (tool);
+   }
+
+   const int runs = options["runs"].ival;
+   BenchRunner runner ("parsley_coldstart", 0.0);
+
+   int failed = 0;
+   for (const std::string& tool : tools) {
+      if (!measureTool (runner, options["tool-dir"].str, tool, runs)) failed++;
+   }
+
+   const std::string output = options["output"].str;
+   if (!runner.writeJson (output)) {
+      std::cerr << "parsley coldstart: failed to write " << output << nl;
+      return 1;
+   }
+   std::cout << "results written to " << output << nl;
+   return failed > 0 ? 1 : 0;
+}
+
+// end
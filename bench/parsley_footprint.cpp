@@ -0,0 +1,166 @@
+// parsley memory footprint report
+//
+// Reports the memory used by the option specifications, a Parsley object and
+// an OptionValues result over a range of specification sizes, as estimated by
+// Parsley::footprint, together with the live heap measured directly (by
+// replacing the global operator new and delete) as a cross check.
+//
+
+#include <cstdlib>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <parsley.h>
+#include "bench_support.h"
+
+#define nl                '\n'
+#define ARRAY_LENGTH(xx)  (int (sizeof (xx) /sizeof (xx [0])))
+
+static const long specSizes [] = { 10, 100, 1000, 5000 };
+
+//------------------------------------------------------------------------------
+// Live heap measurement. The usable size includes the allocator's rounding,
+// but not its per-allocation header.
+//
+static int64_t liveBytes = 0;
+
+void* operator new (std::size_t size)
+{
+   void* p = std::malloc (size ? size : 1);
+   if (!p) throw std::bad_alloc ();
+   liveBytes += int64_t (malloc_usable_size (p));
+   return p;
+}
+
+void operator delete (void* p) noexcept
+{
+   if (p) liveBytes -= int64_t (malloc_usable_size (p));
+   std::free (p);
+}
+
+void operator delete (void* p, std::size_t) noexcept
+{
+   if (p) liveBytes -= int64_t (malloc_usable_size (p));
+   std::free (p);
+}
+
+//------------------------------------------------------------------------------
+//
+static const Parsley::OptionSpecifications optionsSpec = {
+   Parsley::strSpec  ("output", 'o', "JSON results output file.")->defStr ("parsley_footprint.json"),
+   Parsley::intSpec  ("max-spec", 's', "Largest specification size measured.")->
+                                       intRange (10, 100000)->defInt (5000),
+   Parsley::version(),
+   Parsley::help ()
+};
+
+//------------------------------------------------------------------------------
+//
+static void addComponents (BenchResult& r, const Parsley::Footprint& fp, const long specSize)
+{
+   r.extra.push_back (std::make_pair ("object", double (fp.object)));
+   r.extra.push_back (std::make_pair ("specs", double (fp.specs)));
+   r.extra.push_back (std::make_pair ("spec_table", double (fp.specTable)));
+   r.extra.push_back (std::make_pair ("index", double (fp.index)));
+   r.extra.push_back (std::make_pair ("values", double (fp.values)));
+   r.extra.push_back (std::make_pair ("parameters", double (fp.parameters)));
+   r.extra.push_back (std::make_pair ("other", double (fp.other)));
+   r.extra.push_back (std::make_pair ("total", double (fp.total ())));
+   r.extra.push_back (std::make_pair ("bytes_per_option", double (fp.total ()) / specSize));
+}
+
+//------------------------------------------------------------------------------
+//
+static void print (const BenchResult& r)
+{
+   std::cout << r.name << " " << r.variant << " spec=" << r.specSize;
+   for (const std::pair<std::string, double>& item : r.extra) {
+      std::cout << " " << item.first << "=" << item.second;
+   }
+   std::cout << nl;
+}
+
+//------------------------------------------------------------------------------
+//
+static void measure (BenchRunner& runner, const long specSize)
+{
+   const Parsley::Arguments args = benchMakeArguments (specSize, 100);
+
+   const int64_t start = liveBytes;
+   const Parsley::OptionSpecifications specs = benchMakeSpecs (specSize);
+   const int64_t afterSpecs = liveBytes;
+
+   Parsley parser (specs);
+   if (!parser.process (args, true)) {
+      std::cerr << "parsley footprint: process failed: " << parser.errorMessage () << nl;
+   }
+   const int64_t afterParser = liveBytes;
+
+   const Parsley::OptionValues options = parser.options ();
+   const int64_t afterResult = liveBytes;
+
+   // The specifications are held by the parser, and are included in its
+   // footprint. The measured heap is that of the specifications plus the
+   // parser, after processing the arguments.
+   //
+   BenchResult& p = runner.add ("footprint", "parser", specSize, long (args.size ()), 1, 0);
+   addComponents (p, parser.footprint (), specSize);
+   p.extra.push_back (std::make_pair ("measured_spec_heap", double (afterSpecs - start)));
+   p.extra.push_back (std::make_pair ("measured_heap", double (afterParser - start)));
+   print (p);
+
+   // Note: the result's index is shared with the parser, so it is included
+   // in the footprint but not in the measured heap.
+   //
+   BenchResult& v = runner.add ("footprint", "result", specSize, long (args.size ()), 1, 0);
+   addComponents (v, options.footprint (), specSize);
+   v.extra.push_back (std::make_pair ("measured_heap", double (afterResult - afterParser)));
+   print (v);
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   Parsley parser (optionsSpec);
+
+   bool status = parser.process (Parsley::formArguments (argc, argv), true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      std::cerr << nl;
+      parser.optionHelp (std::cerr);
+      std::cerr << nl;
+      return 2;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      std::cout << "usage: parsley_footprint [options]" << nl << nl;
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["version"].flag) {
+      std::cout << PARSLEY_VERSION_STRING << nl;
+      return 0;
+   }
+
+   BenchRunner runner ("parsley_footprint", 0.0);
+
+   const long maxSpec = options["max-spec"].ival;
+   for (int s = 0; s < ARRAY_LENGTH (specSizes); s++) {
+      if (specSizes[s] > maxSpec) continue;
+      measure (runner, specSizes[s]);
+   }
+
+   const std::string output = options["output"].str;
+   if (!runner.writeJson (output)) {
+      std::cerr << "parsley footprint: failed to write " << output << nl;
+      return 1;
+   }
+   std::cout << "results written to " << output << nl;
+   return 0;
+}
+
+// end
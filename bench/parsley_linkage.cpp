@@ -0,0 +1,123 @@
+// parsley linkage benchmark
+//
+// Measures the in-process cost of the calls most affected by how parsley is
+// linked: construction, process() and str2int. The same source is built three
+// ways (see the Makefile): against libparsley.so, against libparsley.a, and
+// with the single header implementation compiled in under -flto. The start up
+// cost of each is measured by parsley_coldstart, using the linkage_* tools.
+//
+
+#include <iostream>
+#include <parsley.h>
+#include "bench_support.h"
+
+#define nl                '\n'
+#define ARRAY_LENGTH(xx)  (int (sizeof (xx) /sizeof (xx [0])))
+
+// Set by the Makefile, one of shared, static or lto.
+//
+#ifndef LINKAGE_VARIANT
+#define LINKAGE_VARIANT   "shared"
+#endif
+
+static const long specSizes [] = { 8, 100 };
+
+//------------------------------------------------------------------------------
+//
+static const Parsley::OptionSpecifications optionsSpec = {
+   Parsley::realSpec ("min-time", 't', "Minimum time per benchmark, seconds.")->
+                                       realRange (0.001, 60.0)->defReal (0.2),
+   Parsley::strSpec  ("output", 'o', "JSON results output file.")->
+                                       defStr ("parsley_linkage_" LINKAGE_VARIANT ".json"),
+   Parsley::version(),
+   Parsley::help ()
+};
+
+//------------------------------------------------------------------------------
+//
+static void conversionBenchmark (BenchRunner& runner)
+{
+   static const char* const samples [] = {
+      "0", "42", "-17", "  1024 ", "+99999", "2147483647", "-2147483648", "12x"
+   };
+   const Parsley::Arguments ints (samples, samples + ARRAY_LENGTH (samples));
+
+   BenchResult& r = runner.run ("str2int", LINKAGE_VARIANT, -1, -1, [&] () {
+      for (const std::string& s : ints) {
+         Parsley::intp_t value = 0;
+         bool status = Parsley::str2int (s, value);
+         benchKeep (status);
+         benchKeep (value);
+      }
+   });
+   r.nsPerOp /= ints.size ();
+   runner.report (std::cout, r);
+}
+
+//------------------------------------------------------------------------------
+// A small argument list, as a typical short-lived tool would be given.
+//
+static void specBenchmarks (BenchRunner& runner, const long specSize)
+{
+   const Parsley::OptionSpecifications specs = benchMakeSpecs (specSize);
+   const Parsley::Arguments args = benchMakeArguments (specSize, 8);
+
+   BenchResult& c = runner.run ("construct", LINKAGE_VARIANT, specSize, -1, [&] () {
+      Parsley parser (specs);
+      benchKeep (parser);
+   });
+   runner.report (std::cout, c);
+
+   Parsley parser (specs);
+   BenchResult& p = runner.run ("process", LINKAGE_VARIANT, specSize, long (args.size ()), [&] () {
+      bool status = parser.process (args, true);
+      benchKeep (status);
+   });
+   runner.report (std::cout, p);
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   Parsley parser (optionsSpec);
+
+   bool status = parser.process (Parsley::formArguments (argc, argv), true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      std::cerr << nl;
+      parser.optionHelp (std::cerr);
+      std::cerr << nl;
+      return 2;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      std::cout << "usage: parsley_linkage_" LINKAGE_VARIANT " [options]" << nl << nl;
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["version"].flag) {
+      std::cout << PARSLEY_VERSION_STRING << nl;
+      return 0;
+   }
+
+   BenchRunner runner ("parsley_linkage", options["min-time"].real);
+
+   conversionBenchmark (runner);
+   for (int s = 0; s < ARRAY_LENGTH (specSizes); s++) {
+      specBenchmarks (runner, specSizes[s]);
+   }
+
+   const std::string output = options["output"].str;
+   if (!runner.writeJson (output)) {
+      std::cerr << "parsley linkage: failed to write " << output << nl;
+      return 1;
+   }
+   std::cout << "results written to " << output << nl;
+   return 0;
+}
+
+// end
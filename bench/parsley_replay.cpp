@@ -0,0 +1,218 @@
+// parsley invocation replay driver
+//
+// Loads a corpus of invocations recorded by parsley (see the PARSLEY_RECORD_FILE
+// environment variable), and runs every invocation through process() in-process
+// by way of Parsley::replay. Reports throughput and heap allocation counts and,
+// given a baseline, any change in results.
+//
+// The option specification is selected by the --spec option, or from the
+// recorded tool name when not specified. Only specifications known to this
+// driver (see specRegistry) may be replayed here; other tools replay their own
+// invocations by calling Parsley::replay with their own parser.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <parsley.h>
+#include "bench_support.h"
+
+#define nl                '\n'
+
+//------------------------------------------------------------------------------
+//
+static const Parsley::OptionSpecifications optionsSpec = {
+   Parsley::strSpec  ("corpus", 'c', "The recorded corpus file.", true),
+   Parsley::strSpec  ("spec", 's', "The option specification to use, e.g. parsley_exp or "
+                                   "synthetic-100. Uses the recorded tool name by default.")->defStr (""),
+   Parsley::strSpec  ("baseline", 'b', "Compare results with this baseline file.")->defStr (""),
+   Parsley::strSpec  ("write-baseline", 'w', "Write results to this baseline file.")->defStr (""),
+   Parsley::intSpec  ("repeat", 'r', "Number of times the corpus is replayed.")->
+                                     intRange (1, 1000000)->defInt (10),
+   Parsley::strSpec  ("output", 'o', "JSON results output file.")->defStr ("parsley_replay.json"),
+   Parsley::version(),
+   Parsley::help ()
+};
+
+//------------------------------------------------------------------------------
+// The specifications known to this driver. The parsley_exp spec is a copy of
+// that in test/parsley_exp.cpp, the synthetic specs are those used by the
+// micro-benchmarks.
+//
+struct RegisteredSpec {
+   std::string name;
+   Parsley::OptionSpecifications specs;
+};
+
+static std::vector<RegisteredSpec> specRegistry ()
+{
+   std::vector<RegisteredSpec> result;
+
+   RegisteredSpec exp;
+   exp.name = "parsley_exp";
+   exp.specs = {
+      Parsley::strSpec("command",    'c', "defines command input file."),
+      Parsley::strSpec("report",     'r', "defines report output file."),
+      Parsley::strSpec("option",     'o', "initial command string.")->
+                                           defStr ("")->envVar ("ACE_OPTION"),
+      Parsley::strSpec("backup",     'b', "defines command backup file."),
+      Parsley::flagSpec("shell",     's', "ace used as shell interpretor."),
+      Parsley::flagSpec("quiet",     'q', "quiet.")->envVar ("ACE_QUIET"),
+      Parsley::flagSpec("license",   'l', "display licence information and exit.", true),
+      Parsley::flagSpec("warranty ", 'w', "show warranty info and exit.", true),
+      Parsley::version(),
+      Parsley::help ()
+   };
+   result.push_back (exp);
+
+   static const long sizes [] = { 10, 100, 1000 };
+   for (long size : sizes) {
+      RegisteredSpec synthetic;
+      synthetic.name = "synthetic-" + std::to_string (size);
+      synthetic.specs = benchMakeSpecs (size);
+      result.push_back (synthetic);
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool readBaseline (const std::string& filename, std::vector<uint64_t>& hashes)
+{
+   std::ifstream file (filename);
+   if (!file) return false;
+   std::string line;
+   while (std::getline (file, line)) {
+      hashes.push_back (strtoull (line.c_str (), nullptr, 16));
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   Parsley parser (optionsSpec);
+
+   bool status = parser.process (Parsley::formArguments (argc, argv), true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      std::cerr << nl;
+      parser.optionHelp (std::cerr);
+      std::cerr << nl;
+      return 2;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      std::cout << "usage: parsley_replay [options]" << nl << nl;
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["version"].flag) {
+      std::cout << PARSLEY_VERSION_STRING << nl;
+      return 0;
+   }
+
+   Parsley::Invocations corpus;
+   if (!Parsley::readCorpus (options["corpus"].str, corpus)) {
+      std::cerr << "parsley replay: problem reading " << options["corpus"].str
+                << ", " << corpus.size () << " invocations read" << nl;
+      if (corpus.empty ()) return 1;
+   }
+
+   // Replay the invocations of each spec with one parser per spec. The
+   // digests of invocations not replayed remain 0.
+   //
+   const std::vector<RegisteredSpec> registry = specRegistry ();
+   const std::string specName = options["spec"].str;
+   const int repeat = options["repeat"].ival;
+
+   Parsley::ReplayResult total;
+   total.digests.assign (corpus.size (), 0);
+   for (const RegisteredSpec& item : registry) {
+      if (!specName.empty () && (item.name != specName)) continue;
+
+      Parsley p (item.specs);
+      Parsley::ReplayResult result;
+      p.replay (corpus, specName.empty () ? item.name : "", repeat, result);
+
+      total.replayed += result.replayed;
+      total.failed += result.failed;
+      total.processNs += result.processNs;
+      total.allocations += result.allocations;
+      for (size_t j = 0; j < corpus.size (); j++) {
+         if (result.digests[j]) total.digests[j] = result.digests[j];
+      }
+   }
+
+   size_t skipped = 0;
+   for (const uint64_t digest : total.digests) skipped += (digest == 0);
+
+   const uint64_t calls = total.replayed;
+   BenchRunner runner ("parsley_replay", 0.0);
+   BenchResult& result = runner.add ("replay", specName.empty () ? "recorded" : specName,
+                                     -1, -1, calls, total.processNs);
+   const double seconds = double (total.processNs) * 1.0e-9;
+   result.extra.push_back (std::make_pair ("invocations", double (corpus.size ())));
+   result.extra.push_back (std::make_pair ("skipped", double (skipped)));
+   result.extra.push_back (std::make_pair ("failed", double (total.failed)));
+   result.extra.push_back (std::make_pair ("calls_per_second", seconds > 0.0 ? calls / seconds : 0.0));
+   result.extra.push_back (std::make_pair ("allocations_per_call",
+                                           calls ? double (total.allocations) / calls : 0.0));
+
+   // Compare with, and/or write, the baseline.
+   //
+   int exitStatus = 0;
+   const std::string baseline = options["baseline"].str;
+   if (!baseline.empty ()) {
+      std::vector<uint64_t> expected;
+      if (!readBaseline (baseline, expected)) {
+         std::cerr << "parsley replay: cannot read baseline " << baseline << nl;
+         return 1;
+      }
+
+      int changed = 0;
+      for (size_t j = 0; j < corpus.size (); j++) {
+         if (total.digests[j] == 0) continue;
+         if ((j >= expected.size ()) || (expected[j] != total.digests[j])) {
+            if (changed < 10) {
+               std::cout << "changed result, invocation " << j << ": "
+                         << Parsley::join (corpus[j].arguments) << nl;
+            }
+            changed++;
+         }
+      }
+      result.extra.push_back (std::make_pair ("changed", double (changed)));
+      if (changed > 0) exitStatus = 3;
+   }
+
+   const std::string writeBaseline = options["write-baseline"].str;
+   if (!writeBaseline.empty ()) {
+      std::ofstream file (writeBaseline);
+      for (uint64_t hash : total.digests) {
+         char buffer [24];
+         snprintf (buffer, sizeof (buffer), "%016llx", (unsigned long long) hash);
+         file << buffer << nl;
+      }
+      if (!file) {
+         std::cerr << "parsley replay: failed to write " << writeBaseline << nl;
+         exitStatus = 1;
+      }
+   }
+
+   runner.report (std::cout, result);
+
+   const std::string output = options["output"].str;
+   if (!runner.writeJson (output)) {
+      std::cerr << "parsley replay: failed to write " << output << nl;
+      return 1;
+   }
+   return exitStatus;
+}
+
+// end
@@ -5,13 +5,41 @@
  */
 
 #include "parsley.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cctype>
+#include <cerrno>
+#include <climits>  // for PATH_MAX
 #include <cmath>    // for floor()
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
 #include <limits>
+#include <map>
+#include <new>
+#include <pthread.h>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 
 #define nl        '\n'
 #define dnl       "\n\n"
 
+// Instrumentation - see Parsley::Metrics. Compiled out unless requested.
+//
+#if defined(PARSLEY_INSTRUMENTATION)
+#define INSTRUMENT_PHASE(phase)       PhaseScope phaseScope (this->m_metrics, Metrics::phase)
+#define INSTRUMENT_COUNT(counter, n)  (this->m_metrics.counter += (n))
+#else
+#define INSTRUMENT_PHASE(phase)
+#define INSTRUMENT_COUNT(counter, n)
+#endif
+
 
 //------------------------------------------------------------------------------
 // Utility functions
@@ -22,21 +50,21 @@ static void warning (const std::string& message)
    std::cerr << "\033[33;1mwarning:\033[00m " << message << nl;
 }
 
-//------------------------------------------------------------------------------
-// Trim: based on:
-// https://stackoverflow.com/questions/216823/how-to-trim-a-stdstring/60243752#60243752
+//-----------------------------------------------------------------------------
+// Footprint support - heap bytes requested by a vector.
 //
-static std::string stripString (const std::string& str)
+template <typename T, typename A>
+static size_t heapBytes (const std::vector<T, A>& vec)
 {
-   const size_t strSize = str.size();
-   size_t start, end;
-
-   for (start = 0; start < strSize && isspace(str[start]); start++);
-   for (end = strSize; end > start && isspace(str[end - 1]); end--);
-
-   return str.substr(start, end-start);
+   return vec.capacity() * sizeof (T);
 }
 
+// Estimated size of a shared pointer control block: vtable pointer plus use
+// and weak counts. Note: the specifications and the name index are allocated
+// together with their control blocks (allocate_shared).
+//
+static const size_t sharedControlBytes = sizeof (void*) + 2 * sizeof (int);
+
 //-----------------------------------------------------------------------------
 //
 static std::list<std::string> splitString (const std::string& str,
@@ -126,51 +154,64 @@ std::string Parsley::join (const Arguments& args, const std::string& with)
 }
 
 //------------------------------------------------------------------------------
+// Only leading and trailing white space is allowed. These do not allocate,
+// and so are usable within process with a const char* from getenv.
 //
-bool Parsley::str2real (const std::string& str, double& value)
+static bool parseReal (const char* str, double& value) noexcept
 {
-   // Does str contain !!
-   //
-   std::size_t found = str.find ("!!", 0);
-   if (found != std::string::npos) return false;
+   const char* start = str;
+   while (isspace (*start)) start++;
+   if (*start == '\0') return false;
 
-   const std::string temp = stripString (str) + "!!x";
+   char* end = nullptr;
+   const double temp = strtod (start, &end);
+   if (end == start) return false;
 
-   char c = ' ';
-   const int n = sscanf(temp.c_str(), "%lf!!%c", &value, &c);
-   if (n != 2) return false;
-   if (c != 'x') return false;
+   while (isspace (*end)) end++;
+   if (*end != '\0') return false;
+
+   value = temp;
    return true;
 }
 
 //------------------------------------------------------------------------------
 //
-bool Parsley::str2int (const std::string& str, intp_t& value)
+static bool parseInt (const char* str, Parsley::intp_t& value) noexcept
 {
-   // Try as real first so that we can do a range check.
-   //
-   double real;
-   bool s = str2real (str, real);
-   if (!s) return false;
-
-   // Min / max long values expressed as doubles.
-   //
-   static constexpr double dmin = std::numeric_limits<intp_t>::min();
-   static constexpr double dmax = std::numeric_limits<intp_t>::max();
+   const char* start = str;
+   while (isspace (*start)) start++;
+   if (*start == '\0') return false;
 
-   if (real < dmin) return false;
-   if (real > dmax) return false;
+   char* end = nullptr;
+   errno = 0;
+   const long temp = strtol (start, &end, 10);
+   if (end == start) return false;
+   if (errno == ERANGE) return false;
 
-   const std::string temp = stripString (str) + "!!x";
+   while (isspace (*end)) end++;
+   if (*end != '\0') return false;
 
-   char c = ' ';
-   const int n = sscanf(temp.c_str(), "%d!!%c", &value, &c);
-   if (n != 2) return false;
-   if (c != 'x') return false;
+   if (temp < std::numeric_limits<Parsley::intp_t>::min()) return false;
+   if (temp > std::numeric_limits<Parsley::intp_t>::max()) return false;
 
+   value = Parsley::intp_t (temp);
    return true;
 }
 
+//------------------------------------------------------------------------------
+//
+bool Parsley::str2real (const std::string& str, double& value)
+{
+   return parseReal (str.c_str(), value);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::str2int (const std::string& str, intp_t& value)
+{
+   return parseInt (str.c_str(), value);
+}
+
 //------------------------------------------------------------------------------
 //
 std::string Parsley::real2str (const double x)
@@ -197,12 +238,234 @@ std::string Parsley::int2str (const intp_t i)
    return std::string (buffer);
 }
 
+//==============================================================================
+// Memory resources
+//==============================================================================
+//
+Parsley::MemoryResource::~MemoryResource () {}
+
+//------------------------------------------------------------------------------
+//
+void* Parsley::MemoryResource::allocate (const size_t bytes, const size_t alignment)
+{
+   void* result = this->doAllocate (bytes, alignment);
+   if (!result) {
+#if defined(PARSLEY_EXCEPTIONS)
+      throw std::bad_alloc ();
+#else
+      std::abort ();
+#endif
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+void* Parsley::MemoryResource::tryAllocate (const size_t bytes,
+                                            const size_t alignment) noexcept
+{
+   return this->doAllocate (bytes, alignment);
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::MemoryResource::deallocate (void* p, const size_t bytes,
+                                          const size_t alignment) noexcept
+{
+   this->doDeallocate (p, bytes, alignment);
+}
+
+//------------------------------------------------------------------------------
+// Uses the global operator new and delete. The alignment of these is
+// sufficient for all the types used by parsley.
+//
+class NewDeleteResource : public Parsley::MemoryResource {
+protected:
+   void* doAllocate (const size_t bytes, const size_t) noexcept
+   {
+      return ::operator new (bytes, std::nothrow);
+   }
+
+   void doDeallocate (void* p, const size_t, const size_t) noexcept
+   {
+      ::operator delete (p);
+   }
+};
+
+//------------------------------------------------------------------------------
+//
+class NullResource : public Parsley::MemoryResource {
+protected:
+   void* doAllocate (const size_t, const size_t) noexcept
+   {
+      return nullptr;
+   }
+
+   void doDeallocate (void*, const size_t, const size_t) noexcept { }
+};
+
+//------------------------------------------------------------------------------
+// static
+Parsley::MemoryResource& Parsley::defaultResource ()
+{
+   static NewDeleteResource resource;
+   return resource;
+}
+
 //------------------------------------------------------------------------------
 // static
-Parsley::OptionSpecPointer Parsley::help ()
+Parsley::MemoryResource& Parsley::nullResource ()
+{
+   static NullResource resource;
+   return resource;
+}
+
+//------------------------------------------------------------------------------
+// The header of each block obtained from upstream.
+//
+struct Parsley::MonotonicArena::Block {
+   Block* next;
+   size_t size;   // including this header
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::MonotonicArena::MonotonicArena (void* buffer, const size_t size,
+                                         MemoryResource& upstream) :
+   m_upstream (&upstream),
+   m_buffer (static_cast<char*> (buffer)),
+   m_bufferSize (buffer ? size : 0)
+{
+   this->m_blocks = nullptr;
+   this->m_nextBlockSize = this->m_bufferSize > 1024 ? this->m_bufferSize : 1024;
+   this->release ();
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::MonotonicArena::MonotonicArena (const size_t blockSize,
+                                         MemoryResource& upstream) :
+   m_upstream (&upstream),
+   m_buffer (nullptr),
+   m_bufferSize (0)
+{
+   this->m_blocks = nullptr;
+   this->m_nextBlockSize = blockSize > 64 ? blockSize : 64;
+   this->release ();
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::MonotonicArena::~MonotonicArena ()
+{
+   this->release ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::MonotonicArena::release () noexcept
+{
+   while (this->m_blocks) {
+      Block* block = this->m_blocks;
+      this->m_blocks = block->next;
+      this->m_upstream->deallocate (block, block->size);
+   }
+
+   this->m_current = this->m_buffer;
+   this->m_remaining = this->m_bufferSize;
+   this->m_allocated = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::MonotonicArena::bytesAllocated () const noexcept
+{
+   return this->m_allocated;
+}
+
+//------------------------------------------------------------------------------
+//
+void* Parsley::MonotonicArena::doAllocate (const size_t bytes, const size_t alignment) noexcept
+{
+   size_t padding = size_t (-uintptr_t (this->m_current)) & (alignment - 1);
+
+   if (!this->m_current || (padding + bytes > this->m_remaining)) {
+      // Obtain another block from upstream - geometric growth.
+      //
+      const size_t header = (sizeof (Block) + alignment - 1) & ~(alignment - 1);
+      size_t size = this->m_nextBlockSize;
+      while (size < header + bytes) size *= 2;
+
+      Block* block = static_cast<Block*> (this->m_upstream->tryAllocate (size));
+      if (!block) return nullptr;
+      block->next = this->m_blocks;
+      block->size = size;
+      this->m_blocks = block;
+      this->m_nextBlockSize = 2 * size;
+
+      this->m_current = reinterpret_cast<char*> (block) + header;
+      this->m_remaining = size - header;
+      padding = 0;
+   }
+
+   char* result = this->m_current + padding;
+   this->m_current = result + bytes;
+   this->m_remaining -= padding + bytes;
+   this->m_allocated += bytes;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Memory is only reclaimed by release.
+//
+void Parsley::MonotonicArena::doDeallocate (void*, const size_t, const size_t) noexcept { }
+
+
+//==============================================================================
+// Parsley::SpecBuilder
+//==============================================================================
+// Specifications are allocated together with their shared pointer control
+// block, i.e. one allocation per specification instead of two.
+//
+class Parsley::SharedSpec : public Parsley::OptionSpec {
+public:
+   SharedSpec (MemoryResource& resource,
+               const Kind kind,
+               const char* longName,
+               const char shortName,
+               const char* description,
+               const bool isRequired) :
+      OptionSpec (resource, kind, longName, shortName, description, isRequired) { }
+
+   explicit SharedSpec (const OptionSpec& other) : OptionSpec (other) { }
+
+   // Allocates the specification from the given resource.
+   //
+   template <typename... Args>
+   static std::shared_ptr<SharedSpec> make (MemoryResource* resource, Args&&... args)
+   {
+      return std::allocate_shared<SharedSpec>
+            (Allocator<SharedSpec> (resource), std::forward<Args> (args)...);
+   }
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::SpecBuilder::SpecBuilder (MemoryResource& resource) :
+   m_resource (&resource) { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::SpecBuilder::~SpecBuilder () { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::SpecBuilder::help () const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kFlag,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kFlag,
           "help",
           'h',
           "Show this message and exit.",
@@ -213,15 +476,17 @@ Parsley::OptionSpecPointer Parsley::help ()
    spec->m_isSingleton = true;
    spec->m_defaultIsDefined = true;   // the default is implicitly defined as false.
 
-   return OptionSpecPointer (spec);
+   return spec;
 }
 
 //------------------------------------------------------------------------------
-// static
-Parsley::OptionSpecPointer Parsley::version ()
+//
+Parsley::OptionSpecPointer Parsley::SpecBuilder::version () const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kFlag,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kFlag,
           "version",
           'V',
           "Show version and exit.",
@@ -232,19 +497,60 @@ Parsley::OptionSpecPointer Parsley::version ()
    spec->m_isSingleton = true;
    spec->m_defaultIsDefined = true;  // the default is implicitly false
 
-   return OptionSpecPointer (spec);
+   return spec;
 }
 
 //------------------------------------------------------------------------------
-// static
+// The values are in Shell order.
+//
+Parsley::OptionSpecPointer Parsley::SpecBuilder::completion () const
+{
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kEnum,
+          "completion",
+          '\0',
+          "Write a shell completion script and exit.",
+          false);
+
+   static const char* const shells [] = { "bash", "zsh", "fish" };
+   spec->addEnumOptions (shells, shells + 3);
+
+   spec->m_isSingleton = true;
+   spec->m_isHidden = true;
+   return spec;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::SpecBuilder::profileOption () const
+{
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kStr,
+          "profile",
+          '\0',
+          "Apply the named profiles, comma separated, in order.",
+          false);
+
+   spec->m_isProfile = true;
+   return spec;
+}
+
+//------------------------------------------------------------------------------
+//
 Parsley::OptionSpecPointer
-Parsley::flagSpec (const std::string& longName,
-               const char shortName,
-               const std::string& description,
-               const bool isSingleton)
+Parsley::SpecBuilder::flagSpec (const char* longName,
+                                const char shortName,
+                                const char* description,
+                                const bool isSingleton) const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kFlag,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kFlag,
           longName,
           shortName,
           description,
@@ -253,1043 +559,6986 @@ Parsley::flagSpec (const std::string& longName,
    // flags are implicitly defined, defaulting to false.
    spec->m_defaultIsDefined = true;
    spec->m_isSingleton = isSingleton;
-   return OptionSpecPointer (spec);
+   return spec;
 }
 
 //------------------------------------------------------------------------------
-// static
+//
 Parsley::OptionSpecPointer
-Parsley::strSpec (const std::string& longName,
-                  const char shortName,
-                  const std::string& description,
-                  const bool isRequired)
+Parsley::SpecBuilder::strSpec (const char* longName,
+                               const char shortName,
+                               const char* description,
+                               const bool isRequired) const
+{
+   return SharedSpec::make (this->m_resource,
+                    *this->m_resource,
+                    OptionSpec::Kind::kStr,
+                    longName,
+                    shortName,
+                    description,
+                    isRequired);
+}
+
+//------------------------------------------------------------------------------
+// A path is a string whose value is a file name.
+//
+Parsley::OptionSpecPointer
+Parsley::SpecBuilder::pathSpec (const char* longName,
+                                const char shortName,
+                                const char* description,
+                                const bool isRequired) const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kStr,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kStr,
           longName,
           shortName,
           description,
           isRequired);
 
-   return OptionSpecPointer (spec);
+   spec->m_isFileValue = true;
+   return spec;
 }
 
 //------------------------------------------------------------------------------
-// static
+//
 Parsley::OptionSpecPointer
-Parsley::enumSpec (const std::string& longName,
-                   const char shortName,
-                   const std::string& description,
-                   const EnumOptions& enumOptions,
-                   const bool isRequired)
+Parsley::SpecBuilder::enumSpec (const char* longName,
+                                const char shortName,
+                                const char* description,
+                                std::initializer_list<const char*> enumOptions,
+                                const bool isRequired) const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kEnum,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kEnum,
           longName,
           shortName,
           description,
           isRequired);
 
-   spec->m_enumOptions = enumOptions;
-   return OptionSpecPointer (spec);
+   spec->addEnumOptions (enumOptions.begin(), enumOptions.end());
+   return spec;
 }
 
 //------------------------------------------------------------------------------
-// static
+//
 Parsley::OptionSpecPointer
-Parsley::intSpec (const std::string& longName,
-                  const char shortName,
-                  const std::string& description,
-                  const bool isRequired)
+Parsley::SpecBuilder::intSpec (const char* longName,
+                               const char shortName,
+                               const char* description,
+                               const bool isRequired) const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kInt,
-          longName,
-          shortName,
-          description,
-          isRequired);
+   return SharedSpec::make (this->m_resource,
+                    *this->m_resource,
+                    OptionSpec::Kind::kInt,
+                    longName,
+                    shortName,
+                    description,
+                    isRequired);
+}
 
-   return OptionSpecPointer (spec);
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::SpecBuilder::realSpec (const char* longName,
+                                const char shortName,
+                                const char* description,
+                                const bool isRequired) const
+{
+   return SharedSpec::make (this->m_resource,
+                    *this->m_resource,
+                    OptionSpec::Kind::kReal,
+                    longName,
+                    shortName,
+                    description,
+                    isRequired);
 }
 
 //------------------------------------------------------------------------------
-// static
+//
 Parsley::OptionSpecPointer
-Parsley::realSpec (const std::string& longName,
-                   const char shortName,
-                   const std::string& description,
-                   const bool isRequired)
+Parsley::SpecBuilder::makeCustomSpec (const CustomType* type,
+                                      const char* longName,
+                                      const char shortName,
+                                      const char* description,
+                                      const bool isRequired) const
 {
-   OptionSpec* spec = new Parsley::OptionSpec
-         (OptionSpec::Kind::kReal,
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (this->m_resource,
+          *this->m_resource,
+          OptionSpec::Kind::kCustom,
           longName,
           shortName,
           description,
           isRequired);
 
-   return OptionSpecPointer (spec);
+   spec->m_customType = type;
+   return spec;
 }
 
-
-//==============================================================================
-// Parsley::OptionSpec
-//==============================================================================
+//------------------------------------------------------------------------------
 // static
-std::string Parsley::OptionSpec::kindImage (const Kind kind)
+Parsley::OptionSpecPointer Parsley::help ()
 {
-   static const std::string images[] = { "flag", "string", "enumSpec", "integer", "real" };
-   return images[kind];
+   return SpecBuilder (defaultResource ()).help ();
 }
 
 //------------------------------------------------------------------------------
-//
-Parsley::OptionSpec::OptionSpec (const Kind kindIn,
-                                 const std::string& longNameIn,
-                                 const char shortNameIn,
-                                 const std::string& descriptionIn,
-                                 const bool isRequiredIn):
-   m_kind (kindIn),
-   m_longName (longNameIn),
-   m_shortName (shortNameIn),
-   m_description (descriptionIn),
-   m_isRequired (isRequiredIn)
+// static
+Parsley::OptionSpecPointer Parsley::version ()
 {
-   this->m_isSingleton = false;
-
-   this->m_enumOptions.clear();
-
-   this->m_rangeIsDefined = false;
-   this->m_minIntValue = 0;
-   this->m_maxIntValue = 0;
-   this->m_minRealValue = 0.0;
-   this->m_maxRealValue = 0.0;
-
-   this->m_evIsDefined = false;
-   this->m_evName = "";
-
-   this->m_defaultIsDefined = false;
-   this->m_defaultStr = "";
-   this->m_defaultInt = 0;
-   this->m_defaultReal = 0.0;
+   return SpecBuilder (defaultResource ()).version ();
 }
 
 //------------------------------------------------------------------------------
-// Clone/copy and existing spec
-//
-Parsley::OptionSpec::OptionSpec (const OptionSpec& other) :
-   m_kind (other.m_kind),
-   m_longName (other.m_longName),
-   m_shortName (other.m_shortName),
-   m_description (other.m_description),
-   m_isRequired (other.m_isRequired)
+// static
+Parsley::OptionSpecPointer Parsley::completion ()
 {
-   this->m_isSingleton = other.m_isSingleton;
-
-   this->m_enumOptions = other.m_enumOptions;
-
-   this->m_rangeIsDefined = other.m_rangeIsDefined;
-   this->m_minIntValue = other.m_minIntValue;
-   this->m_maxIntValue = other.m_maxIntValue;
-   this->m_minRealValue = other.m_minRealValue;
-   this->m_maxRealValue = other.m_maxRealValue;
-
-   this->m_evIsDefined = other.m_evIsDefined;
-   this->m_evName = other.m_evName;
-
-   this->m_defaultIsDefined = other.m_defaultIsDefined;
-   this->m_defaultStr = other.m_defaultStr;
-   this->m_defaultInt = other.m_defaultInt;
-   this->m_defaultReal = other.m_defaultReal;
+   return SpecBuilder (defaultResource ()).completion ();
 }
 
 //------------------------------------------------------------------------------
-//
-Parsley::OptionSpec::~OptionSpec () { }
-
-
+// static
+Parsley::OptionSpecPointer Parsley::profileOption ()
+{
+   return SpecBuilder (defaultResource ()).profileOption ();
+}
 
 //------------------------------------------------------------------------------
-// Note on defval/range/envVar - we need to create a new object
-// (which is a clone of the original) and we return a shared pointer.
-//
-//------------------------------------------------------------------------------
-//
-Parsley::OptionSpecPointer Parsley::OptionSpec::defStr (const std::string& defValue)
+// static
+Parsley::OptionSpecPointer
+Parsley::flagSpec (const std::string& longName,
+               const char shortName,
+               const std::string& description,
+               const bool isSingleton)
 {
-   OptionSpec* clone = new OptionSpec(*this);
+   return SpecBuilder (defaultResource ()).flagSpec
+         (longName.c_str(), shortName, description.c_str(), isSingleton);
+}
 
-   if (clone->m_kind != kStr && clone->m_kind != kEnum) {
-      warning ("default string value for " + this->info() + " ignored.");
-   } else if (clone->m_defaultIsDefined) {
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionSpecPointer
+Parsley::strSpec (const std::string& longName,
+                  const char shortName,
+                  const std::string& description,
+                  const bool isRequired)
+{
+   return SpecBuilder (defaultResource ()).strSpec
+         (longName.c_str(), shortName, description.c_str(), isRequired);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionSpecPointer
+Parsley::pathSpec (const std::string& longName,
+                   const char shortName,
+                   const std::string& description,
+                   const bool isRequired)
+{
+   return SpecBuilder (defaultResource ()).pathSpec
+         (longName.c_str(), shortName, description.c_str(), isRequired);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionSpecPointer
+Parsley::enumSpec (const std::string& longName,
+                   const char shortName,
+                   const std::string& description,
+                   const EnumOptions& enumOptions,
+                   const bool isRequired)
+{
+   std::shared_ptr<SharedSpec> spec = SharedSpec::make
+         (&defaultResource (),
+          defaultResource (),
+          OptionSpec::Kind::kEnum,
+          longName.c_str(),
+          shortName,
+          description.c_str(),
+          isRequired);
+
+   spec->addEnumOptions (enumOptions.begin(), enumOptions.end());
+   return spec;
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionSpecPointer
+Parsley::intSpec (const std::string& longName,
+                  const char shortName,
+                  const std::string& description,
+                  const bool isRequired)
+{
+   return SpecBuilder (defaultResource ()).intSpec
+         (longName.c_str(), shortName, description.c_str(), isRequired);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionSpecPointer
+Parsley::realSpec (const std::string& longName,
+                   const char shortName,
+                   const std::string& description,
+                   const bool isRequired)
+{
+   return SpecBuilder (defaultResource ()).realSpec
+         (longName.c_str(), shortName, description.c_str(), isRequired);
+}
+
+
+//==============================================================================
+// Parsley::Pattern
+//==============================================================================
+// A pattern is parsed to a syntax tree, from which a Thompson NFA is built and
+// then converted, by subset construction, to a DFA. The bytes are first
+// partitioned into classes that no byte set of the pattern distinguishes, so
+// that each DFA state has a row entry per class rather than per byte. State 0
+// is the dead state and state 1 the start state. All this is done once, when
+// the specification is built; matching is then a table lookup per byte.
+//
+class Parsley::Pattern {
+public:
+   explicit Pattern (MemoryResource& resource);
+   ~Pattern ();
+
+   // Returns an empty string if successful, otherwise a description of the
+   // error.
+   //
+   std::string compile (const std::string& source);
+
+   // The whole value must match.
+   //
+   bool matches (const char* str, const size_t length) const noexcept
+   {
+      const uint16_t* next = this->m_next.data();
+      const size_t classes = this->m_classCount;
+      size_t state = 1;
+      for (size_t j = 0; j < length; j++) {
+         state = next[state * classes + this->m_classOf[uint8_t (str[j])]];
+         if (state == 0) return false;
+      }
+      return this->m_accepting[state] != 0;
+   }
+
+   size_t footprint () const;   // including the object itself
+
+private:
+   typedef std::bitset<256> ByteSet;
+
+   // A syntax tree node. Repeat's max is -1 when unbounded.
+   //
+   struct Node {
+      enum Type : uint8_t { kSet, kEmpty, kConcat, kAlternate, kRepeat };
+      Type type;
+      int set;     // kSet: index into the byte sets
+      int left;    // kConcat, kAlternate, and kRepeat's repeated node
+      int right;
+      int min;
+      int max;
+   };
+
+   // An NFA state: on a byte within its set (if any) goes to next, otherwise
+   // an epsilon state going to next and alt, either being -1 if none.
+   //
+   struct NfaState {
+      int set;
+      int next;
+      int alt;
+   };
+
+   struct Fragment {
+      int start;
+      int end;     // an epsilon state, with no transitions as yet
+   };
+
+   class Syntax;
+
+   static Fragment build (const Syntax& syntax, const int node,
+                          std::vector<NfaState>& nfa);
+   static void closure (const std::vector<NfaState>& nfa, std::vector<int>& states,
+                        std::vector<int>& pending, std::vector<int>& reached, const int stamp);
+
+   static const size_t maxNfaStates = 65536;
+   static const size_t maxDfaStates = 4096;
+
+   uint8_t m_classOf [256];
+   size_t m_classCount;
+   std::vector<uint16_t, Allocator<uint16_t> > m_next;     // state * classes + class
+   std::vector<uint8_t, Allocator<uint8_t> > m_accepting;  // by state
+};
+
+//------------------------------------------------------------------------------
+// A recursive descent parser of the pattern subset:
+//
+//    alternation := sequence ( '|' sequence )*
+//    sequence    := repetition*
+//    repetition  := atom ( '*' | '+' | '?' | '{n}' | '{n,}' | '{n,m}' )*
+//    atom        := '(' alternation ')' | '[' class ']' | '.' | '\' escape | char
+//
+class Parsley::Pattern::Syntax {
+public:
+   explicit Syntax (const std::string& source) : m_source (source), m_pos (0) { }
+
+   // Returns the root node, or -1 and sets error.
+   //
+   int parse ()
+   {
+      const int root = this->alternation (0);
+      if ((root >= 0) && (this->m_pos < this->m_source.size())) {
+         return this->failed ("unexpected ')'");
+      }
+      return root;
+   }
+
+   std::vector<Node> nodes;
+   std::vector<ByteSet> sets;
+   std::string error;
+
+private:
+   static const int maxDepth = 64;     // of nested groups
+   static const int maxRepeat = 255;
+
+   bool atEnd () const { return this->m_pos >= this->m_source.size(); }
+   char peek () const { return this->m_source[this->m_pos]; }
+
+   int failed (const std::string& message)
+   {
+      if (this->error.empty()) {
+         this->error = message + " at offset " + std::to_string (this->m_pos);
+      }
+      return -1;
+   }
+
+   int node (const Node::Type type, const int left = -1, const int right = -1)
+   {
+      const Node item = { type, -1, left, right, 0, 0 };
+      this->nodes.push_back (item);
+      return int (this->nodes.size()) - 1;
+   }
+
+   int setNode (const ByteSet& set)
+   {
+      this->sets.push_back (set);
+      const int result = this->node (Node::kSet);
+      this->nodes[result].set = int (this->sets.size()) - 1;
+      return result;
+   }
+
+   int alternation (const int depth)
+   {
+      int result = this->sequence (depth);
+      while ((result >= 0) && !this->atEnd() && (this->peek() == '|')) {
+         this->m_pos++;
+         const int right = this->sequence (depth);
+         if (right < 0) return -1;
+         result = this->node (Node::kAlternate, result, right);
+      }
+      return result;
+   }
+
+   int sequence (const int depth)
+   {
+      int result = -1;
+      while (!this->atEnd() && (this->peek() != '|') && (this->peek() != ')')) {
+         const int item = this->repetition (depth);
+         if (item < 0) return -1;
+         result = (result < 0) ? item : this->node (Node::kConcat, result, item);
+      }
+      return (result < 0) ? this->node (Node::kEmpty) : result;
+   }
+
+   int repetition (const int depth)
+   {
+      int result = this->atom (depth);
+      while ((result >= 0) && !this->atEnd()) {
+         int min, max;
+         const char c = this->peek();
+         if (c == '*') {
+            min = 0;  max = -1;
+         } else if (c == '+') {
+            min = 1;  max = -1;
+         } else if (c == '?') {
+            min = 0;  max = 1;
+         } else if (c == '{') {
+            if (!this->bounds (min, max)) return -1;
+         } else {
+            break;
+         }
+         if (c != '{') this->m_pos++;
+
+         const int repeat = this->node (Node::kRepeat, result);
+         this->nodes[repeat].min = min;
+         this->nodes[repeat].max = max;
+         result = repeat;
+      }
+      return result;
+   }
+
+   // Parses {n}, {n,} or {n,m}.
+   //
+   bool bounds (int& min, int& max)
+   {
+      this->m_pos++;   // skip the {
+      min = this->number();
+      max = min;
+      if (!this->atEnd() && (this->peek() == ',')) {
+         this->m_pos++;
+         max = (!this->atEnd() && (this->peek() == '}')) ? -1 : this->number();
+      }
+      if (this->atEnd() || (this->peek() != '}')) {
+         this->failed ("invalid repetition");
+         return false;
+      }
+      this->m_pos++;
+      if ((min < 0) || (max < -1) || ((max >= 0) && (max < min)) ||
+          (min > maxRepeat) || (max > maxRepeat)) {
+         this->failed ("invalid repetition bounds");
+         return false;
+      }
+      return true;
+   }
+
+   int number ()
+   {
+      int result = -2;
+      while (!this->atEnd() && isdigit ((unsigned char) this->peek())) {
+         result = (result < 0 ? 0 : 10 * result) + (this->peek() - '0');
+         if (result > maxRepeat) result = maxRepeat + 1;
+         this->m_pos++;
+      }
+      return result;
+   }
+
+   int atom (const int depth)
+   {
+      const char c = this->peek();
+      ByteSet set;
+
+      switch (c) {
+         case '(':
+            {
+               if (depth >= maxDepth) return this->failed ("groups nested too deeply");
+               this->m_pos++;
+               const int result = this->alternation (depth + 1);
+               if (result < 0) return -1;
+               if (this->atEnd() || (this->peek() != ')')) return this->failed ("missing ')'");
+               this->m_pos++;
+               return result;
+            }
+
+         case '[':
+            this->m_pos++;
+            if (!this->byteClass (set)) return -1;
+            return this->setNode (set);
+
+         case '.':
+            this->m_pos++;
+            return this->setNode (set.set());
+
+         case '\\':
+            this->m_pos++;
+            if (this->atEnd()) return this->failed ("trailing '\\'");
+            this->escape (set);
+            return this->setNode (set);
+
+         case '*': case '+': case '?': case '{':
+            return this->failed (std::string ("nothing to repeat before '") + c + "'");
+
+         case '^': case '$':
+            return this->failed ("anchors are not supported, the whole value is matched");
+
+         default:
+            this->m_pos++;
+            set.set (uint8_t (c));
+            return this->setNode (set);
+      }
+   }
+
+   // Adds the escaped character (following the '\') to the set.
+   //
+   void escape (ByteSet& set)
+   {
+      const char c = this->m_source[this->m_pos++];
+      ByteSet named;
+      switch (tolower ((unsigned char) c)) {
+         case 'd':
+            for (int b = '0'; b <= '9'; b++) named.set (b);
+            break;
+         case 'w':
+            for (int b = 0; b < 256; b++) if (isalnum (b) || (b == '_')) named.set (b);
+            break;
+         case 's':
+            for (const char* ws = " \t\n\r\f\v"; *ws; ws++) named.set (uint8_t (*ws));
+            break;
+         default:
+            switch (c) {
+               case 'n': set.set ('\n'); break;
+               case 't': set.set ('\t'); break;
+               case 'r': set.set ('\r'); break;
+               default:  set.set (uint8_t (c)); break;
+            }
+            return;
+      }
+      set |= isupper ((unsigned char) c) ? ~named : named;
+   }
+
+   // Parses the class, following the '['.
+   //
+   bool byteClass (ByteSet& set)
+   {
+      const bool negate = !this->atEnd() && (this->peek() == '^');
+      if (negate) this->m_pos++;
+
+      bool first = true;
+      while (!this->atEnd() && ((this->peek() != ']') || first)) {
+         first = false;
+         if (this->peek() == '\\') {
+            this->m_pos++;
+            if (this->atEnd()) break;
+            ByteSet escaped;
+            this->escape (escaped);
+            set |= escaped;
+            continue;
+         }
+
+         const uint8_t low = uint8_t (this->m_source[this->m_pos++]);
+         if ((this->m_pos + 1 < this->m_source.size()) && (this->peek() == '-') &&
+             (this->m_source[this->m_pos + 1] != ']')) {
+            const uint8_t high = uint8_t (this->m_source[this->m_pos + 1]);
+            if (high < low) {
+               this->failed ("invalid class range");
+               return false;
+            }
+            for (int b = low; b <= high; b++) set.set (b);
+            this->m_pos += 2;
+         } else {
+            set.set (low);
+         }
+      }
+
+      if (this->atEnd()) {
+         this->failed ("missing ']'");
+         return false;
+      }
+      this->m_pos++;   // skip the ]
+      if (negate) set.flip();
+      return true;
+   }
+
+   const std::string& m_source;
+   size_t m_pos;
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::Pattern::Pattern (MemoryResource& resource) :
+   m_classCount (1),
+   m_next (Allocator<uint16_t> (&resource)),
+   m_accepting (Allocator<uint8_t> (&resource))
+{
+   memset (this->m_classOf, 0, sizeof (this->m_classOf));
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Pattern::~Pattern () { }
+
+//------------------------------------------------------------------------------
+// static
+Parsley::Pattern::Fragment
+Parsley::Pattern::build (const Syntax& syntax, const int index, std::vector<NfaState>& nfa)
+{
+   auto state = [&] (const int set, const int next) {
+      const NfaState item = { set, next, -1 };
+      nfa.push_back (item);
+      return int (nfa.size()) - 1;
+   };
+
+   const Node& node = syntax.nodes[index];
+   Fragment result;
+
+   switch (node.type) {
+      case Node::kSet:
+         result.end = state (-1, -1);
+         result.start = state (node.set, result.end);
+         break;
+
+      case Node::kConcat:
+         {
+            const Fragment left = build (syntax, node.left, nfa);
+            const Fragment right = build (syntax, node.right, nfa);
+            nfa[left.end].next = right.start;
+            result.start = left.start;
+            result.end = right.end;
+         }
+         break;
+
+      case Node::kAlternate:
+         {
+            const Fragment left = build (syntax, node.left, nfa);
+            const Fragment right = build (syntax, node.right, nfa);
+            result.end = state (-1, -1);
+            result.start = state (-1, left.start);
+            nfa[result.start].alt = right.start;
+            nfa[left.end].next = result.end;
+            nfa[right.end].next = result.end;
+         }
+         break;
+
+      case Node::kRepeat:
+         {
+            // The required copies, followed by either a loop or the optional
+            // copies. Declining any optional copy goes straight to the end,
+            // so that the DFA state sets remain small.
+            //
+            result.start = result.end = state (-1, -1);
+            for (int j = 0; j < node.min; j++) {
+               if (nfa.size() > maxNfaStates) break;
+               const Fragment item = build (syntax, node.left, nfa);
+               nfa[result.end].next = item.start;
+               result.end = item.end;
+            }
+
+            const int done = state (-1, -1);
+            if (node.max < 0) {
+               const Fragment item = build (syntax, node.left, nfa);
+               const int entry = state (-1, item.start);
+               nfa[entry].alt = done;
+               nfa[item.end].next = entry;
+               nfa[result.end].next = entry;
+            } else {
+               for (int j = node.min; j < node.max; j++) {
+                  if (nfa.size() > maxNfaStates) break;
+                  const Fragment item = build (syntax, node.left, nfa);
+                  const int entry = state (-1, item.start);
+                  nfa[entry].alt = done;
+                  nfa[result.end].next = entry;
+                  result.end = item.end;
+               }
+               nfa[result.end].next = done;
+            }
+            result.end = done;
+         }
+         break;
+
+      default:   // kEmpty
+         result.start = result.end = state (-1, -1);
+         break;
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+// Extends the states by those reached by epsilon transitions, and then
+// retains, in order, just those that consume a byte or accept. The states
+// reached are marked with the stamp, unique to each call, so that the marks
+// need not be cleared.
+//
+void Parsley::Pattern::closure (const std::vector<NfaState>& nfa, std::vector<int>& states,
+                                std::vector<int>& pending, std::vector<int>& reached,
+                                const int stamp)
+{
+   pending.assign (states.begin(), states.end());
+   states.clear();
+
+   while (!pending.empty()) {
+      const int s = pending.back();
+      pending.pop_back();
+      if ((s < 0) || (reached[s] == stamp)) continue;
+      reached[s] = stamp;
+
+      const NfaState& item = nfa[s];
+      if (item.set >= 0 || ((item.next < 0) && (item.alt < 0))) {
+         states.push_back (s);
+      } else {
+         pending.push_back (item.next);
+         pending.push_back (item.alt);
+      }
+   }
+   std::sort (states.begin(), states.end());
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::Pattern::compile (const std::string& source)
+{
+   Syntax syntax (source);
+   const int root = syntax.parse();
+   if (root < 0) return syntax.error;
+
+   std::vector<NfaState> nfa;
+   const Fragment whole = build (syntax, root, nfa);
+   if (nfa.size() > maxNfaStates) return "too complex";
+
+   // Partition the bytes into classes, refining by each byte set in turn.
+   //
+   memset (this->m_classOf, 0, sizeof (this->m_classOf));
+   size_t classes = 1;
+   for (const ByteSet& set : syntax.sets) {
+      std::vector<int> refined (2 * classes, -1);
+      size_t count = 0;
+      for (int b = 0; b < 256; b++) {
+         int& id = refined[2 * this->m_classOf[b] + (set[b] ? 1 : 0)];
+         if (id < 0) id = int (count++);
+         this->m_classOf[b] = uint8_t (id);
+      }
+      classes = count;
+   }
+   this->m_classCount = classes;
+
+   int representative [256];
+   for (int b = 255; b >= 0; b--) representative[this->m_classOf[b]] = b;
+
+   // Subset construction. The dead state's row, all zeros, comes first.
+   //
+   std::map<std::vector<int>, int> ids;
+   std::vector<std::vector<int> > states (2);
+   std::vector<int> pending;
+   std::vector<int> reached (nfa.size(), 0);
+   int stamp = 1;
+
+   states[1].push_back (whole.start);
+   closure (nfa, states[1], pending, reached, stamp++);
+   ids[states[1]] = 1;
+
+   std::vector<uint16_t> next (2 * classes, 0);
+   std::vector<int> target;
+   for (size_t d = 1; d < states.size(); d++) {
+      for (size_t c = 0; c < classes; c++) {
+         const int b = representative[c];
+         target.clear();
+         for (const int s : states[d]) {
+            const NfaState& item = nfa[s];
+            if ((item.set >= 0) && syntax.sets[item.set][b]) target.push_back (item.next);
+         }
+         closure (nfa, target, pending, reached, stamp++);
+         if (target.empty()) continue;
+
+         auto found = ids.find (target);
+         int id;
+         if (found != ids.end()) {
+            id = found->second;
+         } else {
+            if (states.size() >= maxDfaStates) return "too complex";
+            id = int (states.size());
+            ids[target] = id;
+            states.push_back (target);
+            next.resize (next.size() + classes, 0);
+         }
+         next[d * classes + c] = uint16_t (id);
+      }
+   }
+
+   this->m_next.assign (next.begin(), next.end());
+   this->m_accepting.assign (states.size(), 0);
+   for (size_t d = 1; d < states.size(); d++) {
+      this->m_accepting[d] = std::binary_search (states[d].begin(), states[d].end(),
+                                                 whole.end) ? 1 : 0;
+   }
+   return "";
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::Pattern::footprint () const
+{
+   return sizeof (Pattern) + heapBytes (this->m_next) + heapBytes (this->m_accepting);
+}
+
+
+//==============================================================================
+// Parsley::OptionSpec
+//==============================================================================
+// static
+std::string Parsley::OptionSpec::kindImage (const Kind kind)
+{
+   static const std::string images[] = { "flag", "string", "enumSpec", "integer", "real", "custom" };
+   return images[kind];
+}
+
+//------------------------------------------------------------------------------
+// Text pool support. The pool holds count + 1 offsets, relative to the start
+// of the items, followed by the null terminated items. The last offset is the
+// size of the items. Items are identified by a pointer and length.
+//
+typedef std::pair<const char*, size_t> TextSpan;
+
+static TextSpan textSpan (const char* str)         { return TextSpan (str, strlen (str)); }
+static TextSpan textSpan (const std::string& str)  { return TextSpan (str.data(), str.size()); }
+
+template <typename ItemFunction>
+static char* makeTextPool (Parsley::MemoryResource& resource,
+                           const size_t count, ItemFunction item)
+{
+   size_t itemsSize = 0;
+   for (size_t j = 0; j < count; j++) itemsSize += item (j).second + 1;
+
+   const size_t offsetsSize = (count + 1) * sizeof (uint32_t);
+   char* pool = static_cast<char*> (resource.allocate (offsetsSize + itemsSize,
+                                                       alignof (uint32_t)));
+   uint32_t* offsets = reinterpret_cast<uint32_t*> (pool);
+   char* items = pool + offsetsSize;
+
+   uint32_t offset = 0;
+   for (size_t j = 0; j < count; j++) {
+      const TextSpan value = item (j);
+      offsets[j] = offset;
+      memcpy (items + offset, value.first, value.second);
+      offset += uint32_t (value.second);
+      items[offset++] = '\0';
+   }
+   offsets[count] = offset;
+   return pool;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpec::OptionSpec (MemoryResource& resource,
+                                 const Kind kindIn,
+                                 const char* longNameIn,
+                                 const char shortNameIn,
+                                 const char* descriptionIn,
+                                 const bool isRequiredIn):
+   m_resource (&resource),
+   m_textPool (nullptr),
+   m_textCount (0),
+   m_kind (kindIn),
+   m_shortName (shortNameIn),
+   m_binding (kNotBound)
+{
+   const TextSpan initial [kFirstEnumOption] = {
+      textSpan (longNameIn), textSpan (descriptionIn), textSpan (""), textSpan (""),
+      textSpan (""), textSpan (""), textSpan ("")
+   };
+   this->setTextPool (makeTextPool (resource, kFirstEnumOption,
+                                    [&] (const size_t j) { return initial[j]; }),
+                      kFirstEnumOption);
+
+   this->m_isRequired = isRequiredIn;
+   this->m_isSingleton = false;
+   this->m_rangeIsDefined = false;
+   this->m_evIsDefined = false;
+   this->m_defaultIsDefined = false;
+   this->m_isFileValue = false;
+   this->m_isDynamic = false;
+   this->m_isHidden = false;
+   this->m_isNegatable = false;
+   this->m_isProfile = false;
+   this->m_isGlob = false;
+   this->m_pathChecks = 0;
+   this->m_minFreeSpace = 0;
+   this->m_bindTarget.pointer = nullptr;
+   this->m_bindConfig = nullptr;
+   this->m_customType = nullptr;
+
+   if (this->m_kind == kReal) {
+      this->m_minValue.r = 0.0;
+      this->m_maxValue.r = 0.0;
+      this->m_defaultValue.r = 0.0;
+   } else {
+      this->m_minValue.i = 0;
+      this->m_maxValue.i = 0;
+      this->m_defaultValue.i = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Clone/copy and existing spec - uses the same memory resource.
+//
+Parsley::OptionSpec::OptionSpec (const OptionSpec& other) :
+   m_resource (other.m_resource),
+   m_textPool (nullptr),
+   m_textCount (0),
+   m_kind (other.m_kind),
+   m_shortName (other.m_shortName),
+   m_binding (other.m_binding)
+{
+   // Copy the text pool as is.
+   //
+   const size_t size = other.textPoolSize();
+   char* pool = static_cast<char*> (this->m_resource->allocate (size, alignof (uint32_t)));
+   memcpy (pool, other.m_textPool, size);
+   this->setTextPool (pool, other.m_textCount);
+
+   this->m_minValue = other.m_minValue;
+   this->m_maxValue = other.m_maxValue;
+   this->m_defaultValue = other.m_defaultValue;
+
+   this->m_isRequired = other.m_isRequired;
+   this->m_isSingleton = other.m_isSingleton;
+   this->m_rangeIsDefined = other.m_rangeIsDefined;
+   this->m_evIsDefined = other.m_evIsDefined;
+   this->m_defaultIsDefined = other.m_defaultIsDefined;
+   this->m_isFileValue = other.m_isFileValue;
+   this->m_isDynamic = other.m_isDynamic;
+   this->m_isHidden = other.m_isHidden;
+   this->m_isNegatable = other.m_isNegatable;
+   this->m_isProfile = other.m_isProfile;
+   this->m_isGlob = other.m_isGlob;
+   this->m_pathChecks = other.m_pathChecks;
+   this->m_minFreeSpace = other.m_minFreeSpace;
+   this->m_bindTarget = other.m_bindTarget;
+   this->m_bindConfig = other.m_bindConfig;
+   this->m_customType = other.m_customType;
+   this->m_pattern = other.m_pattern;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpec::~OptionSpec ()
+{
+   this->setTextPool (nullptr, 0);
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::OptionSpec::textPoolSize () const
+{
+   if (!this->m_textPool) return 0;
+   const uint32_t* offsets = reinterpret_cast<const uint32_t*> (this->m_textPool);
+   return (this->m_textCount + 1) * sizeof (uint32_t) + offsets[this->m_textCount];
+}
+
+//------------------------------------------------------------------------------
+// Takes ownership of the new pool, and frees the old one.
+//
+void Parsley::OptionSpec::setTextPool (char* pool, const uint32_t count)
+{
+   if (this->m_textPool) {
+      this->m_resource->deallocate (this->m_textPool, this->textPoolSize(),
+                                    alignof (uint32_t));
+   }
+   this->m_textPool = pool;
+   this->m_textCount = count;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::OptionSpec::replaceText (const int item, const char* value,
+                                       const size_t length)
+{
+   const TextSpan replacement (value, length);
+   char* pool = makeTextPool (*this->m_resource, this->m_textCount,
+                              [&] (const size_t j) {
+      return int (j) == item ? replacement : TextSpan (this->text (int (j)),
+                                                       this->textLength (int (j)));
+   });
+   this->setTextPool (pool, this->m_textCount);
+}
+
+//------------------------------------------------------------------------------
+//
+template <typename Iterator>
+void Parsley::OptionSpec::addEnumOptions (Iterator first, Iterator last)
+{
+   const size_t fixed = this->m_textCount;
+   const size_t count = fixed + size_t (std::distance (first, last));
+   char* pool = makeTextPool (*this->m_resource, count,
+                              [&] (const size_t j) {
+      return j < fixed ? TextSpan (this->text (int (j)), this->textLength (int (j)))
+                       : textSpan (*(first + (j - fixed)));
+   });
+   this->setTextPool (pool, uint32_t (count));
+}
+
+//------------------------------------------------------------------------------
+//
+const char* Parsley::OptionSpec::text (const int item) const
+{
+   const uint32_t* offsets = reinterpret_cast<const uint32_t*> (this->m_textPool);
+   const char* items = this->m_textPool + (this->m_textCount + 1) * sizeof (uint32_t);
+   return items + offsets[item];
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::OptionSpec::textLength (const int item) const
+{
+   const uint32_t* offsets = reinterpret_cast<const uint32_t*> (this->m_textPool);
+   return offsets[item + 1] - offsets[item] - 1;
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::textStr (const int item) const
+{
+   return std::string (this->text (item), this->textLength (item));
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::OptionSpec::enumCount () const
+{
+   return int (this->m_textCount) - kFirstEnumOption;
+}
+
+//------------------------------------------------------------------------------
+// Returns 0 .. enumCount-1 if value is found, otherwise -1.
+//
+int Parsley::OptionSpec::enumIndex (const char* value, const size_t length) const
+{
+   const int number = this->enumCount();
+   for (int j = 0; j < number; j++) {
+      const int item = kFirstEnumOption + j;
+      if ((this->textLength (item) == length) &&
+          (memcmp (this->text (item), value, length) == 0)) {
+         return j;
+      }
+   }
+   return -1;
+}
+
+
+//------------------------------------------------------------------------------
+// Note on defval/range/envVar - we need to create a new object
+// (which is a clone of the original) and we return a shared pointer.
+//
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::defStr (const std::string& defValue)
+{
+   return this->withDefStr (defValue.data(), defValue.size());
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::defStr (const char* defValue)
+{
+   return this->withDefStr (defValue, strlen (defValue));
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::withDefStr (const char* defValue, const size_t length)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   CustomValue value;
+   if (clone->m_kind != kStr && clone->m_kind != kEnum && clone->m_kind != kCustom) {
+      warning ("default string value for " + this->info() + " ignored.");
+   } else if (clone->m_defaultIsDefined) {
+      warning ("secondary default value for " + this->info() + " ignored.");
+   } else if ((clone->m_kind == kEnum) &&
+              (clone->enumIndex (defValue, length) == -1)) {
+      warning ("the default value for " + this->info() + " is not an allowed value.");
+   } else if ((clone->m_kind == kCustom) &&
+              !clone->m_customType->parse (defValue, length, &value)) {
+      warning ("the default value for " + this->info() + " is not a valid value.");
+   } else {
+      if (clone->m_pattern && !clone->m_pattern->matches (defValue, length)) {
+         warning ("the default value for " + this->info() + " does not match the pattern.");
+      }
+      clone->replaceText (kDefaultStr, defValue, length);
+      clone->m_defaultIsDefined = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::defInt (const intp_t defValue)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kInt) {
+      warning ("default integer value for " + this->info() + " ignored.");
+   } else if (clone->m_defaultIsDefined) {
+      warning ("secondary default value for " + this->info() + " ignored.");
+   } else {
+      if (clone->m_rangeIsDefined && (defValue < clone->m_minValue.i || defValue > clone->m_maxValue.i)) {
+         warning ("the default value for " + this->info() + " is out of range.");
+      }
+      clone->m_defaultValue.i = defValue;
+      clone->m_defaultIsDefined = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::intRange (const intp_t min, const intp_t max)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kInt) {
+      warning ("integer range constraint for " + this->info() + " ignored.");
+   } else if (clone->m_rangeIsDefined) {
+      warning ("secondary range constraint for " + this->info() + " ignored.");
+   } else {
+      if (clone->m_defaultIsDefined && (clone->m_defaultValue.i < min || clone->m_defaultValue.i > max)) {
+         warning ("the default value for " + this->info() + " is out of range.");
+      }
+      clone->m_minValue.i = min;
+      clone->m_maxValue.i = max;
+      clone->m_rangeIsDefined = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+// The compiled pattern is shared by any clones of the specification.
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::pattern (const std::string& regex)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kStr) {
+      warning ("pattern constraint for " + this->info() + " ignored.");
+   } else if (clone->m_pattern) {
+      warning ("secondary pattern constraint for " + this->info() + " ignored.");
+   } else {
+      std::shared_ptr<Pattern> compiled = std::allocate_shared<Pattern>
+            (Allocator<Pattern> (this->m_resource), *this->m_resource);
+      const std::string error = compiled->compile (regex);
+      if (!error.empty()) {
+         warning ("invalid pattern '" + regex + "' for " + this->info() + " ignored: " + error);
+      } else {
+         if (clone->m_defaultIsDefined &&
+             !compiled->matches (this->text (kDefaultStr), this->textLength (kDefaultStr))) {
+            warning ("the default value for " + this->info() + " does not match the pattern.");
+         }
+         clone->replaceText (kPattern, regex.data(), regex.size());
+         clone->m_pattern = compiled;
+      }
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::checkPath (const unsigned checks)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   const unsigned combined = clone->m_pathChecks | checks;
+   if ((clone->m_kind != kStr) || !clone->m_isFileValue) {
+      warning ("path checks for " + this->info() + " ignored.");
+   } else if ((combined & kPathIsFile) && (combined & kPathIsDirectory)) {
+      warning ("conflicting path checks for " + this->info() + " ignored.");
+   } else {
+      clone->m_pathChecks = uint8_t (combined);
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::minFreeSpace (const uint64_t bytes)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if ((clone->m_kind != kStr) || !clone->m_isFileValue) {
+      warning ("free space check for " + this->info() + " ignored.");
+   } else {
+      clone->m_minFreeSpace = bytes;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::glob ()
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if ((clone->m_kind != kStr) || !clone->m_isFileValue) {
+      warning ("glob for " + this->info() + " ignored.");
+   } else {
+      clone->m_isGlob = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::defReal (const double defValue)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kReal) {
+      warning ("default real value for " + this->info() + " ignored.");
+   } else if (clone->m_defaultIsDefined) {
       warning ("secondary default value for " + this->info() + " ignored.");
-   } else if ((clone->m_kind == kEnum) &&
-              (Parsley::indexOf(clone->m_enumOptions, defValue) == -1)) {
-      warning ("the default value for " + this->info() + " is not an allowed value.");
    } else {
-      clone->m_defaultStr = defValue;
-      clone->m_defaultIsDefined = true;
+      if (clone->m_rangeIsDefined && (defValue < clone->m_minValue.r || defValue > clone->m_maxValue.r)) {
+         warning ("the default value for " + this->info() + " is out of range.");
+      }
+      clone->m_defaultValue.r = defValue;
+      clone->m_defaultIsDefined = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::defFlag (const bool defValue)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   // Note: a flag's default is always defined, implicitly as off.
+   //
+   if (clone->m_kind != kFlag) {
+      warning ("default flag value for " + this->info() + " ignored.");
+   } else {
+      clone->m_defaultValue.i = defValue ? 1 : 0;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::realRange (const double min, const double max)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kReal) {
+      warning ("real range constraint for " + this->info() + " ignored.");
+   } else if (clone->m_rangeIsDefined) {
+      warning ("secondary range constraint for " + this->info() + " ignored.");
+   } else {
+      if (clone->m_defaultIsDefined && (clone->m_defaultValue.r < min || clone->m_defaultValue.r > max)) {
+         warning ("the default value for " + this->info() + " is out of range.");
+      }
+      clone->m_minValue.r = min;
+      clone->m_maxValue.r = max;
+      clone->m_rangeIsDefined = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::envVar (const std::string& envVarName)
+{
+   return this->withEnvVar (envVarName.data(), envVarName.size());
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::envVar (const char* envVarName)
+{
+   return this->withEnvVar (envVarName, strlen (envVarName));
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::withEnvVar (const char* envVarName, const size_t length)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_evIsDefined) {
+      warning ("secondary environment variable for " + this->info() + " ignored.");
+   } else {
+      clone->replaceText (kEvName, envVarName, length);
+      clone->m_evIsDefined = (length > 0);
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::fileValue ()
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kStr && clone->m_kind != kCustom) {
+      warning ("file value for " + this->info() + " ignored.");
+   } else {
+      clone->m_isFileValue = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::dynamicValues ()
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind == kFlag) {
+      warning ("dynamic values for " + this->info() + " ignored.");
+   } else {
+      clone->m_isDynamic = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::alias (const std::string& longName)
+{
+   return this->withName (kAliases, longName);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::deprecated (const std::string& longName)
+{
+   return this->withName (kDeprecated, longName);
+}
+
+//------------------------------------------------------------------------------
+// Appends the name to the space separated names of the item.
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::withName (const int item, const std::string& longName)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (longName.empty() || (longName.find (' ') != std::string::npos)) {
+      warning ("invalid name '" + longName + "' for " + this->info() + " ignored.");
+   } else {
+      std::string names = this->textStr (item);
+      if (!names.empty()) names += ' ';
+      names += longName;
+      clone->replaceText (item, names.data(), names.size());
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::negatable ()
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   if (clone->m_kind != kFlag) {
+      warning ("negation of " + this->info() + " ignored.");
+   } else {
+      clone->m_isNegatable = true;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::bind (bool* target)
+{
+   BindTarget bindTarget;
+   bindTarget.pointer = target;
+   return this->withBinding (kBindBool, bindTarget, nullptr);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::bind (intp_t* target)
+{
+   BindTarget bindTarget;
+   bindTarget.pointer = target;
+   return this->withBinding (kBindInt, bindTarget, nullptr);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::bind (double* target)
+{
+   BindTarget bindTarget;
+   bindTarget.pointer = target;
+   return this->withBinding (kBindReal, bindTarget, nullptr);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer Parsley::OptionSpec::bind (std::string* target)
+{
+   BindTarget bindTarget;
+   bindTarget.pointer = target;
+   return this->withBinding (kBindStr, bindTarget, nullptr);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::withBinding (const Binding binding, const BindTarget target,
+                                  const void* config)
+{
+   std::shared_ptr<SharedSpec> clone = SharedSpec::make (this->m_resource, *this);
+
+   bool suitable = false;
+   switch (clone->m_kind) {
+      case kFlag:  suitable = (binding == kBindBool);  break;
+      case kStr:   suitable = (binding == kBindStr);   break;
+      case kEnum:  suitable = (binding == kBindStr) || (binding == kBindInt);  break;
+      case kInt:   suitable = (binding == kBindInt);   break;
+      case kReal:  suitable = (binding == kBindReal);  break;
+      case kCustom:  break;
+   }
+
+   if (clone->m_binding != kNotBound) {
+      warning ("secondary binding for " + this->info() + " ignored.");
+   } else if (!suitable) {
+      warning ("binding for " + this->info() + " is not of a suitable type - ignored.");
+   } else {
+      clone->m_binding = binding;
+      clone->m_bindTarget = target;
+      clone->m_bindConfig = config;
+   }
+
+   return clone;
+}
+
+//------------------------------------------------------------------------------
+// The default is held as text, as for enumerations.
+//
+Parsley::OptionSpecPointer
+Parsley::OptionSpec::withDefCustom (const CustomType* type, const std::string& defValue)
+{
+   if ((this->m_kind == kCustom) && (type != this->m_customType)) {
+      warning ("default value of another type for " + this->info() + " ignored.");
+      return SharedSpec::make (this->m_resource, *this);
+   }
+   return this->withDefStr (defValue.data(), defValue.size());
+}
+
+//------------------------------------------------------------------------------
+// Members may only be resolved when there is a configuration struct.
+//
+void* Parsley::OptionSpec::bindingTarget (void* config) const
+{
+   if (this->m_binding == kNotBound) return nullptr;
+   if (!this->m_bindConfig) return this->m_bindTarget.pointer;
+   if (!config) return nullptr;
+   return static_cast<char*> (config) + this->m_bindTarget.offset;
+}
+
+//------------------------------------------------------------------------------
+// Used for the error message.
+//
+std::string Parsley::OptionSpec::name() const
+{
+   if (this->m_shortName != '\0') {
+      return std::string ("-") + this->m_shortName + ", --" + this->textStr (kLongName);
+   } else {
+      return "--" + this->textStr (kLongName);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::range() const
+{
+   if ((this->m_kind != kInt) && (this->m_kind != kReal)) return "";
+   if (!this->m_rangeIsDefined) return "";
+
+   std::string v1;
+   std::string v2;
+
+   if (this->m_kind == kInt) {
+      v1 = int2str (this->m_minValue.i);
+      v2 = int2str (this->m_maxValue.i);
+   } else if (this->m_kind == kReal) {
+      v1 = real2str (this->m_minValue.r);
+      v2 = real2str (this->m_maxValue.r);
+   }
+
+   char buffer [40];
+   snprintf (buffer, sizeof(buffer), "%s to %s", v1.c_str(), v2.c_str());
+   return std::string (buffer);
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::enum_set() const
+{
+   if (this->m_kind != kEnum) return "(nil)";
+
+   std::string result = "(";
+   for (int j = 0; j < this->enumCount(); j++) {
+      if (j > 0) result += ", ";
+      result += this->text (kFirstEnumOption + j);
+   }
+   return result + ")";
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::info () const
+{
+   const std::string image = (this->m_kind == kCustom) ? this->m_customType->name ()
+                                                       : kindImage (this->m_kind);
+   return "the " + image + " option '" + this->textStr (kLongName) + '\'';
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::helpConstraint () const
+{
+   std::string result = "";
+
+   switch (this->m_kind) {
+      case kEnum:
+         result = "Allowed values: " + this->enum_set() + ". ";
+         break;
+
+      case kReal:
+      case kInt:
+         if (this->m_rangeIsDefined) {
+            result = "Range: " + this->range() + ". ";
+         }
+         break;
+
+      case kStr:
+         if (this->m_pattern) {
+            result = "Pattern: " + this->textStr (kPattern) + ". ";
+         }
+         if (this->m_isGlob) {
+            result += "The value may be a glob pattern. ";
+         }
+         if (this->m_pathChecks || this->m_minFreeSpace) {
+            static const struct { unsigned check; const char* image; } images [] = {
+               { kPathExists, "exist" }, { kPathIsFile, "be a file" },
+               { kPathIsDirectory, "be a directory" }, { kPathReadable, "be readable" },
+               { kPathWritable, "be writable" }
+            };
+            std::string checks;
+            for (const auto& item : images) {
+               if (!(this->m_pathChecks & item.check)) continue;
+               checks += (checks.empty() ? "" : ", ") + std::string (item.image);
+            }
+            if (this->m_minFreeSpace) {
+               checks += (checks.empty() ? "have " : ", have ") +
+                         std::to_string (this->m_minFreeSpace) + " bytes free";
+            }
+            result += "The path must " + checks + ". ";
+         }
+         break;
+
+      default:
+         break;
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::helpDefault () const
+{
+   if (!this->m_defaultIsDefined) return "";
+
+   std::string result = "Default value: ";
+
+   switch (this->m_kind) {
+      case kFlag:
+         result += this->m_defaultValue.i ? "on" : "off";
+         break;
+
+      case kStr:
+      case kEnum:
+         result += "'" + this->textStr (kDefaultStr) + "'";
+         break;
+
+      case kInt:
+         result += int2str (this->m_defaultValue.i);
+         break;
+
+      case kReal:
+         result += real2str (this->m_defaultValue.r);
+         break;
+
+      case kCustom:
+         {
+            // Shown in the type's own format.
+            //
+            CustomValue value;
+            if (this->m_customType->parse (this->text (kDefaultStr),
+                                           this->textLength (kDefaultStr), &value)) {
+               result += "'" + this->m_customType->format (&value) + "'";
+            } else {
+               result += "'" + this->textStr (kDefaultStr) + "'";
+            }
+         }
+         break;
+   }
+   result += ". ";
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::OptionSpec::helpEnvVar (const std::string& name) const
+{
+   if (name.empty()) return "";
+
+   std::string result = "Use the " + name + " environment variable to ";
+
+   if (this->m_defaultIsDefined) {
+      result += "override the default value. ";
+   } else {
+      result += "provide a default value. ";
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// The deprecated names are not listed.
+//
+std::string Parsley::OptionSpec::helpAliases () const
+{
+   std::string names;
+   this->forEachName (kAliases, [&] (const char* name, const size_t length) {
+      names += (names.empty() ? "--" : ", --") + std::string (name, length);
+   });
+   if (this->m_isNegatable) {
+      names += (names.empty() ? "--no-" : ", --no-") + this->textStr (kLongName);
+   }
+
+   if (names.empty()) return "";
+   return "Aliases: " + names + ". ";
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::OptionSpec::footprint () const
+{
+   const size_t pattern = this->m_pattern ? this->m_pattern->footprint() + sharedControlBytes : 0;
+   return sizeof (OptionSpec) + this->textPoolSize() + pattern;
+}
+
+
+//==============================================================================
+// Parsley::OptionValue
+//==============================================================================
+//
+Parsley::OptionValue::OptionValue ()
+{
+   this->isDefined = false;
+   this->flag = false;
+   this->str = "";
+   this->ival = 0;
+   this->real = 0.0;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValue::~OptionValue () {}
+
+
+//==============================================================================
+// Parsley::NameIndex
+//==============================================================================
+// An open addressing hash table mapping long names to slots, plus a direct
+// look up table for the short names. Lookups take a pointer and length so
+// that no std::string need be constructed when processing arguments.
+// The long names are held end to end in a single pooled string.
+//
+// The index of a parser formed from option groups is merged from the groups'
+// indexes: their pooled names are appended, and their entries inserted using
+// the hashes already calculated, so no name is hashed again.
+//
+// An option may have several long names - aliases, deprecated names and the
+// negation of a flag - each entry mapping directly to the option's slot and
+// noting which kind of name it is, so no further lookup is needed.
+//
+class Parsley::NameIndex {
+public:
+   enum NameKind : uint8_t {
+      kName = 0,     // the option's long name
+      kAlias,
+      kDeprecated,
+      kNegation      // --no-<name>
+   };
+
+   NameIndex (const size_t expected, MemoryResource& resource);
+   ~NameIndex ();
+
+   // Both insert functions return -1 if successful, otherwise the slot
+   // of the existing conflicting entry.
+   //
+   int insertLong (const char* name, const size_t length, const int slot,
+                   const NameKind kind = kName);
+   int insertShort (const char shortName, const int slot);
+
+   int findLong (const char* name, const size_t length) const;
+   int findLong (const char* name, const size_t length, NameKind& kind) const;
+   int findShort (const char shortName) const;
+
+   // Merges the names of a group's index, the group's first option being at
+   // firstSlot. Calls conflict (existingSlot, slot) for each conflicting name.
+   //
+   template <typename Function>
+   void merge (const NameIndex& part, const int firstSlot, Function conflict);
+
+   // Calls function (slot) for each option's long name (not its other names)
+   // that starts with the prefix, in slot order. The names are contiguous
+   // within the pool, so a single pass over them costs less than building a
+   // trie for the one query a completion request makes.
+   //
+   template <typename Function>
+   void matchLong (const char* prefix, const size_t length, Function function) const
+   {
+      const char* pool = this->m_pool.data();
+      for (const Entry& entry : this->m_entries) {
+         if ((entry.kind == kName) && (entry.length >= length) &&
+             (memcmp (pool + entry.offset, prefix, length) == 0)) {
+            function (entry.slot);
+         }
+      }
+   }
+
+   size_t footprint () const;   // including the object itself
+
+private:
+   static uint32_t hash (const char* name, const size_t length);
+
+   int findHashed (const char* name, const size_t length, const uint32_t h) const;
+   int insertHashed (const char* name, const size_t length, const uint32_t h,
+                     const int slot, const NameKind kind);
+
+   // The hash of, and the location within the pool of, a long name, together
+   // with the option's slot.
+   //
+   struct Entry {
+      uint32_t hash;
+      uint32_t offset;
+      uint32_t length;
+      int slot;
+      NameKind kind;
+   };
+
+   std::vector<char, Allocator<char> > m_pool;      // the long names, end to end
+   std::vector<Entry, Allocator<Entry> > m_entries; // in order of insertion
+   std::vector<int, Allocator<int> > m_table;       // entry or -1, size is a power of 2
+   size_t m_mask;
+   int m_short [256];
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::NameIndex::NameIndex (const size_t expected, MemoryResource& resource) :
+   m_pool (Allocator<char> (&resource)),
+   m_entries (Allocator<Entry> (&resource)),
+   m_table (Allocator<int> (&resource))
+{
+   size_t size = 16;
+   while (size < 2 * expected) size *= 2;   // load factor <= 0.5
+
+   this->m_table.assign (size, -1);
+   this->m_mask = size - 1;
+   this->m_entries.reserve (expected);
+
+   for (int j = 0; j < 256; j++) this->m_short[j] = -1;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::NameIndex::~NameIndex () { }
+
+//------------------------------------------------------------------------------
+// static - FNV-1a
+uint32_t Parsley::NameIndex::hash (const char* name, const size_t length)
+{
+   uint32_t result = 2166136261u;
+   for (size_t j = 0; j < length; j++) {
+      result ^= (unsigned char) name[j];
+      result *= 16777619u;
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::insertLong (const char* name, const size_t length,
+                                    const int slot, const NameKind kind)
+{
+   return this->insertHashed (name, length, hash (name, length), slot, kind);
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::insertHashed (const char* name, const size_t length,
+                                      const uint32_t h, const int slot,
+                                      const NameKind kind)
+{
+   const int existing = this->findHashed (name, length, h);
+   if (existing >= 0) return this->m_entries[existing].slot;
+
+   // Keep the load factor <= 0.5 - an option may have any number of names.
+   //
+   if (2 * (this->m_entries.size() + 1) > this->m_table.size()) {
+      const size_t size = 2 * this->m_table.size();
+      this->m_table.assign (size, -1);
+      this->m_mask = size - 1;
+      for (size_t j = 0; j < this->m_entries.size(); j++) {
+         size_t pos = this->m_entries[j].hash & this->m_mask;
+         while (this->m_table[pos] >= 0) pos = (pos + 1) & this->m_mask;
+         this->m_table[pos] = int (j);
+      }
+   }
+
+   const Entry entry = { h, uint32_t (this->m_pool.size()), uint32_t (length), slot, kind };
+   this->m_pool.insert (this->m_pool.end(), name, name + length);
+
+   size_t pos = h & this->m_mask;
+   while (this->m_table[pos] >= 0) pos = (pos + 1) & this->m_mask;
+   this->m_table[pos] = int (this->m_entries.size());
+   this->m_entries.push_back (entry);
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::insertShort (const char shortName, const int slot)
+{
+   if (shortName == '\0') return -1;   // no short name
+
+   const unsigned char key = (unsigned char) shortName;
+   if (this->m_short[key] >= 0) return this->m_short[key];
+   this->m_short[key] = slot;
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::findLong (const char* name, const size_t length) const
+{
+   const int found = this->findHashed (name, length, hash (name, length));
+   return (found < 0) ? -1 : this->m_entries[found].slot;
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::findLong (const char* name, const size_t length,
+                                  NameKind& kind) const
+{
+   const int found = this->findHashed (name, length, hash (name, length));
+   if (found < 0) return -1;
+   kind = this->m_entries[found].kind;
+   return this->m_entries[found].slot;
+}
+
+//------------------------------------------------------------------------------
+// Returns the entry, or -1.
+//
+int Parsley::NameIndex::findHashed (const char* name, const size_t length,
+                                    const uint32_t h) const
+{
+
+   size_t pos = h & this->m_mask;
+   while (true) {
+      const int found = this->m_table[pos];
+      if (found < 0) return -1;
+
+      const Entry& entry = this->m_entries[found];
+      if ((entry.hash == h) &&
+          (entry.length == length) &&
+          (memcmp (this->m_pool.data() + entry.offset, name, length) == 0)) {
+         return found;
+      }
+      pos = (pos + 1) & this->m_mask;
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+int Parsley::NameIndex::findShort (const char shortName) const
+{
+   if (shortName == '\0') return -1;
+   return this->m_short[(unsigned char) shortName];
+}
+
+//------------------------------------------------------------------------------
+//
+template <typename Function>
+void Parsley::NameIndex::merge (const NameIndex& part, const int firstSlot,
+                                Function conflict)
+{
+   const char* pool = part.m_pool.data();
+   this->m_pool.reserve (this->m_pool.size() + part.m_pool.size());
+
+   // Long name conflicts with the same option are reported once only.
+   //
+   int lastConflict = -1;
+   for (const Entry& entry : part.m_entries) {
+      const int slot = firstSlot + entry.slot;
+      const int existing = this->insertHashed (pool + entry.offset, entry.length,
+                                               entry.hash, slot, entry.kind);
+      if ((existing >= 0) && (slot != lastConflict)) {
+         conflict (existing, slot);
+         lastConflict = slot;
+      }
+   }
+
+   // As for a long name conflict, if with the same option.
+   //
+   for (int j = 0; j < 256; j++) {
+      const int slot = part.m_short[j];
+      if (slot < 0) continue;
+      const int existing = this->insertShort (char (j), firstSlot + slot);
+      if (existing < 0) continue;
+
+      bool isSameOption = false;
+      for (const Entry& entry : part.m_entries) {
+         if ((entry.slot == slot) && (entry.kind == kName)) {
+            const int found = this->findHashed (pool + entry.offset, entry.length,
+                                                entry.hash);
+            isSameOption = (found >= 0) && (this->m_entries[found].slot == existing);
+            break;
+         }
+      }
+      if (!isSameOption) conflict (existing, firstSlot + slot);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::NameIndex::footprint () const
+{
+   return sizeof (NameIndex) +
+         heapBytes (this->m_pool) +
+         heapBytes (this->m_entries) +
+         heapBytes (this->m_table);
+}
+
+
+//==============================================================================
+// Parsley::OptionGroup
+//==============================================================================
+//
+Parsley::OptionGroup::OptionGroup (const std::string& title,
+                                   const OptionSpecifications& specList,
+                                   MemoryResource& resource) :
+   m_title (title),
+   m_specs (Allocator<OptionSpecPointer> (&resource))
+{
+   this->m_isOkay = true;
+   this->m_outOfMemory = false;
+
+#if defined(PARSLEY_EXCEPTIONS)
+   try {
+      this->m_specs.assign (specList.begin(), specList.end());
+      this->m_index = buildIndex (this->m_specs, resource, this->m_isOkay);
+   } catch (const std::bad_alloc&) {
+      this->m_specs.clear ();
+      this->m_isOkay = false;
+      this->m_outOfMemory = true;
+   }
+#else
+   this->m_specs.assign (specList.begin(), specList.end());
+   this->m_index = buildIndex (this->m_specs, resource, this->m_isOkay);
+#endif
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionGroup::~OptionGroup () { }
+
+//------------------------------------------------------------------------------
+//
+const std::string& Parsley::OptionGroup::title () const
+{
+   return this->m_title;
+}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::OptionGroup::size () const
+{
+   return this->m_specs.size();
+}
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::OptionGroup::isOkay () const
+{
+   return this->m_isOkay;
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::OptionGroupPointer
+Parsley::optionGroup (const std::string& title, const OptionSpecifications& specList)
+{
+   return std::make_shared<const OptionGroup> (title, specList);
+}
+
+
+//==============================================================================
+// Parsley::Constraint
+//==============================================================================
+//
+Parsley::Constraint::Constraint (const Kind kind, const OptionNames& options) :
+   m_kind (kind),
+   m_options (options) { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::Constraint::~Constraint () { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::Constraint::Kind Parsley::Constraint::kind () const
+{
+   return this->m_kind;
+}
+
+//------------------------------------------------------------------------------
+//
+const Parsley::OptionNames& Parsley::Constraint::options () const
+{
+   return this->m_options;
+}
+
+//------------------------------------------------------------------------------
+// e.g. "--a, --b or --c"
+//
+static std::string nameList (Parsley::OptionNames::const_iterator first,
+                             Parsley::OptionNames::const_iterator last,
+                             const char* conjunction)
+{
+   std::string result;
+   for (Parsley::OptionNames::const_iterator item = first; item != last; ++item) {
+      if (item != first) result += (item + 1 == last) ? conjunction : ", ";
+      result += "--" + *item;
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::Constraint::image () const
+{
+   const OptionNames& names = this->m_options;
+
+   switch (this->m_kind) {
+      case kDependsOn:
+         if (names.empty()) break;
+         return "--" + names.front() + " requires " +
+                nameList (names.begin() + 1, names.end(), " and ") + ".";
+
+      case kConflicting:
+         return nameList (names.begin(), names.end(), " and ") +
+                " may not be used together.";
+
+      case kExactlyOneOf:
+         return "exactly one of " + nameList (names.begin(), names.end(), " or ") +
+                " is required.";
+
+      case kAtLeastOneOf:
+         return "at least one of " + nameList (names.begin(), names.end(), " or ") +
+                " is required.";
+   }
+   return "";
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::ConstraintPointer
+Parsley::dependsOn (const std::string& option, const OptionNames& others)
+{
+   OptionNames names (1, option);
+   names.insert (names.end(), others.begin(), others.end());
+   return std::make_shared<const Constraint> (Constraint::kDependsOn, names);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::ConstraintPointer Parsley::conflicting (const OptionNames& options)
+{
+   return std::make_shared<const Constraint> (Constraint::kConflicting, options);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::ConstraintPointer Parsley::exactlyOneOf (const OptionNames& options)
+{
+   return std::make_shared<const Constraint> (Constraint::kExactlyOneOf, options);
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::ConstraintPointer Parsley::atLeastOneOf (const OptionNames& options)
+{
+   return std::make_shared<const Constraint> (Constraint::kAtLeastOneOf, options);
+}
+
+
+//==============================================================================
+// Parsley::Profile
+//==============================================================================
+//
+Parsley::Profile::Profile (const std::string& name, const std::string& description,
+                           const Settings& settings) :
+   m_name (name),
+   m_description (description),
+   m_settings (settings) { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::Profile::~Profile () { }
+
+//------------------------------------------------------------------------------
+//
+const std::string& Parsley::Profile::name () const
+{
+   return this->m_name;
+}
+
+//------------------------------------------------------------------------------
+//
+const std::string& Parsley::Profile::description () const
+{
+   return this->m_description;
+}
+
+//------------------------------------------------------------------------------
+//
+const Parsley::Profile::Settings& Parsley::Profile::settings () const
+{
+   return this->m_settings;
+}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::ProfilePointer
+Parsley::profile (const std::string& name, const std::string& description,
+                  const Profile::Settings& settings)
+{
+   return std::make_shared<Profile> (name, description, settings);
+}
+
+
+//==============================================================================
+// Parsley::OptionView
+//==============================================================================
+//
+Parsley::OptionView::OptionView ()
+{
+   this->isDefined = false;
+   this->flag = false;
+   this->str = "";
+   this->length = 0;
+   this->ival = 0;
+   this->real = 0.0;
+   this->custom = nullptr;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionView::~OptionView () {}
+
+
+//==============================================================================
+// Parsley::OptionValues
+//==============================================================================
+//
+Parsley::OptionValues::OptionValues () :
+   m_arena (nullptr) {}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValues::OptionValues (MemoryResource& resource) :
+   m_slots (Allocator<Slot> (&resource)),
+   m_text (Allocator<char> (&resource)),
+   m_arena (nullptr) {}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValues::OptionValues (MonotonicArena& arena) :
+   m_slots (Allocator<Slot> (&arena)),
+   m_text (Allocator<char> (&arena)),
+   m_arena (&arena) {}
+
+//------------------------------------------------------------------------------
+// The copy uses the default resource (select_on_container_copy_construction).
+//
+Parsley::OptionValues::OptionValues (const OptionValues& other) :
+   m_index (other.m_index),
+   m_slots (other.m_slots),
+   m_text (other.m_text),
+   m_arena (nullptr) {}
+
+//------------------------------------------------------------------------------
+// Assignment retains this object's own resource.
+//
+Parsley::OptionValues&
+Parsley::OptionValues::operator= (const OptionValues& other)
+{
+   if (this != &other) {
+      this->m_index = other.m_index;
+      this->m_slots.assign (other.m_slots.begin(), other.m_slots.end());
+      this->m_text.assign (other.m_text.begin(), other.m_text.end());
+   }
+   return *this;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValues::~OptionValues () {}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::OptionValues::reset ()
+{
+   this->m_index.reset();
+
+   // Swapping with empty containers, using the same resource, frees the
+   // storage before any release of the arena.
+   //
+   Slots (this->m_slots.get_allocator()).swap (this->m_slots);
+   Text (this->m_text.get_allocator()).swap (this->m_text);
+
+   if (this->m_arena) this->m_arena->release();
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValue
+Parsley::OptionValues::operator[] (const std::string& option) const
+{
+   const OptionView item = this->view (option.c_str());
+
+   OptionValue result;
+   result.isDefined = item.isDefined;
+   result.flag = item.flag;
+   result.str.assign (item.str, item.length);
+   result.ival = item.ival;
+   result.real = item.real;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::OptionView
+Parsley::OptionValues::view (const char* option) const noexcept
+{
+   OptionView result;
+   if (!this->m_index) return result;
+
+   const int slot = this->m_index->findLong (option, strlen (option));
+   if ((slot < 0) || (size_t (slot) >= this->m_slots.size())) {
+      return result;
+   }
+
+   const Slot& item = this->m_slots[slot];
+   result.isDefined = item.isDefined;
+   result.flag = item.flag;
+   result.str = this->m_text.data() + item.str.offset;
+   result.length = item.str.length;
+   result.ival = item.ival;
+   result.real = item.real;
+   result.custom = item.isCustom ? item.custom.bytes : nullptr;
+   return result;
+}
+
+
+//==============================================================================
+// Instrumentation
+//==============================================================================
+//
+static uint64_t monotonicNs ()
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return uint64_t (ts.tv_sec) * 1000000000u + uint64_t (ts.tv_nsec);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Metrics::Metrics ()
+{
+   this->clear (true);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Metrics::~Metrics () {}
+
+//------------------------------------------------------------------------------
+// static
+const char* Parsley::Metrics::phaseName (const Phase phase)
+{
+   static const char* const names[] = {
+      "environment", "argument scan", "conversion", "validation", "help"
+   };
+   return ((phase >= 0) && (phase < kNumberOfPhases)) ? names[phase] : "unknown";
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::Metrics::clear (const bool includeHelp)
+{
+   for (int p = 0; p < kNumberOfPhases; p++) {
+      if ((p == kHelp) && !includeHelp) continue;
+      this->phaseStartNs[p] = 0;
+      this->phaseNs[p] = 0;
+      this->m_current[p] = 0;
+   }
+
+   this->lookups = 0;
+   this->conversions = 0;
+   this->envLookups = 0;
+   this->envHits = 0;
+   this->bytesCopied = 0;
+   this->arguments = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::Metrics::begin (const Phase phase)
+{
+   const uint64_t now = monotonicNs ();
+   this->m_current[phase] = now;
+   if (this->phaseStartNs[phase] == 0) this->phaseStartNs[phase] = now;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::Metrics::end (const Phase phase)
+{
+   this->phaseNs[phase] += monotonicNs () - this->m_current[phase];
+}
+
+//------------------------------------------------------------------------------
+// Times a phase for the lifetime of the scope object.
+//
+class Parsley::PhaseScope {
+public:
+   PhaseScope (Metrics& metrics, const Metrics::Phase phase) :
+      m_metrics (metrics), m_phase (phase) { m_metrics.begin (phase); }
+   ~PhaseScope () { m_metrics.end (m_phase); }
+
+private:
+   Metrics& m_metrics;
+   const Metrics::Phase m_phase;
+};
+
+//------------------------------------------------------------------------------
+// static
+bool Parsley::instrumentationEnabled ()
+{
+#if defined(PARSLEY_INSTRUMENTATION)
+   return true;
+#else
+   return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+//
+const Parsley::Metrics& Parsley::metrics () const
+{
+   return this->m_metrics;
+}
+
+//------------------------------------------------------------------------------
+//
+std::ostream& Parsley::writeTraceEvents (std::ostream& os, const bool complete) const
+{
+   const Metrics& m = this->m_metrics;
+   const long pid = long (getpid ());
+   char buffer [200];
+
+   if (complete) os << "{\"traceEvents\": [" << nl;
+
+   bool first = true;
+   for (int p = 0; p < Metrics::kNumberOfPhases; p++) {
+      if (m.phaseStartNs[p] == 0) continue;   // phase did not occur
+
+      // The conversions are interleaved with the argument scanning, so they
+      // are shown as a single block of the total duration, starting at the
+      // first conversion, nested within the scan.
+      //
+      snprintf (buffer, sizeof (buffer),
+                "%s{\"name\": \"parsley %s\", \"cat\": \"parsley\", \"ph\": \"X\", "
+                "\"ts\": %.3f, \"dur\": %.3f, \"pid\": %ld, \"tid\": %ld}",
+                first ? "" : ",\n",
+                Metrics::phaseName (Metrics::Phase (p)),
+                double (m.phaseStartNs[p]) / 1000.0,
+                double (m.phaseNs[p]) / 1000.0,
+                pid, pid);
+      os << buffer;
+      first = false;
+   }
+
+   const uint64_t stamp = m.phaseStartNs[Metrics::kEnvironment];
+   if (stamp != 0) {
+      snprintf (buffer, sizeof (buffer),
+                "%s{\"name\": \"parsley counters\", \"cat\": \"parsley\", \"ph\": \"C\", "
+                "\"ts\": %.3f, \"pid\": %ld, \"tid\": %ld, \"args\": {",
+                first ? "" : ",\n", double (stamp) / 1000.0, pid, pid);
+      os << buffer;
+      os << "\"lookups\": " << m.lookups
+         << ", \"conversions\": " << m.conversions
+         << ", \"env_lookups\": " << m.envLookups
+         << ", \"env_hits\": " << m.envHits
+         << ", \"bytes_copied\": " << m.bytesCopied
+         << ", \"arguments\": " << m.arguments << "}}";
+      first = false;
+   }
+
+   if (complete) os << nl << "]}" << nl;
+   return os;
+}
+
+
+//==============================================================================
+// Allocation accounting
+//==============================================================================
+// Per thread counts, only updated while within a parsley entry point.
+//
+static thread_local int allocationScopeDepth = 0;
+static thread_local uint64_t threadAllocations = 0;
+static thread_local uint64_t threadDeallocations = 0;
+static thread_local uint64_t threadAllocatedBytes = 0;
+
+// Set once, by the allocation hook's static initialiser.
+//
+static std::atomic<bool> allocationHookPresent (false);
+
+// Declare one of these at the start of each entry point.
+//
+class AllocationScope {
+public:
+   AllocationScope ()  { allocationScopeDepth++; }
+   ~AllocationScope () { allocationScopeDepth--; }
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::AllocationStats::AllocationStats ()
+{
+   this->allocations = 0;
+   this->deallocations = 0;
+   this->bytes = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::AllocationStats::~AllocationStats () {}
+
+//------------------------------------------------------------------------------
+// static
+Parsley::AllocationStats Parsley::allocationStats ()
+{
+   AllocationStats result;
+   result.allocations = threadAllocations;
+   result.deallocations = threadDeallocations;
+   result.bytes = threadAllocatedBytes;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+void Parsley::resetAllocationStats ()
+{
+   threadAllocations = 0;
+   threadDeallocations = 0;
+   threadAllocatedBytes = 0;
+}
+
+//------------------------------------------------------------------------------
+// static
+bool Parsley::allocationStatsAvailable ()
+{
+   return allocationHookPresent.load (std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// static
+void Parsley::noteHookPresent ()
+{
+   allocationHookPresent.store (true, std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------------
+// static - no shared state is written, as this is called by every allocation
+// made by the program.
+//
+void Parsley::noteAllocation (const size_t size)
+{
+   if (allocationScopeDepth > 0) {
+      threadAllocations++;
+      threadAllocatedBytes += size;
+   }
+}
+
+//------------------------------------------------------------------------------
+// static
+void Parsley::noteDeallocation ()
+{
+   if (allocationScopeDepth > 0) {
+      threadDeallocations++;
+   }
+}
+
+
+//==============================================================================
+// Footprint
+//==============================================================================
+//
+Parsley::Footprint::Footprint ()
+{
+   this->object = 0;
+   this->specs = 0;
+   this->specTable = 0;
+   this->index = 0;
+   this->values = 0;
+   this->parameters = 0;
+   this->other = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Footprint::~Footprint () {}
+
+//------------------------------------------------------------------------------
+//
+size_t Parsley::Footprint::total () const
+{
+   return this->object + this->specs + this->specTable + this->index +
+          this->values + this->parameters + this->other;
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+//
+Parsley::Footprint Parsley::OptionValues::footprint () const
+{
+   Footprint result;
+   result.object = sizeof (OptionValues);
+   if (this->m_index) {
+      result.index = this->m_index->footprint() + sharedControlBytes;
+   }
+   result.values = heapBytes (this->m_slots) + heapBytes (this->m_text);
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Footprint Parsley::footprint () const
+{
+   Footprint result;
+   result.object = sizeof (Parsley);
+
+   for (const OptionSpecPointer& spec : this->m_specs) {
+      result.specs += spec->footprint() + sharedControlBytes;
+   }
+
+   result.specTable = heapBytes (this->m_specs);
+
+   if (this->m_index) {
+      result.index = this->m_index->footprint() + sharedControlBytes;
+   }
+   if (this->m_envIndex) {
+      result.index += this->m_envIndex->footprint() + sharedControlBytes;
+   }
+   result.values = heapBytes (this->m_slots) + heapBytes (this->m_seen) +
+                   heapBytes (this->m_defined) + heapBytes (this->m_required) +
+                   this->m_text.capacity();
+   result.parameters = this->m_parameters.capacity() * sizeof (TextRef);
+
+   // The groups, constraints, profiles, warnings, environment prefix values
+   // and path checks - the tables only, not the shared objects they refer to.
+   //
+   result.other = heapBytes (this->m_groups) + heapBytes (this->m_envValues) +
+                  this->m_warnings.capacity() * sizeof (Warning) +
+                  heapBytes (this->m_constraints) + heapBytes (this->m_rules) +
+                  heapBytes (this->m_ruleMasks) + heapBytes (this->m_defaulted) +
+                  heapBytes (this->m_violated) +
+                  heapBytes (this->m_profiles) + heapBytes (this->m_presetRanges) +
+                  heapBytes (this->m_presets) + heapBytes (this->m_selected) +
+                  this->m_pathJobs.capacity() * sizeof (PathJob) +
+                  heapBytes (this->m_pathSlots);
+   return result;
+}
+
+
+//==============================================================================
+// Parsley::Buffer
+//==============================================================================
+//
+template <typename T>
+Parsley::Buffer<T>::Buffer (MemoryResource* resource) :
+   m_resource (resource),
+   m_data (nullptr),
+   m_size (0),
+   m_capacity (0) { }
+
+//------------------------------------------------------------------------------
+//
+template <typename T>
+Parsley::Buffer<T>::~Buffer ()
+{
+   if (this->m_data) {
+      this->m_resource->deallocate (this->m_data, this->m_capacity * sizeof (T), alignof (T));
+   }
+}
+
+//------------------------------------------------------------------------------
+// Grows geometrically, as std::vector. Returns false, and leaves the buffer
+// as is, if the memory resource is exhausted. The items may be within the
+// buffer itself.
+//
+template <typename T>
+bool Parsley::Buffer<T>::append (const T* items, const size_t number) noexcept
+{
+   const size_t required = this->m_size + number;
+   if (required <= this->m_capacity) {
+      memmove (this->m_data + this->m_size, items, number * sizeof (T));
+      this->m_size = required;
+      return true;
+   }
+
+   size_t capacity = this->m_capacity ? 2 * this->m_capacity : 16;
+   while (capacity < required) capacity *= 2;
+
+   T* data = static_cast<T*> (this->m_resource->tryAllocate (capacity * sizeof (T),
+                                                             alignof (T)));
+   if (!data) return false;
+
+   if (this->m_data) memcpy (data, this->m_data, this->m_size * sizeof (T));
+   memcpy (data + this->m_size, items, number * sizeof (T));
+
+   if (this->m_data) {
+      this->m_resource->deallocate (this->m_data, this->m_capacity * sizeof (T),
+                                    alignof (T));
+   }
+   this->m_data = data;
+   this->m_size = required;
+   this->m_capacity = capacity;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+template <typename T>
+void Parsley::Buffer<T>::truncate (const size_t size) noexcept
+{
+   if (size < this->m_size) this->m_size = size;
+}
+
+
+//==============================================================================
+// Parsley
+//==============================================================================
+// static
+Parsley::Arguments Parsley::formArguments (const int argc,
+                                           const char* const* argv)
+{
+   Arguments result;
+   result.reserve (argc);
+
+   for (int j = 0; j < argc; j++) {
+      const std::string arg = argv[j];
+      result.push_back (arg);
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+int Parsley::indexOf (const EnumOptions& opts,
+                      const std::string& value)
+{
+   int index = -1;
+   for (const std::string& item : opts) {
+      index++;
+      if (value == item) {
+         return index;
+      }
+   }
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+// constructor
+Parsley::Parsley (const OptionSpecifications& specList) :
+   Parsley (specList, defaultResource ()) { }
+
+//------------------------------------------------------------------------------
+// constructor
+Parsley::Parsley (const OptionSpecifications& specList, MemoryResource& resource) :
+   m_resource (&resource),
+   m_specs (Allocator<OptionSpecPointer> (&resource)),
+   m_groups (Allocator<OptionGroupPointer> (&resource)),
+   m_slots (Allocator<Slot> (&resource)),
+   m_seen (Allocator<uint64_t> (&resource)),
+   m_defined (Allocator<uint64_t> (&resource)),
+   m_required (Allocator<uint64_t> (&resource)),
+   m_text (&resource),
+   m_parameters (&resource),
+   m_envValues (Allocator<const char*> (&resource)),
+   m_warnings (&resource),
+   m_constraints (Allocator<ConstraintPointer> (&resource)),
+   m_rules (Allocator<Rule> (&resource)),
+   m_ruleMasks (Allocator<MaskWord> (&resource)),
+   m_defaulted (Allocator<uint64_t> (&resource)),
+   m_violated (Allocator<int> (&resource)),
+   m_profiles (Allocator<ProfilePointer> (&resource)),
+   m_presetRanges (Allocator<PresetRange> (&resource)),
+   m_presets (Allocator<Preset> (&resource)),
+   m_selected (Allocator<int> (&resource)),
+   m_pathJobs (&resource),
+   m_pathSlots (Allocator<int> (&resource))
+{
+   AllocationScope scope;
+   this->construct (specList);
+}
+
+//------------------------------------------------------------------------------
+// constructor
+Parsley::Parsley (const OptionGroups& groups, MemoryResource& resource) :
+   m_resource (&resource),
+   m_specs (Allocator<OptionSpecPointer> (&resource)),
+   m_groups (Allocator<OptionGroupPointer> (&resource)),
+   m_slots (Allocator<Slot> (&resource)),
+   m_seen (Allocator<uint64_t> (&resource)),
+   m_defined (Allocator<uint64_t> (&resource)),
+   m_required (Allocator<uint64_t> (&resource)),
+   m_text (&resource),
+   m_parameters (&resource),
+   m_envValues (Allocator<const char*> (&resource)),
+   m_warnings (&resource),
+   m_constraints (Allocator<ConstraintPointer> (&resource)),
+   m_rules (Allocator<Rule> (&resource)),
+   m_ruleMasks (Allocator<MaskWord> (&resource)),
+   m_defaulted (Allocator<uint64_t> (&resource)),
+   m_violated (Allocator<int> (&resource)),
+   m_profiles (Allocator<ProfilePointer> (&resource)),
+   m_presetRanges (Allocator<PresetRange> (&resource)),
+   m_presets (Allocator<Preset> (&resource)),
+   m_selected (Allocator<int> (&resource)),
+   m_pathJobs (&resource),
+   m_pathSlots (Allocator<int> (&resource))
+{
+   AllocationScope scope;
+   this->construct (groups);
+}
+
+//------------------------------------------------------------------------------
+// Common to both constructors - the collection is the specifications or groups.
+//
+template <typename Collection>
+void Parsley::construct (const Collection& collection)
+{
+   // Set defaults.
+   //
+   this->m_cpl = 92;
+   this->m_extraNewLine = false;
+   this->m_includeNoMore = false;
+   this->m_parameterChecks = 0;
+   this->m_parameterFreeSpace = 0;
+   this->m_pathThreads = 8;
+   this->m_globParameters = false;
+   this->m_configType = nullptr;
+   this->m_singletonGiven = false;
+
+   this->m_specListOkay = true;   // hypothesize ok
+   this->m_specListError = kSpecificationError;
+   this->m_errorCode = kNoError;
+   this->m_errorSlot = -1;
+   this->m_errorSource = kFromArgument;
+   this->m_errorValue = TextRef ();
+   this->m_errorInt = 0;
+   this->m_errorReal = 0.0;
+
+   // Any allocation failure is reported by process. Note: without exceptions,
+   // allocation failure within initialise aborts.
+   //
+#if defined(PARSLEY_EXCEPTIONS)
+   try {
+      this->initialise (collection);
+   } catch (const std::bad_alloc&) {
+      this->m_specListOkay = false;
+      this->m_specListError = kOutOfMemory;
+   }
+#else
+   this->initialise (collection);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// static - builds the name index of a specification list, so checking for
+// duplicate names - the index does this for us.
+//
+Parsley::NameIndexPointer
+Parsley::buildIndex (const std::vector<OptionSpecPointer, Allocator<OptionSpecPointer> >& specs,
+                     MemoryResource& resource, bool& isOkay)
+{
+   const size_t number = specs.size();
+
+   std::shared_ptr<NameIndex> index = std::allocate_shared<NameIndex>
+         (Allocator<NameIndex> (&resource), number, resource);
+
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpecPointer& specB = specs[slot];
+
+      const int longConflict = index->insertLong (specB->text (OptionSpec::kLongName),
+                                                  specB->textLength (OptionSpec::kLongName),
+                                                  int (slot));
+      const int shortConflict = index->insertShort (specB->m_shortName, int (slot));
+
+      if (longConflict >= 0) {
+         warning ("conflicting option names: " + specs[longConflict]->name() +
+                  " and " + specB->name());
+         isOkay = false;
+      }
+
+      if ((shortConflict >= 0) && (shortConflict != longConflict)) {
+         warning ("conflicting option names: " + specs[shortConflict]->name() +
+                  " and " + specB->name());
+         isOkay = false;
+      }
+
+      // The option's other long names.
+      //
+      const auto insertName = [&] (const char* name, const size_t length,
+                                   const NameIndex::NameKind kind) {
+         const int conflict = index->insertLong (name, length, int (slot), kind);
+         if (conflict >= 0) {
+            warning ("conflicting option names: " + specs[conflict]->name() +
+                     " and " + specB->name() + " (--" + std::string (name, length) + ")");
+            isOkay = false;
+         }
+      };
+
+      specB->forEachName (OptionSpec::kAliases, [&] (const char* name, const size_t length) {
+         insertName (name, length, NameIndex::kAlias);
+      });
+      specB->forEachName (OptionSpec::kDeprecated, [&] (const char* name, const size_t length) {
+         insertName (name, length, NameIndex::kDeprecated);
+      });
+      if (specB->m_isNegatable) {
+         const std::string negation = "no-" + specB->textStr (OptionSpec::kLongName);
+         insertName (negation.data(), negation.size(), NameIndex::kNegation);
+      }
+   }
+
+   return index;
+}
+
+//------------------------------------------------------------------------------
+// Allocate slots and build the name index.
+//
+void Parsley::initialise (const OptionSpecifications& specList)
+{
+   this->m_specs.assign (specList.begin(), specList.end());
+   bool isOkay = true;
+   this->m_index = buildIndex (this->m_specs, *this->m_resource, isOkay);
+   if (!isOkay) this->m_specListOkay = false;
+   this->allocateSlots ();
+}
+
+//------------------------------------------------------------------------------
+// Merge the groups. Each group's names have already been checked against one
+// another, so only conflicts with the names of the preceding groups can arise.
+// A single group's index is used as is.
+//
+void Parsley::initialise (const OptionGroups& groups)
+{
+   size_t number = 0;
+   for (const OptionGroupPointer& group : groups) {
+      if (group) number += group->m_specs.size();
+   }
+   this->m_specs.reserve (number);
+
+   std::shared_ptr<NameIndex> merged;
+   if (groups.size() > 1) {
+      merged = std::allocate_shared<NameIndex>
+            (Allocator<NameIndex> (this->m_resource), number, *this->m_resource);
+   }
+
+   for (const OptionGroupPointer& group : groups) {
+      if (!group) continue;
+      if (group->m_outOfMemory) this->m_specListError = kOutOfMemory;
+      if (!group->m_isOkay) this->m_specListOkay = false;
+
+      const int firstSlot = int (this->m_specs.size());
+      this->m_specs.insert (this->m_specs.end(), group->m_specs.begin(), group->m_specs.end());
+      this->m_groups.push_back (group);
+
+      if (!merged || !group->m_index) continue;
+      merged->merge (*group->m_index, firstSlot, [&] (const int existing, const int slot) {
+         warning ("conflicting option names: " + this->m_specs[existing]->name() +
+                  " and " + this->m_specs[slot]->name());
+         this->m_specListOkay = false;
+      });
+   }
+
+   if (merged) {
+      this->m_index = merged;
+   } else if (!this->m_groups.empty() && this->m_groups.front()->m_index) {
+      this->m_index = this->m_groups.front()->m_index;
+   } else {
+      bool isOkay = true;
+      this->m_index = buildIndex (this->m_specs, *this->m_resource, isOkay);
+   }
+   this->allocateSlots ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::allocateSlots ()
+{
+   const size_t number = this->m_specs.size();
+   const size_t words = (number + 63) / 64;
+   this->m_slots.resize (number);
+   this->m_seen.assign (words, 0);
+   this->m_defined.assign (words, 0);
+
+   // If a default is defined, then input is not required per se.
+   //
+   this->m_required.assign (words, 0);
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      if (spec->m_isRequired && !spec->m_defaultIsDefined) {
+         this->m_required[slot / 64] |= uint64_t (1) << (slot % 64);
+      }
+      if (spec->m_pathChecks || spec->m_minFreeSpace) {
+         this->m_pathSlots.push_back (int (slot));
+      }
+
+      // Members may only be bound to the one configuration struct type.
+      //
+      if (spec->m_bindConfig) {
+         if (!this->m_configType) {
+            this->m_configType = spec->m_bindConfig;
+         } else if (spec->m_bindConfig != this->m_configType) {
+            warning ("option " + spec->name() +
+                     " is bound to a member of another configuration struct.");
+            this->m_specListOkay = false;
+         }
+      }
+   }
+
+   // Offset 0 is the empty string.
+   //
+   if (!this->m_text.append ("", 1)) {
+      this->m_specListOkay = false;
+      this->m_specListError = kOutOfMemory;
+   }
+   this->m_textBase = this->m_text.size();
+}
+
+//------------------------------------------------------------------------------
+// destructor
+Parsley::~Parsley () { }
+
+//------------------------------------------------------------------------------
+//
+void Parsley::setOptionHelpCpl (const int cpl)
+{
+   this->m_cpl = cpl >= 40 ? cpl : 40;   // ensure sensible
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::setOptionNewLineSeparator (const bool extraNewLine)
+{
+   this->m_extraNewLine = extraNewLine;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::setOptionIncludeNoMore (const bool includeNoMore)
+{
+   this->m_includeNoMore = includeNoMore;
+}
+
+//------------------------------------------------------------------------------
+// The indent of the option descriptions.
+//
+static const std::string helpGap = "                    ";
+
+//------------------------------------------------------------------------------
+// Groups each have their own section, under the group's title.
+//
+std::ostream& Parsley::optionHelp (std::ostream& os)
+{
+   AllocationScope scope;
+#if defined(PARSLEY_INSTRUMENTATION)
+   this->m_metrics.phaseStartNs[Metrics::kHelp] = 0;
+   this->m_metrics.phaseNs[Metrics::kHelp] = 0;
+#endif
+   INSTRUMENT_PHASE (kHelp);
+
+   if (this->m_groups.empty()) {
+      os << "Options:" << nl;
+      for (const OptionSpecPointer& spec : this->m_specs) {
+         this->specHelp (os, *spec);
+      }
+   } else {
+      size_t slot = 0;
+      for (const OptionGroupPointer& group : this->m_groups) {
+         if (slot > 0 && !this->m_extraNewLine) os << nl;
+         os << group->m_title << ":" << nl;
+         for (size_t j = 0; j < group->m_specs.size(); j++) {
+            this->specHelp (os, *this->m_specs[slot++]);
+         }
+      }
+   }
+
+   static const std::string nullDecrption =
+         "The null option indicating no more options. "
+         "This is useful if/when the initial parameters \"look like\" options. ";
+
+   if (this->m_includeNoMore) {
+       os << formatLongLine (helpGap, "--", nullDecrption, this->m_cpl);
+   }
+
+   if (!this->m_constraints.empty()) {
+      if (!this->m_extraNewLine) os << nl;
+      os << "Constraints:" << nl;
+      for (const ConstraintPointer& constraint : this->m_constraints) {
+         os << formatLongLine ("   ", "", constraint->image(), this->m_cpl);
+      }
+   }
+
+   if (!this->m_profiles.empty()) {
+      if (!this->m_extraNewLine) os << nl;
+      os << "Profiles:" << nl;
+      for (size_t j = 0; j < this->m_profiles.size(); j++) {
+         const PresetRange& range = this->m_presetRanges[j];
+         std::string sets;
+         for (uint32_t p = range.first; p < range.first + range.count; p++) {
+            const Preset& preset = this->m_presets[p];
+            const OptionSpec* spec = this->m_specs[preset.slot].get();
+            const std::string longName = spec->textStr (OptionSpec::kLongName);
+            if (!sets.empty()) sets += ", ";
+            switch (preset.kind) {
+               case OptionSpec::Kind::kFlag:
+                  // There is no --no-<name> to show for a flag that is not
+                  // negatable, so name the setting instead.
+                  //
+                  if (preset.value.flag) {
+                     sets += "--" + longName;
+                  } else if (spec->m_isNegatable) {
+                     sets += "--no-" + longName;
+                  } else {
+                     sets += "--" + longName + " off";
+                  }
+                  break;
+               case OptionSpec::Kind::kInt:
+                  sets += "--" + longName + " " + int2str (preset.value.ival);
+                  break;
+               case OptionSpec::Kind::kReal:
+                  sets += "--" + longName + " " + real2str (preset.value.real);
+                  break;
+               default:
+                  sets += "--" + longName + " " + std::string (this->textOf (preset.value.str),
+                                                               preset.value.str.length);
+                  break;
+            }
+         }
+         const ProfilePointer& profile = this->m_profiles[j];
+         std::string description = profile->description();
+         if (!sets.empty()) description += " Sets: " + sets + ".";
+         os << formatLongLine (helpGap, profile->name(), description, this->m_cpl);
+      }
+   }
+
+   return os;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::specHelp (std::ostream& os, const OptionSpec& spec) const
+{
+   static const size_t gapSize = helpGap.size();
+
+   if (spec.m_isHidden) return;
+
+   const std::string description = spec.textStr (OptionSpec::kDescription);
+   const bool literalDescription =
+         (description.size() >= 1) && (description[0] == '!');
+
+   if (literalDescription) {
+      const std::string desc = description.substr(1);   // Drop the '!'
+      const std::list<std::string> ds = splitString (desc, "\n", true);
+
+      std::string prefix = spec.name() + " ";   // always want at least one space
+      while (prefix.size() < gapSize) prefix += " ";
+      for (std::string part : ds) {
+         os << prefix << part << nl;
+         prefix = helpGap;
+      }
+
+   } else {
+      // Just use regular long line formatting
+      //
+      os << formatLongLine (helpGap, spec.name(), description, this->m_cpl);
+   }
+
+   std::string extra = "";
+   if (spec.m_isRequired && !spec.m_defaultIsDefined) {
+      // If a default is defined, then input is not required per se.
+      extra += "Required. ";
+   }
+
+   const std::string evName = this->envVarName (spec);
+   extra += spec.helpAliases();
+
+   switch (spec.m_kind) {
+      case OptionSpec::Kind::kFlag:
+         if (spec.m_defaultValue.i != 0) extra += spec.helpDefault();
+         if (!evName.empty()) {
+            extra += "Use the " + evName +
+                     " environment variable set to 'Y', 'YES' or '1' to set flag on. ";
+         }
+         break;
+
+      case OptionSpec::Kind::kCustom:
+         extra += spec.helpDefault();
+         extra += spec.helpEnvVar (evName);
+         break;
+
+      case OptionSpec::Kind::kStr:
+      case OptionSpec::Kind::kEnum:
+      case OptionSpec::Kind::kInt:
+      case OptionSpec::Kind::kReal:
+         extra += spec.helpConstraint();
+         extra += spec.helpDefault();
+         extra += spec.helpEnvVar (evName);
+         break;
+
+      default:
+         break;
+   }
+
+   if (extra.length() > 0) {
+      os << formatLongLine (helpGap, "", extra, this->m_cpl);
+   }
+
+   if (this->m_extraNewLine) os << nl;
+}
+
+//==============================================================================
+// Completion scripts
+//==============================================================================
+//
+// What each script needs to know of an option.
+//
+struct CompletionItem {
+   std::string longName;
+   char shortName;
+   std::string description;   // single line
+   bool takesValue;
+   bool isFileValue;
+   bool isDynamic;
+   std::list<std::string> words;   // enumeration values
+};
+
+// The completion query option, see Parsley::completionQuery.
+//
+static const char* const completeQueryOption = "--parsley-complete";
+
+typedef std::list<CompletionItem> CompletionItems;
+
+//------------------------------------------------------------------------------
+// Replaces each character in chars with a backslash escaped copy, and each
+// single quote with the given image.
+//
+static std::string escapeString (const std::string& str, const char* chars,
+                                 const char* quoteImage)
+{
+   std::string result;
+   for (const char c : str) {
+      if (c == '\'') {
+         result += quoteImage;
+      } else {
+         if (strchr (chars, c)) result += '\\';
+         result += c;
+      }
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// POSIX shells: within single quotes only the single quote needs care.
+//
+static std::string shellQuote (const std::string& str, const char* chars = "")
+{
+   return "'" + escapeString (str, chars, "'\\''") + "'";
+}
+
+//------------------------------------------------------------------------------
+// Only letters, digits and underscores are allowed in function names.
+//
+static std::string functionName (const std::string& program)
+{
+   std::string result = "_parsley_";
+   for (const char c : program) {
+      result += isalnum ((unsigned char) c) ? c : '_';
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+static std::string joinWords (const std::list<std::string>& words)
+{
+   std::string result;
+   for (const std::string& word : words) {
+      if (!result.empty()) result += ' ';
+      result += word;
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// The option's names as a case pattern, or a word list.
+//
+static std::string bashNames (const CompletionItem& item, const char* separator)
+{
+   std::string result;
+   if (item.shortName != '\0') {
+      result = std::string ("-") + item.shortName + separator;
+   }
+   return result + "--" + item.longName;
+}
+
+//------------------------------------------------------------------------------
+//
+static void bashScript (std::ostream& os, const CompletionItems& items,
+                        const std::string& program)
+{
+   const std::string function = functionName (program);
+
+   std::string allNames;
+   for (const CompletionItem& item : items) {
+      if (!allNames.empty()) allNames += ' ';
+      allNames += bashNames (item, " ");
+   }
+
+   os << "# bash completion for " << program << " - generated by parsley" << nl
+      << function << " ()" << nl
+      << "{" << nl
+      << "   local cur=\"${COMP_WORDS[COMP_CWORD]}\"" << nl
+      << "   local prev=\"\"" << nl
+      << "   [ ${COMP_CWORD} -gt 0 ] && prev=\"${COMP_WORDS[COMP_CWORD-1]}\"" << nl
+      << "   case \"${prev}\" in" << nl;
+
+   for (const CompletionItem& item : items) {
+      if (!item.takesValue) continue;
+      os << "      " << bashNames (item, "|") << ")" << nl;
+      if (item.isDynamic) {
+         os << "         COMPREPLY=( $(\"${COMP_WORDS[0]}\" " << completeQueryOption
+            << " ${COMP_CWORD} \"${COMP_WORDS[@]}\" 2>/dev/null) )" << nl;
+      } else if (!item.words.empty()) {
+         os << "         COMPREPLY=( $(compgen -W " << shellQuote (joinWords (item.words))
+            << " -- \"${cur}\") )" << nl;
+      } else if (item.isFileValue) {
+         os << "         COMPREPLY=( $(compgen -f -- \"${cur}\") )" << nl;
+      } else {
+         os << "         COMPREPLY=()" << nl;
+      }
+      os << "         return 0 ;;" << nl;
+   }
+
+   os << "   esac" << nl
+      << "   if [[ \"${cur}\" == -* ]] ; then" << nl
+      << "      COMPREPLY=( $(compgen -W " << shellQuote (allNames) << " -- \"${cur}\") )" << nl
+      << "   else" << nl
+      << "      COMPREPLY=( $(compgen -f -- \"${cur}\") )" << nl
+      << "   fi" << nl
+      << "   return 0" << nl
+      << "}" << nl
+      << "complete -o filenames -F " << function << " " << shellQuote (program) << nl;
+}
+
+//------------------------------------------------------------------------------
+// Each option is an _arguments specification, e.g.
+// '(-m --mode)'{-m,--mode}'[The mode.]:mode:(aaa bbb)'
+//
+static void zshScript (std::ostream& os, const CompletionItems& items,
+                       const std::string& program)
+{
+   const std::string function = functionName (program);
+   static const char* const special = "[]:\\";
+
+   os << "#compdef " << program << nl
+      << "# zsh completion for " << program << " - generated by parsley" << nl
+      << function << " ()" << nl
+      << "{" << nl
+      << "   _arguments -s \\" << nl;
+
+   for (const CompletionItem& item : items) {
+      std::string names;
+      if (item.shortName != '\0') {
+         names = std::string ("'(-") + item.shortName + " --" + item.longName + ")'{-" +
+                 item.shortName + ",--" + item.longName + "}'";
+      } else {
+         names = "'--" + item.longName;
+      }
+
+      std::string action;
+      if (item.takesValue) {
+         action = ":" + escapeString (item.longName, special, "'\\''") + ":";
+         if (item.isDynamic) {
+            action += std::string ("{compadd -- ${(f)\"$(${words[1]} ") + completeQueryOption +
+                      " $((CURRENT-1)) ${words[@]} 2>/dev/null)\"}}";
+         } else if (!item.words.empty()) {
+            std::list<std::string> words;
+            for (const std::string& word : item.words) {
+               words.push_back (escapeString (word, "()\\ ", "'\\''"));
+            }
+            action += "(" + joinWords (words) + ")";
+         } else if (item.isFileValue) {
+            action += "_files";
+         } else {
+            action += " ";
+         }
+      }
+
+      os << "      " << names << "["
+         << escapeString (item.description, special, "'\\''") << "]"
+         << action << "' \\" << nl;
+   }
+
+   os << "      '*:parameter:_files'" << nl
+      << "}" << nl
+      << "if [ \"${funcstack[1]}\" = " << shellQuote (function) << " ] ; then" << nl
+      << "   " << function << " \"$@\"" << nl
+      << "else" << nl
+      << "   compdef " << function << " " << shellQuote (program) << nl
+      << "fi" << nl;
+}
+
+//------------------------------------------------------------------------------
+// fish: within single quotes, the backslash and single quote are escaped.
+//
+static std::string fishQuote (const std::string& str)
+{
+   return "'" + escapeString (str, "\\", "\\'") + "'";
+}
+
+//------------------------------------------------------------------------------
+//
+static void fishScript (std::ostream& os, const CompletionItems& items,
+                        const std::string& program)
+{
+   const std::string command = fishQuote (program);
+
+   os << "# fish completion for " << program << " - generated by parsley" << nl;
+
+   for (const CompletionItem& item : items) {
+      os << "complete -c " << command;
+      if (item.shortName != '\0') {
+         os << " -s " << fishQuote (std::string (1, item.shortName));
+      }
+      os << " -l " << fishQuote (item.longName);
+
+      if (item.takesValue) {
+         if (item.isDynamic) {
+            os << " -x -a " << fishQuote (std::string ("(") + program + " " + completeQueryOption +
+                                          " (count (commandline -opc)) (commandline -opc)"
+                                          " (commandline -ct))");
+         } else if (!item.words.empty()) {
+            os << " -x -a " << fishQuote (joinWords (item.words));
+         } else if (item.isFileValue) {
+            os << " -r -F";
+         } else {
+            os << " -x";
+         }
+      }
+      os << " -d " << fishQuote (item.description) << nl;
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+std::ostream& Parsley::completionScript (std::ostream& os, const Shell shell,
+                                         const std::string& program) const
+{
+   AllocationScope scope;
+
+   CompletionItems items;
+   for (const OptionSpecPointer& spec : this->m_specs) {
+      if (spec->m_isHidden) continue;
+
+      CompletionItem item;
+      item.longName = spec->textStr (OptionSpec::kLongName);
+      item.shortName = spec->m_shortName;
+      item.takesValue = (spec->m_kind != OptionSpec::Kind::kFlag);
+      item.isFileValue = spec->m_isFileValue;
+      item.isDynamic = spec->m_isDynamic;
+
+      // Literal descriptions are multi-line: just use the first line.
+      //
+      std::string description = spec->textStr (OptionSpec::kDescription);
+      if ((description.size() >= 1) && (description[0] == '!')) {
+         description = description.substr (1);
+      }
+      item.description = description.substr (0, description.find ('\n'));
+
+      if (spec->m_kind == OptionSpec::Kind::kEnum) {
+         for (int j = 0; j < spec->enumCount(); j++) {
+            item.words.push_back (spec->textStr (OptionSpec::kFirstEnumOption + j));
+         }
+      }
+      items.push_back (item);
+   }
+
+   switch (shell) {
+      case kBash:  bashScript (os, items, program);  break;
+      case kZsh:   zshScript (os, items, program);   break;
+      case kFish:  fishScript (os, items, program);  break;
+   }
+
+   return os;
+}
+
+//==============================================================================
+// Invocation recorder
+//==============================================================================
+//
+static const char* const recordFileEnvVar = "PARSLEY_RECORD_FILE";
+
+// Record field tags.
+//
+static const char tagTool = 't';
+static const char tagSkip = 's';
+static const char tagArgument = 'a';
+static const char tagEnvSet = 'e';
+static const char tagEnvUnset = 'u';
+
+//------------------------------------------------------------------------------
+// Opened once, on first use, and then left open for the life of the program.
+// Returns -1 if recording not enabled (or the file could not be opened).
+//
+static int recorderFileDescriptor ()
+{
+   static const int fd = [] () -> int {
+      const char* filename = std::getenv (recordFileEnvVar);
+      if (!filename || !filename[0]) return -1;
+      const int result = open (filename, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+      if (result < 0) {
+         warning (std::string ("unable to open record file ") + filename +
+                  ": " + strerror (errno));
+      }
+      return result;
+   } ();
+   return fd;
+}
+
+//------------------------------------------------------------------------------
+// A field is: <tag><length>:<bytes>
+//
+static void appendField (std::string& record, const char tag, const std::string& value)
+{
+   record += tag;
+   record += std::to_string (value.size());
+   record += ':';
+   record += value;
+}
+
+//------------------------------------------------------------------------------
+// A record is: <length>:<fields>\n
+//
+static void recordInvocation (const Parsley::Arguments& arguments,
+                              const bool skipProgramName,
+                              const std::list<std::string>& envVarNames)
+{
+   const int fd = recorderFileDescriptor ();
+   if (fd < 0) return;
+
+   std::string fields;
+#if defined(__GLIBC__)
+   appendField (fields, tagTool, program_invocation_short_name);
+#else
+   appendField (fields, tagTool, "");
+#endif
+   appendField (fields, tagSkip, skipProgramName ? "1" : "0");
+
+   for (const std::string& arg : arguments) {
+      appendField (fields, tagArgument, arg);
+   }
+
+   for (const std::string& name : envVarNames) {
+      const char* envp = std::getenv (name.c_str());
+      if (envp) {
+         appendField (fields, tagEnvSet, name + '=' + envp);
+      } else {
+         appendField (fields, tagEnvUnset, name);
+      }
+   }
+
+   const std::string record = std::to_string (fields.size()) + ':' + fields + nl;
+
+   // One write, so that concurrent writers do not interleave.
+   //
+   const ssize_t n = write (fd, record.data(), record.size());
+   if (n != ssize_t (record.size())) {
+      warning ("failed to write invocation record.");
+   }
+}
+
+//------------------------------------------------------------------------------
+// Records this invocation, together with the relevant environment variables.
+//
+void Parsley::record (const Arguments& arguments, const bool skipProgramName) const
+{
+   std::list<std::string> envVarNames;
+   for (const OptionSpecPointer& spec : this->m_specs) {
+      const std::string evName = this->envVarName (*spec);
+      if (!evName.empty()) envVarNames.push_back (evName);
+   }
+   recordInvocation (arguments, skipProgramName, envVarNames);
+}
+
+//------------------------------------------------------------------------------
+// Reads a decimal length terminated by a ':'.
+//
+static bool readLength (const std::string& data, size_t& pos, size_t& length)
+{
+   const size_t start = pos;
+   length = 0;
+   while ((pos < data.size()) && isdigit (data[pos])) {
+      length = 10 * length + size_t (data[pos] - '0');
+      pos++;
+   }
+   if ((pos == start) || (pos >= data.size()) || (data[pos] != ':')) return false;
+   pos++;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Invocation::Invocation ()
+{
+   this->skipProgramName = true;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Invocation::~Invocation () {}
+
+//------------------------------------------------------------------------------
+// static
+bool Parsley::readCorpus (const std::string& filename, Invocations& invocations)
+{
+   std::ifstream file (filename, std::ios::binary);
+   if (!file) return false;
+
+   std::stringstream buffer;
+   buffer << file.rdbuf();
+   const std::string data = buffer.str();
+
+   size_t pos = 0;
+   while (pos < data.size()) {
+      size_t recordLength;
+      if (!readLength (data, pos, recordLength)) return false;
+      if (pos + recordLength + 1 > data.size()) return false;   // truncated
+      if (data[pos + recordLength] != nl) return false;
+
+      const size_t end = pos + recordLength;
+      Invocation invocation;
+
+      while (pos < end) {
+         const char tag = data[pos++];
+         size_t length;
+         if (!readLength (data, pos, length)) return false;
+         if (pos + length > end) return false;
+         const std::string value = data.substr (pos, length);
+         pos += length;
+
+         switch (tag) {
+            case tagTool:
+               invocation.tool = value;
+               break;
+
+            case tagSkip:
+               invocation.skipProgramName = (value == "1");
+               break;
+
+            case tagArgument:
+               invocation.arguments.push_back (value);
+               break;
+
+            case tagEnvSet:
+            case tagEnvUnset:
+               {
+                  Invocation::EnvironmentValue ev;
+                  ev.isDefined = (tag == tagEnvSet);
+                  const size_t eq = ev.isDefined ? value.find ('=') : std::string::npos;
+                  ev.name = value.substr (0, eq);
+                  ev.value = ev.isDefined ? value.substr (eq + 1) : "";
+                  invocation.environment.push_back (ev);
+               }
+               break;
+
+            default:
+               break;   // skip unknown fields - allows for future extension
+         }
+      }
+
+      pos = end + 1;   // skip the new line
+      invocations.push_back (invocation);
+   }
+
+   return true;
+}
+
+
+//==============================================================================
+// Visitor
+//==============================================================================
+//
+Parsley::Visitor::Visitor () { }
+
+//------------------------------------------------------------------------------
+//
+Parsley::Visitor::~Visitor () { }
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onFlag (const int) { return true; }
+bool Parsley::Visitor::onNegatedFlag (const int) { return true; }
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onInt (const int, const intp_t) { return true; }
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onReal (const int, const double) { return true; }
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onStr (const int, const char*, const size_t) { return true; }
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onEnum (const int slot, const intp_t,
+                               const char* str, const size_t length)
+{
+   return this->onStr (slot, str, length);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onCustom (const int slot, const void*,
+                                 const char* str, const size_t length)
+{
+   return this->onStr (slot, str, length);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::Visitor::onParameter (const char*, const size_t) { return true; }
+
+//------------------------------------------------------------------------------
+// static - presents a profile's precomputed value to a visitor, by way of the
+// function for the option's kind.
+//
+bool Parsley::visitPreset (Visitor& visitor, const Preset& preset, const char* str)
+{
+   const Slot& value = preset.value;
+   switch (preset.kind) {
+      case OptionSpec::Kind::kFlag:
+         return value.flag ? visitor.onFlag (preset.slot) : visitor.onNegatedFlag (preset.slot);
+      case OptionSpec::Kind::kStr:
+         return visitor.onStr (preset.slot, str, value.str.length);
+      case OptionSpec::Kind::kEnum:
+         return visitor.onEnum (preset.slot, value.ival, str, value.str.length);
+      case OptionSpec::Kind::kInt:
+         return visitor.onInt (preset.slot, value.ival);
+      case OptionSpec::Kind::kReal:
+         return visitor.onReal (preset.slot, value.real);
+      case OptionSpec::Kind::kCustom:
+         return visitor.onCustom (preset.slot, value.custom.bytes, str, value.str.length);
+      default:
+         return true;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Assigns to a bound std::string. Returns false if unable to allocate.
+//
+static bool assignText (void* target, const char* str, const size_t length) noexcept
+{
+#if defined(PARSLEY_EXCEPTIONS)
+   try {
+      static_cast<std::string*> (target)->assign (str, length);
+   } catch (...) {
+      return false;
+   }
+#else
+   static_cast<std::string*> (target)->assign (str, length);
+#endif
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// The visitor used by process - stores the values in the bound variables or,
+// for unbound options, in the slots and the text buffer. Only fails if unable
+// to allocate.
+//
+class Parsley::SlotWriter : public Parsley::Visitor {
+public:
+   explicit SlotWriter (Parsley& owner, void* config) :
+      outOfMemory (false), failedSlot (-1), m_owner (owner), m_config (config) { }
+
+   bool onFlag (const int slot)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         *static_cast<bool*> (target) = true;
+         return true;
+      }
+
+      Slot& value = this->m_owner.m_slots[slot];
+      value.flag = true;
+      value.isDefined = true;
+      return true;
+   }
+
+   bool onNegatedFlag (const int slot)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         *static_cast<bool*> (target) = false;
+         return true;
+      }
+
+      Slot& value = this->m_owner.m_slots[slot];
+      value.flag = false;
+      value.isDefined = true;
+      return true;
+   }
+
+   bool onInt (const int slot, const intp_t ival)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         *static_cast<intp_t*> (target) = ival;
+         return true;
+      }
+
+      Slot& value = this->m_owner.m_slots[slot];
+      value.ival = ival;
+      value.isDefined = true;
+      return true;
+   }
+
+   bool onReal (const int slot, const double real)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         *static_cast<double*> (target) = real;
+         return true;
+      }
+
+      Slot& value = this->m_owner.m_slots[slot];
+      value.real = real;
+      value.isDefined = true;
+      return true;
+   }
+
+   bool onStr (const int slot, const char* str, const size_t length)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         if (!assignText (target, str, length)) return this->failed (slot);
+         return true;
+      }
+
+      Slot& value = this->m_owner.m_slots[slot];
+      if (!this->m_owner.addText (str, length, value.str)) return this->failed (slot);
+      value.isDefined = true;
+      return true;
+   }
+
+   bool onEnum (const int slot, const intp_t index, const char* str, const size_t length)
+   {
+      void* target = this->target (slot);
+      if (target) {
+         if (this->m_owner.m_specs[slot]->m_binding == OptionSpec::kBindInt) {
+            *static_cast<intp_t*> (target) = index;
+            return true;
+         }
+         if (!assignText (target, str, length)) return this->failed (slot);
+         return true;
+      }
+
+      this->m_owner.m_slots[slot].ival = index;
+      return this->onStr (slot, str, length);
+   }
+
+   bool onCustom (const int slot, const void* custom, const char* str, const size_t length)
+   {
+      Slot& value = this->m_owner.m_slots[slot];
+      memcpy (value.custom.bytes, custom, kCustomValueSize);
+      return this->onStr (slot, str, length);
+   }
+
+   bool onParameter (const char* str, const size_t length)
+   {
+      if (!this->m_owner.addParameter (str, length)) return this->failed (-1);
+      return true;
+   }
+
+   // Called by scan in lieu of visitPreset: a block copy - any text is
+   // already in the retained part of the buffer.
+   //
+   bool applyPreset (const Preset& preset, const char* str)
+   {
+      if (this->target (preset.slot)) return visitPreset (*this, preset, str);
+      this->m_owner.m_slots[preset.slot] = preset.value;
+      return true;
+   }
+
+   bool outOfMemory;
+   int failedSlot;
+
+private:
+   void* target (const int slot) const
+   {
+      return this->m_owner.m_specs[slot]->bindingTarget (this->m_config);
+   }
+
+   bool failed (const int slot)
+   {
+      this->outOfMemory = true;
+      this->failedSlot = slot;
+      return false;
+   }
+
+   Parsley& m_owner;
+   void* const m_config;
+};
+
+//------------------------------------------------------------------------------
+// The argument sources presented to scan.
+//
+class Parsley::ArgumentList {
+public:
+   explicit ArgumentList (const Arguments& arguments) : m_arguments (arguments) { }
+
+   size_t size () const { return this->m_arguments.size(); }
+   const char* item (const size_t j) const { return this->m_arguments[j].c_str(); }
+   size_t length (const size_t j) const { return this->m_arguments[j].size(); }
+
+private:
+   const Arguments& m_arguments;
+};
+
+class Parsley::ArgumentVector {
+public:
+   explicit ArgumentVector (const int argc, const char* const* argv) :
+      m_argc (argc > 0 ? size_t (argc) : 0), m_argv (argv) { }
+
+   size_t size () const { return this->m_argc; }
+   const char* item (const size_t j) const { return this->m_argv[j]; }
+   size_t length (const size_t j) const { return strlen (this->m_argv[j]); }
+
+private:
+   const size_t m_argc;
+   const char* const* m_argv;
+};
+
+//------------------------------------------------------------------------------
+// Resets the error context, text buffer and parameters prior to processing.
+//
+void Parsley::clear () noexcept
+{
+   this->m_errorCode = kNoError;
+   this->m_errorSlot = -1;
+   this->m_errorValue = TextRef ();
+   this->m_text.truncate (this->m_textBase);   // retain the empty string and profile text
+   this->m_parameters.truncate (0);
+   this->m_warnings.truncate (0);
+   this->m_pathJobs.truncate (0);
+   this->m_violated.clear ();   // retains the capacity
+#if defined(PARSLEY_INSTRUMENTATION)
+   this->m_metrics.clear (false);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Returns the index of the lowest set bit, bits being non-zero.
+//
+static inline int lowestBit (const uint64_t bits)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll (bits);
+#else
+   int result = 0;
+   for (uint64_t x = bits; !(x & 1); x >>= 1) result++;
+   return result;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Visits the environment variable values, then the arguments. The visitor
+// may stop processing, see Visitor. The writer, if any, is process's visitor,
+// which copies profile presets as is.
+//
+template <typename Source>
+bool Parsley::scan (const Source& source, const bool skipProgramName,
+                    Visitor& visitor, SlotWriter* writer) noexcept
+{
+   // Macro function to call the visitor, and honour any request to stop.
+   //
+#define VISIT(call) {                                      \
+   if (!(call)) return this->fail (kStopped, slot);        \
+}
+
+   const size_t number = this->m_specs.size();
+   const size_t words = this->m_defined.size();
+   uint64_t* const seen = this->m_seen.data();
+   uint64_t* const defined = this->m_defined.data();
+   for (size_t w = 0; w < words; w++) {
+      seen[w] = 0;
+      defined[w] = 0;
+   }
+   this->m_singletonGiven = false;
+   this->m_selected.clear();
+
+   {
+   INSTRUMENT_PHASE (kEnvironment);
+   if (this->m_envIndex) this->scanEnvironment ();
+
+   for (size_t j = 0; j < number; j++) {
+      const int slot = int (j);
+      const OptionSpec* spec = this->m_specs[j].get();
+
+      const char* envp;
+      if (spec->m_evIsDefined) {
+         envp = std::getenv (spec->text (OptionSpec::kEvName));
+         INSTRUMENT_COUNT (envLookups, 1);
+      } else if (this->m_envIndex) {
+         envp = this->m_envValues[j];
+      } else {
+         continue;
+      }
+      if (!envp) continue;
+      INSTRUMENT_COUNT (envHits, 1);
+
+      const size_t length = strlen (envp);
+      bool status;
+
+      switch (spec->m_kind) {
+         case OptionSpec::Kind::kFlag:
+            // Only a value that turns the flag on defines it, so that e.g.
+            // VERBOSE=0 neither conflicts with, nor satisfies, a constraint.
+            //
+            if ((strcmp (envp, "1") == 0) || (strcmp (envp, "Y") == 0) ||
+                (strcmp (envp, "YES") == 0)) {
+               VISIT (visitor.onFlag (slot));
+               defined[j / 64] |= uint64_t (1) << (j % 64);
+            }
+            continue;
+
+         case OptionSpec::Kind::kStr:
+            if (spec->m_pattern && !spec->m_pattern->matches (envp, length)) {
+               return this->fail (kPatternMismatch, slot, kFromEnvironment, envp, length);
+            }
+            if (spec->m_isProfile && !this->selectProfiles (envp, length)) {
+               return this->fail (kNoSuchProfile, slot, kFromEnvironment, envp, length);
+            }
+            VISIT (visitor.onStr (slot, envp, length));
+            break;
+
+         case OptionSpec::Kind::kEnum:
+            {
+               INSTRUMENT_COUNT (conversions, 1);
+               const intp_t index = spec->enumIndex (envp, length);
+               if (index < 0) {
+                  return this->fail (kInvalidEnumValue, slot, kFromEnvironment,
+                                     envp, length);
+               }
+               VISIT (visitor.onEnum (slot, index, envp, length));
+            }
+            break;
+
+         case OptionSpec::Kind::kInt:
+            {
+               INSTRUMENT_COUNT (conversions, 1);
+               intp_t ival = 0;
+               status = parseInt (envp, ival);
+               if (!status) {
+                  return this->fail (kInvalidInteger, slot, kFromEnvironment, envp, length);
+               }
+               VISIT (visitor.onInt (slot, ival));
+            }
+            break;
+
+         case OptionSpec::Kind::kReal:
+            {
+               INSTRUMENT_COUNT (conversions, 1);
+               double real = 0.0;
+               status = parseReal (envp, real);
+               if (!status) {
+                  return this->fail (kInvalidReal, slot, kFromEnvironment, envp, length);
+               }
+               VISIT (visitor.onReal (slot, real));
+            }
+            break;
+
+         case OptionSpec::Kind::kCustom:
+            {
+               INSTRUMENT_COUNT (conversions, 1);
+               CustomValue custom;
+               if (!spec->m_customType->parse (envp, length, &custom)) {
+                  return this->fail (kInvalidValue, slot, kFromEnvironment, envp, length);
+               }
+               VISIT (visitor.onCustom (slot, &custom, envp, length));
+            }
+            break;
+
+         default:
+            return this->fail (kProgramError, slot);
+      }
+
+      defined[j / 64] |= uint64_t (1) << (j % 64);
+   }
+   }
+
+   // Next process all arguments.
+   //
+   bool optionsComplete = false;
+
+   {
+   INSTRUMENT_PHASE (kArgumentScan);
+
+   const size_t count = source.size();
+   for (size_t index = skipProgramName ? 1 : 0; index < count; index++) {
+
+      const char* arg = source.item (index);
+      const size_t length = source.length (index);
+      INSTRUMENT_COUNT (arguments, 1);
+
+      if (optionsComplete) {
+         // Just add the the parameter list
+         //
+         const int slot = -1;
+         VISIT (visitor.onParameter (arg, length));
+         continue;
+      }
+
+      if ((length == 2) && (arg[0] == '-') && (arg[1] == '-')) {
+         // "--" is the specual null option for no more options.
+         // Useful for when a paramaeter starts with -
+         //
+         optionsComplete = true;
+         continue;
+      }
+
+      if ((length == 0) || (arg[0] != '-')) {
+         // Not an option - so must is first paramter.
+         //
+         const int slot = -1;
+         VISIT (visitor.onParameter (arg, length));
+         optionsComplete = true;
+         continue;
+      }
+
+      // Start processing the options.
+      //
+      INSTRUMENT_COUNT (lookups, 1);
+      int slot = -1;
+      NameIndex::NameKind nameKind = NameIndex::kName;
+      if (length == 2) {
+         // Must be short form, e.g. -h, -x.
+         //
+         slot = this->m_index->findShort (arg[1]);
+      }
+
+      else if ((length >= 3) && (arg[1] == '-')) {
+         // Must be long form, e.g. --help, or one of the option's other names.
+         //
+         slot = this->m_index->findLong (arg + 2, length - 2, nameKind);
+
+      } else {
+         // Is something like: -xxx
+         //
+         return this->fail (kInvalidOptionFormat, -1, kFromArgument, arg, length);
+      }
+
+      if (slot < 0) {
+         return this->fail (kNoSuchOption, -1, kFromArgument, arg, length);
+      }
+
+      const OptionSpec* spec = this->m_specs[slot].get();
+
+      const uint64_t bit = uint64_t (1) << (slot % 64);
+      if (seen[slot / 64] & bit) {
+         return this->fail (kDuplicateOption, slot);
+      }
+      seen[slot / 64] |= bit;
+
+      // A flag turned off by its negation is not defined, so that it neither
+      // conflicts with, nor satisfies, a constraint.
+      //
+      if (nameKind == NameIndex::kNegation) {
+         defined[slot / 64] &= ~bit;
+      } else {
+         defined[slot / 64] |= bit;
+      }
+
+      // Still accepted, space permitting the use is reported by warnings.
+      //
+      if (nameKind == NameIndex::kDeprecated) {
+         Warning deprecated;
+         deprecated.slot = slot;
+         if (this->addText (arg, length, deprecated.name)) {
+            this->m_warnings.append (&deprecated, 1);
+         }
+      }
+
+      // All but flags require an argument.
+      //
+      const char* argValue = nullptr;
+      size_t argLength = 0;
+      if (spec->m_kind != OptionSpec::Kind::kFlag) {
+         if (index + 1 >= count) {
+            return this->fail (kMissingArgument, slot);
+         }
+         index++;
+         argValue = source.item (index);
+         argLength = source.length (index);
+      }
+
+      bool status;
+
+      switch (spec->m_kind) {
+         case OptionSpec::Kind::kFlag:
+            if (nameKind == NameIndex::kNegation) {
+               VISIT (visitor.onNegatedFlag (slot));
+            } else {
+               VISIT (visitor.onFlag (slot));
+            }
+            break;
+
+         case OptionSpec::Kind::kStr:
+            if (spec->m_pattern) {
+               INSTRUMENT_PHASE (kConversion);
+               if (!spec->m_pattern->matches (argValue, argLength)) {
+                  return this->fail (kPatternMismatch, slot, kFromArgument,
+                                     argValue, argLength);
+               }
+            }
+            if (spec->m_isProfile && !this->selectProfiles (argValue, argLength)) {
+               return this->fail (kNoSuchProfile, slot, kFromArgument, argValue, argLength);
+            }
+            VISIT (visitor.onStr (slot, argValue, argLength));
+            break;
+
+         case OptionSpec::Kind::kEnum:
+            {
+               intp_t enumIndex;
+               {
+                  INSTRUMENT_PHASE (kConversion);
+                  INSTRUMENT_COUNT (conversions, 1);
+                  enumIndex = spec->enumIndex (argValue, argLength);
+               }
+               if (enumIndex < 0) {
+                  return this->fail (kInvalidEnumValue, slot, kFromArgument,
+                                     argValue, argLength);
+               }
+               VISIT (visitor.onEnum (slot, enumIndex, argValue, argLength));
+            }
+            break;
+
+         case OptionSpec::Kind::kInt:
+            {
+               intp_t ival = 0;
+               {
+                  INSTRUMENT_PHASE (kConversion);
+                  INSTRUMENT_COUNT (conversions, 1);
+                  status = parseInt (argValue, ival);
+               }
+               if (!status) {
+                  return this->fail (kInvalidInteger, slot, kFromArgument,
+                                     argValue, argLength);
+               }
+
+               if (spec->m_rangeIsDefined) {
+                  if ((ival < spec->m_minValue.i) || (ival > spec->m_maxValue.i)) {
+                     this->m_errorInt = ival;
+                     return this->fail (kOutOfRange, slot);
+                  }
+               }
+               VISIT (visitor.onInt (slot, ival));
+            }
+            break;
+
+         case OptionSpec::Kind::kReal:
+            {
+               double real = 0.0;
+               {
+                  INSTRUMENT_PHASE (kConversion);
+                  INSTRUMENT_COUNT (conversions, 1);
+                  status = parseReal (argValue, real);
+               }
+               if (!status) {
+                  return this->fail (kInvalidReal, slot, kFromArgument,
+                                     argValue, argLength);
+               }
+
+               if (spec->m_rangeIsDefined) {
+                  if ((real < spec->m_minValue.r) || (real > spec->m_maxValue.r)) {
+                     this->m_errorReal = real;
+                     return this->fail (kOutOfRange, slot);
+                  }
+               }
+               VISIT (visitor.onReal (slot, real));
+            }
+            break;
+
+         case OptionSpec::Kind::kCustom:
+            {
+               CustomValue custom;
+               {
+                  INSTRUMENT_PHASE (kConversion);
+                  INSTRUMENT_COUNT (conversions, 1);
+                  status = spec->m_customType->parse (argValue, argLength, &custom);
+               }
+               if (!status) {
+                  return this->fail (kInvalidValue, slot, kFromArgument,
+                                     argValue, argLength);
+               }
+               VISIT (visitor.onCustom (slot, &custom, argValue, argLength));
+            }
+            break;
+
+         default:
+            return this->fail (kProgramError, slot);
+            break;
+      }
+
+      // A singleton option has been specified - this overrides all else.
+      //
+      if (spec->m_isSingleton) {
+         this->m_singletonGiven = true;
+         return true;
+      }
+   }
+
+   // Lastly the selected profiles' precomputed values, in order, for those
+   // options not given explicitly.
+   //
+   for (const int profile : this->m_selected) {
+      const PresetRange& range = this->m_presetRanges[profile];
+      for (uint32_t p = range.first; p < range.first + range.count; p++) {
+         const Preset& preset = this->m_presets[p];
+         const int slot = preset.slot;
+         const uint64_t bit = uint64_t (1) << (slot % 64);
+         if (seen[slot / 64] & bit) continue;
+         if ((preset.kind == OptionSpec::Kind::kFlag) && !preset.value.flag) {
+            defined[slot / 64] &= ~bit;   // turned off, as by a negation
+         } else {
+            defined[slot / 64] |= bit;
+         }
+         const char* str = this->textOf (preset.value.str);
+         VISIT (writer ? writer->applyPreset (preset, str) : visitPreset (visitor, preset, str));
+      }
+   }
+   }
+
+#undef VISIT
+
+   // Now verify that all required values have been defined, i.e. those that
+   // have no default. The first missing option in spec order is reported.
+   //
+   INSTRUMENT_PHASE (kValidation);
+   const uint64_t* const required = this->m_required.data();
+   for (size_t w = 0; w < words; w++) {
+      const uint64_t missing = required[w] & ~defined[w];
+      if (missing) {
+         return this->fail (kValueRequired, int (w * 64) + lowestBit (missing));
+      }
+   }
+
+   if (!this->m_rules.empty() && !this->checkConstraints()) {
+      const Rule& rule = this->m_rules[this->m_violated.front()];
+      return this->fail (kConstraintViolation, rule.subject);
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Note: once warmed up, i.e. once the text buffer and parameters have
+// sufficient capacity, process does not allocate memory for valid input.
+// Errors are recorded as a code plus context; the message is only formed
+// when requested by errorMessage.
+//
+bool Parsley::process (const Arguments& arguments,
+                       const bool skipProgramName) noexcept
+{
+   return this->processInto (arguments, skipProgramName, nullptr, nullptr);
+}
+
+//------------------------------------------------------------------------------
+// Bound options' values are written to their variables, with any members
+// being resolved against config (if any), which must be of the bound type.
+//
+bool Parsley::processInto (const Arguments& arguments, const bool skipProgramName,
+                           void* config, const void* type) noexcept
+{
+   AllocationScope scope;
+
+   this->clear ();
+   if (config && this->m_configType && (type != this->m_configType)) {
+      return this->fail (kProgramError, -1);
+   }
+
+   // Recording is best effort - any failure is ignored.
+   //
+   if (recorderFileDescriptor () >= 0) {
+#if defined(PARSLEY_EXCEPTIONS)
+      try {
+         this->record (arguments, skipProgramName);
+      } catch (...) { }
+#else
+      this->record (arguments, skipProgramName);
+#endif
+   }
+
+   return this->processSource (ArgumentList (arguments), skipProgramName, config);
+}
+
+//------------------------------------------------------------------------------
+// The arguments are only copied into an Arguments collection when recording.
+//
+bool Parsley::process (const int argc, const char* const* argv,
+                       const bool skipProgramName) noexcept
+{
+   AllocationScope scope;
+
+   this->clear ();
+
+   if (recorderFileDescriptor () >= 0) {
+#if defined(PARSLEY_EXCEPTIONS)
+      try {
+         this->record (formArguments (argc, argv), skipProgramName);
+      } catch (...) { }
+#else
+      this->record (formArguments (argc, argv), skipProgramName);
+#endif
+   }
+
+   return this->processSource (ArgumentVector (argc, argv), skipProgramName, nullptr);
+}
+
+//------------------------------------------------------------------------------
+// Common to both forms of process.
+//
+template <typename Source>
+bool Parsley::processSource (const Source& source, const bool skipProgramName,
+                             void* config) noexcept
+{
+   if (!this->m_specListOkay) {
+      return this->fail (this->m_specListError, -1);
+   }
+
+   // First set each slot to its default value. Any environment variable
+   // values are then stored by the slot writer, as are the arguments.
+   //
+   const size_t number = this->m_specs.size();
+   {
+   INSTRUMENT_PHASE (kEnvironment);
+   for (size_t slot = 0; slot < number; slot++) {
+
+      const OptionSpec* spec = this->m_specs[slot].get();
+      Slot& value = this->m_slots[slot];
+
+      value.isDefined = spec->m_defaultIsDefined;
+      value.flag = false;
+      value.ival = 0;
+      value.real = 0.0;
+      value.str = TextRef ();
+      value.isCustom = (spec->m_kind == OptionSpec::Kind::kCustom);
+
+      // A bound variable whose option has no default keeps its value.
+      //
+      void* target = spec->bindingTarget (config);
+      if (target) {
+         value.isDefined = false;
+         if (!spec->m_defaultIsDefined) continue;
+
+         const char* defaultStr = spec->text (OptionSpec::kDefaultStr);
+         const size_t defaultLength = spec->textLength (OptionSpec::kDefaultStr);
+
+         switch (spec->m_binding) {
+            case OptionSpec::kBindBool:
+               *static_cast<bool*> (target) = (spec->m_defaultValue.i != 0);
+               break;
+
+            case OptionSpec::kBindInt:
+               *static_cast<intp_t*> (target) = (spec->m_kind == OptionSpec::Kind::kEnum)
+                                                ? spec->enumIndex (defaultStr, defaultLength)
+                                                : spec->m_defaultValue.i;
+               break;
+
+            case OptionSpec::kBindReal:
+               *static_cast<double*> (target) = spec->m_defaultValue.r;
+               break;
+
+            case OptionSpec::kBindStr:
+               if (!assignText (target, defaultStr, defaultLength)) {
+                  return this->fail (kOutOfMemory, int (slot));
+               }
+               break;
+
+            default:
+               return this->fail (kProgramError, int (slot));
+         }
+         continue;
+      }
+
+      // Note: we often just copy undefined default values as is
+      // as opposed to doing a check - what would be the point?
+      //
+      switch (spec->m_kind) {
+         case OptionSpec::Kind::kFlag:
+            value.flag = (spec->m_defaultValue.i != 0);
+            break;
+
+         case OptionSpec::Kind::kStr:
+         case OptionSpec::Kind::kEnum:
+            if (!this->addText (spec->text (OptionSpec::kDefaultStr),
+                                spec->textLength (OptionSpec::kDefaultStr),
+                                value.str)) {
+               return this->fail (kOutOfMemory, int (slot));
+            }
+            if ((spec->m_kind == OptionSpec::Kind::kEnum) && value.isDefined) {
+               INSTRUMENT_COUNT (conversions, 1);
+               value.ival = spec->enumIndex (this->textOf (value.str), value.str.length);
+               if (value.ival < 0) {
+                  return this->fail (kInvalidEnumValue, int (slot), kFromDefault,
+                                     this->textOf (value.str), value.str.length);
+               }
+            }
+            break;
+
+         case OptionSpec::Kind::kInt:
+            value.ival = spec->m_defaultValue.i;
+            break;
+
+         case OptionSpec::Kind::kReal:
+            value.real = spec->m_defaultValue.r;
+            break;
+
+         case OptionSpec::Kind::kCustom:
+            if (!this->addText (spec->text (OptionSpec::kDefaultStr),
+                                spec->textLength (OptionSpec::kDefaultStr),
+                                value.str)) {
+               return this->fail (kOutOfMemory, int (slot));
+            }
+            if (value.isDefined) {
+               INSTRUMENT_COUNT (conversions, 1);
+               if (!spec->m_customType->parse (this->textOf (value.str), value.str.length,
+                                               &value.custom)) {
+                  return this->fail (kInvalidValue, int (slot), kFromDefault,
+                                     this->textOf (value.str), value.str.length);
+               }
+            }
+            break;
+
+         default:
+            return this->fail (kProgramError, int (slot));
+      }
+   }
+   }
+
+   SlotWriter writer (*this, config);
+   if (!this->scan (source, skipProgramName, writer, &writer)) {
+      if (writer.outOfMemory) return this->fail (kOutOfMemory, writer.failedSlot);
+      return false;
+   }
+
+   // As the required and constraint checks, the parameter expansion and the
+   // path checks are skipped when a singleton, e.g. --help, is given.
+   //
+   if (this->m_singletonGiven) return true;
+   return this->expandParameters () && this->checkPaths (config);
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::ReplayResult::ReplayResult ()
+{
+   this->replayed = 0;
+   this->skipped = 0;
+   this->failed = 0;
+   this->processNs = 0;
+   this->allocations = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::ReplayResult::~ReplayResult () {}
+
+//------------------------------------------------------------------------------
+// As process, but the invocation is not recorded, and only the process call
+// itself is timed.
+//
+bool Parsley::replay (const Invocations& corpus, const std::string& tool,
+                      const int repeat, ReplayResult& result)
+{
+   result = ReplayResult ();
+   result.digests.assign (corpus.size(), 0);
+
+   // The caller's values of the recorded variables, restored once done.
+   //
+   std::vector<Invocation::EnvironmentValue> saved;
+   for (const Invocation& invocation : corpus) {
+      for (const Invocation::EnvironmentValue& ev : invocation.environment) {
+         bool found = false;
+         for (const Invocation::EnvironmentValue& item : saved) {
+            found |= (item.name == ev.name);
+         }
+         if (found) continue;
+
+         Invocation::EnvironmentValue item;
+         const char* value = std::getenv (ev.name.c_str());
+         item.name = ev.name;
+         item.value = value ? value : "";
+         item.isDefined = (value != nullptr);
+         saved.push_back (item);
+      }
+   }
+
+   for (int r = 0; r < repeat; r++) {
+      for (size_t j = 0; j < corpus.size(); j++) {
+         const Invocation& invocation = corpus[j];
+         if (!tool.empty() && (invocation.tool != tool)) {
+            if (r == 0) result.skipped++;
+            continue;
+         }
+
+         for (const Invocation::EnvironmentValue& ev : invocation.environment) {
+            if (ev.isDefined) {
+               setenv (ev.name.c_str(), ev.value.c_str(), 1);
+            } else {
+               unsetenv (ev.name.c_str());
+            }
+         }
+
+         const uint64_t allocations = threadAllocations;
+         const uint64_t start = monotonicNs ();
+         bool status;
+         {
+            AllocationScope scope;
+            this->clear ();
+            status = this->processSource (ArgumentList (invocation.arguments),
+                                          invocation.skipProgramName, nullptr);
+         }
+         result.processNs += monotonicNs () - start;
+         result.allocations += threadAllocations - allocations;
+         result.replayed++;
+
+         if (r == 0) {
+            if (!status) result.failed++;
+            result.digests[j] = this->digest (status);
+         }
+      }
+   }
+
+   for (const Invocation::EnvironmentValue& item : saved) {
+      if (item.isDefined) {
+         setenv (item.name.c_str(), item.value.c_str(), 1);
+      } else {
+         unsetenv (item.name.c_str());
+      }
+   }
+
+   return result.replayed > 0;
+}
+
+//------------------------------------------------------------------------------
+// FNV-1a over the outcome of the last call to process: the error, or each
+// slot's value followed by the parameters. Never 0, which replay uses to
+// mark a skipped invocation.
+//
+static void fnv1a (uint64_t& hash, const void* data, const size_t size)
+{
+   const unsigned char* bytes = static_cast<const unsigned char*> (data);
+   for (size_t j = 0; j < size; j++) {
+      hash ^= bytes[j];
+      hash *= 0x100000001b3ULL;
+   }
+}
+
+uint64_t Parsley::digest (const bool status) const
+{
+   uint64_t hash = 0xcbf29ce484222325ULL;
+   if (!status) {
+      const std::string message = this->errorMessage ();
+      const int code = int (this->m_errorCode);
+      fnv1a (hash, &code, sizeof (code));
+      fnv1a (hash, message.data(), message.size());
+   } else {
+      for (const Slot& value : this->m_slots) {
+         const char state [2] = { char (value.isDefined), char (value.flag) };
+         fnv1a (hash, state, sizeof (state));
+         fnv1a (hash, &value.ival, sizeof (value.ival));
+         if (!value.isCustom) fnv1a (hash, &value.real, sizeof (value.real));
+         fnv1a (hash, this->textOf (value.str), value.str.length);
+         fnv1a (hash, "", 1);
+      }
+      for (size_t j = 0; j < this->parameterCount(); j++) {
+         const char* parameter = this->parameter (j);
+         fnv1a (hash, parameter, strlen (parameter) + 1);
+      }
+   }
+   return hash ? hash : 1;
+}
+
+//------------------------------------------------------------------------------
+// The slots are cleared, so that options and parameters do not refer to the
+// text of a previous call to process.
+//
+bool Parsley::visit (const Arguments& arguments, const bool skipProgramName,
+                     Visitor& visitor) noexcept
+{
+   AllocationScope scope;
+
+   this->clear ();
+   if (!this->m_specListOkay) {
+      return this->fail (this->m_specListError, -1);
+   }
+
+   for (Slot& value : this->m_slots) value = Slot ();
+   return this->scan (ArgumentList (arguments), skipProgramName, visitor);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Parsley::visit (const int argc, const char* const* argv, const bool skipProgramName,
+                     Visitor& visitor) noexcept
+{
+   AllocationScope scope;
+
+   this->clear ();
+   if (!this->m_specListOkay) {
+      return this->fail (this->m_specListError, -1);
+   }
+
+   for (Slot& value : this->m_slots) value = Slot ();
+   return this->scan (ArgumentVector (argc, argv), skipProgramName, visitor);
+}
+
+//------------------------------------------------------------------------------
+// The parameter text is held in the text buffer - once warmed up, this does
+// not allocate memory.
+//
+bool Parsley::addParameter (const char* str, const size_t length) noexcept
+{
+   TextRef ref;
+   if (!this->addText (str, length, ref)) return false;
+   if (!this->m_parameters.append (&ref, 1)) return false;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Appends a null terminated copy of str to the text buffer. Returns false if
+// the memory resource is exhausted.
+//
+bool Parsley::addText (const char* str, const size_t length, TextRef& ref) noexcept
+{
+   const size_t offset = this->m_text.size();
+   if (!this->m_text.append (str, length)) return false;
+   if (!this->m_text.append ("", 1)) {
+      this->m_text.truncate (offset);
+      return false;
+   }
+
+   ref.offset = uint32_t (offset);
+   ref.length = uint32_t (length);
+   INSTRUMENT_COUNT (bytesCopied, length);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+const char* Parsley::textOf (const TextRef& ref) const noexcept
+{
+   return this->m_text.data() + ref.offset;
+}
+
+//------------------------------------------------------------------------------
+// Records the error context - always returns false, so that process may
+// return this->fail (...). The offending value, if any, is copied into the
+// text buffer (space permitting) as the caller's value may not outlive the
+// call to process.
+//
+bool Parsley::fail (const ErrorCode code, const int slot, const ErrorSource source,
+                    const char* value, const size_t length) noexcept
+{
+   this->m_errorCode = code;
+   this->m_errorSlot = slot;
+   this->m_errorSource = source;
+   this->m_errorValue = TextRef ();
+   if (value) {
+      this->addText (value, length, this->m_errorValue);
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// Forms the message from the error context.
+//
+std::string Parsley::errorMessage() const
+{
+   if (this->m_errorCode == kNoError) return "";
+
+   const OptionSpec* spec = (this->m_errorSlot >= 0) ? this->m_specs[this->m_errorSlot].get()
+                                                     : nullptr;
+   const std::string value (this->textOf (this->m_errorValue), this->m_errorValue.length);
+
+   std::string source = "";
+   if (spec && (this->m_errorSource == kFromEnvironment)) {
+      source = "environment variable " + this->envVarName (*spec) + " ";
+   } else if (this->m_errorSource == kFromDefault) {
+      source = "default ";
+   }
+
+   switch (this->m_errorCode) {
+      case kSpecificationError:
+         return "option specification errors";
+
+      case kInvalidOptionFormat:
+         return "invalid option format: " + value;
+
+      case kNoSuchOption:
+         return "no such option: " + value;
+
+      case kDuplicateOption:
+         return "duplicate option: " + spec->name();
+
+      case kMissingArgument:
+         return "option " + spec->name() + " requires an argument.";
+
+      case kInvalidEnumValue:
+         return "invalid " + source + "value for " + spec->name() + " : " + value +
+                " is not one of " +  spec->enum_set();
+
+      case kInvalidInteger:
+         return "invalid " + source + "value for " + spec->name() + " : '" + value +
+                "' is not a valid integer.";
+
+      case kInvalidReal:
+         return "invalid " + source + "value for " + spec->name() + " : '" + value +
+                "' is not a valid floating point number.";
+
+      case kInvalidValue:
+         return "invalid " + source + "value for " + spec->name() + " : '" + value +
+                "' is not a valid " + spec->m_customType->name () + ".";
+
+      case kOutOfRange:
+         {
+            const std::string image = (spec->m_kind == OptionSpec::Kind::kReal)
+                                      ? real2str (this->m_errorReal)
+                                      : int2str (this->m_errorInt);
+            return "invalid value for " + spec->name() + " : " + image +
+                   " is out of range " + spec->range() + ".";
+         }
+
+      case kValueRequired:
+         return "a value is required for: " + spec->name();
+
+      case kConstraintViolation:
+         return "constraint not met: " +
+                this->m_constraints[this->m_violated.front()]->image();
+
+      case kNoSuchProfile:
+         return "no such profile: " + value;
+
+      case kPatternMismatch:
+         return "invalid " + source + "value for " + spec->name() + " : '" + value +
+                "' does not match the pattern " + spec->textStr (OptionSpec::kPattern);
+
+      case kPathCheckFailed:
+         {
+            std::string result = "path check failed: ";
+            const char* separator = "";
+            for (size_t j = 0; j < this->m_pathJobs.size(); j++) {
+               if (!this->m_pathJobs[j].failed) continue;
+               result += separator + this->pathMessage (this->m_pathJobs[j]);
+               separator = "; ";
+            }
+            return result;
+         }
+
+      case kOutOfMemory:
+         return "out of memory";
+
+      case kStopped:
+         return "processing stopped by the visitor";
+
+      case kProgramError:
+         if (this->m_errorSlot < 0) {
+            return "configuration struct is not of the type bound to the options";
+         }
+         return "*** program error";
+
+      default:
+         return "*** program error";
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::ErrorCode Parsley::errorCode () const noexcept
+{
+   return this->m_errorCode;
+}
+
+//------------------------------------------------------------------------------
+// static
+const char* Parsley::errorCodeName (const ErrorCode code) noexcept
+{
+   static const char* const names[] = {
+      "no error", "option specification error", "invalid option format",
+      "no such option", "duplicate option", "missing argument",
+      "invalid enumeration value", "invalid integer", "invalid floating point number", "invalid value",
+      "value out of range", "value required", "constraint violation", "no such profile",
+      "pattern mismatch", "path check failed",
+      "insufficient storage", "out of memory",
+      "stopped", "program error"
+   };
+   return ((code >= kNoError) && (code <= kProgramError)) ? names[code] : "unknown";
+}
+
+
+//==============================================================================
+// Constraints
+//==============================================================================
+//
+void Parsley::setConstraints (const Constraints& constraints)
+{
+   AllocationScope scope;
+
+   this->m_constraints.clear();
+   this->m_rules.clear();
+   this->m_ruleMasks.clear();
+   this->m_violated.clear();
+
+   const size_t number = this->m_specs.size();
+   const size_t words = (number + 63) / 64;
+   this->m_defaulted.assign (words, 0);
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      if (spec->m_defaultIsDefined && (spec->m_kind != OptionSpec::Kind::kFlag)) {
+         this->m_defaulted[slot / 64] |= uint64_t (1) << (slot % 64);
+      }
+   }
+
+   for (const ConstraintPointer& constraint : constraints) {
+      if (!constraint) continue;
+      const OptionNames& names = constraint->options();
+
+      // Form the mask, in order of word.
+      //
+      std::vector<uint64_t> mask (words, 0);
+      int subject = -1;
+      bool okay = true;
+      for (size_t j = 0; j < names.size(); j++) {
+         const int slot = this->m_index->findLong (names[j].data(), names[j].size());
+         if (slot < 0) {
+            warning ("constraint option '" + names[j] + "' does not exist - " +
+                     constraint->image());
+            okay = false;
+            continue;
+         }
+         if ((j == 0) && (constraint->kind() == Constraint::kDependsOn)) {
+            subject = slot;
+         } else {
+            mask[slot / 64] |= uint64_t (1) << (slot % 64);
+         }
+      }
+
+      if (!okay) {
+         this->m_specListOkay = false;
+         continue;
+      }
+
+      Rule rule;
+      rule.kind = constraint->kind();
+      rule.subject = subject;
+      rule.first = uint32_t (this->m_ruleMasks.size());
+      for (size_t w = 0; w < words; w++) {
+         if (mask[w] == 0) continue;
+         const MaskWord item = { uint32_t (w), mask[w] };
+         this->m_ruleMasks.push_back (item);
+      }
+      rule.count = uint32_t (this->m_ruleMasks.size()) - rule.first;
+
+      this->m_rules.push_back (rule);
+      this->m_constraints.push_back (constraint);
+   }
+
+   // So that recording the violations need not allocate.
+   //
+   this->m_violated.reserve (this->m_rules.size());
+}
+
+
+//==============================================================================
+// Profiles
+//==============================================================================
+//
+static bool parseSwitch (const std::string& value, bool& result)
+{
+   static const char* const on[] = { "", "on", "1", "Y", "YES", "true" };
+   static const char* const off[] = { "off", "0", "N", "NO", "false" };
+
+   for (const char* item : on) {
+      if (value == item) { result = true; return true; }
+   }
+   for (const char* item : off) {
+      if (value == item) { result = false; return true; }
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// Each setting is converted to the value the slot writer would have stored,
+// any text being kept in the retained start of the text buffer.
+//
+void Parsley::setProfiles (const Profiles& profiles)
+{
+   AllocationScope scope;
+
+   this->m_profiles.clear();
+   this->m_presetRanges.clear();
+   this->m_presets.clear();
+   this->m_selected.clear();
+   this->m_text.truncate (1);
+   this->m_textBase = 1;
+
+   for (const ProfilePointer& profile : profiles) {
+      if (!profile) continue;
+
+      PresetRange range;
+      range.first = uint32_t (this->m_presets.size());
+
+      bool okay = true;
+      for (const Profile::Setting& setting : profile->settings()) {
+         const std::string& name = setting.first;
+         const std::string& text = setting.second;
+         const std::string context = " in profile '" + profile->name() + "'";
+
+         NameIndex::NameKind nameKind = NameIndex::kName;
+         const int slot = this->m_index->findLong (name.data(), name.size(), nameKind);
+         if (slot < 0) {
+            warning ("option '" + name + "' does not exist" + context);
+            okay = false;
+            continue;
+         }
+
+         const OptionSpec* spec = this->m_specs[slot].get();
+         if (spec->m_isSingleton || spec->m_isProfile) {
+            warning (spec->name() + " may not be set" + context);
+            okay = false;
+            continue;
+         }
+
+         Preset preset;
+         preset.slot = slot;
+         preset.kind = spec->m_kind;
+         preset.value.isDefined = true;
+         preset.value.flag = false;
+         preset.value.ival = 0;
+         preset.value.real = 0.0;
+         preset.value.str = TextRef ();
+         preset.value.isCustom = (spec->m_kind == OptionSpec::Kind::kCustom);
+
+         bool valid = true;
+         bool inRange = true;
+         switch (spec->m_kind) {
+            case OptionSpec::Kind::kFlag:
+               valid = parseSwitch (text, preset.value.flag);
+               if (nameKind == NameIndex::kNegation) preset.value.flag = !preset.value.flag;
+               break;
+
+            case OptionSpec::Kind::kStr:
+               valid = !spec->m_pattern || spec->m_pattern->matches (text.data(), text.size());
+               break;
+
+            case OptionSpec::Kind::kEnum:
+               preset.value.ival = spec->enumIndex (text.data(), text.size());
+               valid = (preset.value.ival >= 0);
+               break;
+
+            case OptionSpec::Kind::kInt:
+               valid = parseInt (text.c_str(), preset.value.ival);
+               inRange = !spec->m_rangeIsDefined ||
+                         ((preset.value.ival >= spec->m_minValue.i) &&
+                          (preset.value.ival <= spec->m_maxValue.i));
+               break;
+
+            case OptionSpec::Kind::kReal:
+               valid = parseReal (text.c_str(), preset.value.real);
+               inRange = !spec->m_rangeIsDefined ||
+                         ((preset.value.real >= spec->m_minValue.r) &&
+                          (preset.value.real <= spec->m_maxValue.r));
+               break;
+
+            case OptionSpec::Kind::kCustom:
+               valid = spec->m_customType->parse (text.data(), text.size(),
+                                                  &preset.value.custom);
+               break;
+
+            default:
+               valid = false;
+               break;
+         }
+
+         if (!valid || !inRange) {
+            warning ("invalid value '" + text + "' for " + spec->name() + context +
+                     (valid ? " - out of range " + spec->range() : ""));
+            okay = false;
+            continue;
+         }
+
+         // Flags, integers and reals need no text.
+         //
+         const bool hasText = (spec->m_kind == OptionSpec::Kind::kStr) ||
+                              (spec->m_kind == OptionSpec::Kind::kEnum) ||
+                              (spec->m_kind == OptionSpec::Kind::kCustom);
+         if (hasText && !this->addText (text.data(), text.size(), preset.value.str)) {
+            this->m_specListOkay = false;
+            this->m_specListError = kOutOfMemory;
+            return;
+         }
+
+         this->m_presets.push_back (preset);
+      }
+
+      if (!okay) {
+         this->m_specListOkay = false;
+         this->m_presets.resize (range.first);
+         continue;
+      }
+
+      range.count = uint32_t (this->m_presets.size()) - range.first;
+      this->m_presetRanges.push_back (range);
+      this->m_profiles.push_back (profile);
+   }
+
+   this->m_textBase = this->m_text.size();
+
+   // So that selecting profiles need not allocate.
+   //
+   this->m_selected.reserve (this->m_profiles.size());
+}
+
+//------------------------------------------------------------------------------
+// Selects the comma separated profiles, in order, a repeated name once only.
+// Returns false if any name is not a profile.
+//
+bool Parsley::selectProfiles (const char* names, const size_t length) noexcept
+{
+   this->m_selected.clear();
+
+   size_t start = 0;
+   while (start <= length) {
+      size_t end = start;
+      while ((end < length) && (names[end] != ',')) end++;
+
+      const char* name = names + start;
+      const size_t size = end - start;
+
+      int found = -1;
+      for (size_t j = 0; j < this->m_profiles.size(); j++) {
+         const std::string& candidate = this->m_profiles[j]->name();
+         if ((candidate.size() == size) && (memcmp (candidate.data(), name, size) == 0)) {
+            found = int (j);
+            break;
+         }
+      }
+      if (found < 0) return false;
+
+      bool repeated = false;
+      for (const int selected : this->m_selected) {
+         if (selected == found) repeated = true;
+      }
+      if (!repeated) this->m_selected.push_back (found);
+
+      start = end + 1;
    }
 
-   return Parsley::OptionSpecPointer (clone);
+   return true;
 }
 
 //------------------------------------------------------------------------------
 //
-Parsley::OptionSpecPointer
-Parsley::OptionSpec::defInt (const intp_t defValue)
+static inline int bitCount (const uint64_t bits)
 {
-   OptionSpec* clone = new OptionSpec(*this);
+#if defined(__GNUC__)
+   return __builtin_popcountll (bits);
+#else
+   int result = 0;
+   for (uint64_t x = bits; x != 0; x &= x - 1) result++;
+   return result;
+#endif
+}
 
-   if (clone->m_kind != kInt) {
-      warning ("default integer value for " + this->info() + " ignored.");
-   } else if (clone->m_defaultIsDefined) {
-      warning ("secondary default value for " + this->info() + " ignored.");
-   } else {
-      if (clone->m_rangeIsDefined && (defValue < clone->m_minIntValue || defValue > clone->m_maxIntValue)) {
-         warning ("the default value for " + this->info() + " is out of range.");
+//------------------------------------------------------------------------------
+// Evaluates every rule against the defined bit set formed by scan.
+// Returns false if any rule is violated.
+//
+bool Parsley::checkConstraints () noexcept
+{
+   const uint64_t* present = this->m_defined.data();
+
+   const MaskWord* masks = this->m_ruleMasks.data();
+   const uint64_t* defaulted = this->m_defaulted.data();
+
+   for (size_t r = 0; r < this->m_rules.size(); r++) {
+      const Rule& rule = this->m_rules[r];
+      bool violated = false;
+
+      if (rule.kind == Constraint::kDependsOn) {
+         const int subject = rule.subject;
+         if ((present[subject / 64] >> (subject % 64)) & 1) {
+            for (uint32_t m = rule.first; m < rule.first + rule.count; m++) {
+               const uint64_t defined = present[masks[m].word] | defaulted[masks[m].word];
+               if ((defined & masks[m].bits) != masks[m].bits) violated = true;
+            }
+         }
+      } else {
+         int count = 0;
+         for (uint32_t m = rule.first; m < rule.first + rule.count; m++) {
+            count += bitCount (present[masks[m].word] & masks[m].bits);
+         }
+         switch (rule.kind) {
+            case Constraint::kConflicting:   violated = (count > 1);   break;
+            case Constraint::kExactlyOneOf:  violated = (count != 1);  break;
+            case Constraint::kAtLeastOneOf:  violated = (count == 0);  break;
+            default: break;
+         }
+      }
+
+      if (violated) this->m_violated.push_back (int (r));
+   }
+
+   return this->m_violated.empty();
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::Violations Parsley::violations () const
+{
+   Violations result;
+   if (this->m_errorCode != kConstraintViolation) return result;
+
+   for (const int r : this->m_violated) {
+      Violation item;
+      item.constraint = this->m_constraints[r];
+      item.message = item.constraint->image();
+      result.push_back (item);
+   }
+   return result;
+}
+
+
+//==============================================================================
+// Path checks
+//==============================================================================
+//
+// The failed check, other than a PathCheck, when the free space is too small.
+//
+static const unsigned kPathFreeSpace = 0x20;
+static const int maxPathThreads = 64;
+static const uint64_t pathCheckBudgetNs = 100000;
+
+//------------------------------------------------------------------------------
+//
+void Parsley::setParameterChecks (const unsigned checks, const uint64_t minFreeSpace)
+{
+   if ((checks & kPathIsFile) && (checks & kPathIsDirectory)) {
+      warning ("conflicting parameter path checks ignored.");
+      return;
+   }
+   this->m_parameterChecks = checks;
+   this->m_parameterFreeSpace = minFreeSpace;
+}
+
+//------------------------------------------------------------------------------
+//
+void Parsley::setPathCheckThreads (const int number)
+{
+   this->m_pathThreads = std::max (1, std::min (number, maxPathThreads));
+}
+
+//------------------------------------------------------------------------------
+// The jobs are shared by the threads, each taking the next unclaimed job.
+//
+struct Parsley::PathContext {
+   PathJob* jobs;
+   size_t count;
+   const char* text;
+   std::atomic<size_t> next;
+};
+
+//------------------------------------------------------------------------------
+// static
+void* Parsley::pathWorker (void* context)
+{
+   PathContext* work = static_cast<PathContext*> (context);
+   for (;;) {
+      const size_t j = work->next.fetch_add (1);
+      if (j >= work->count) break;
+      PathJob& job = work->jobs[j];
+      checkPath (work->text + job.path.offset, job);
+   }
+   return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// static
+// Makes the job's checks, recording the first that fails. A path that does
+// not exist, when it need not, is checked as to whether it may be created,
+// i.e. its directory is checked for writability and free space.
+//
+void Parsley::checkPath (const char* path, PathJob& job) noexcept
+{
+   struct stat status;
+   const bool exists = (stat (path, &status) == 0);
+   const unsigned mustExist = kPathExists | kPathIsFile | kPathIsDirectory | kPathReadable;
+
+   if (!exists && ((job.checks & mustExist) || (errno != ENOENT))) {
+      job.failed = kPathExists;
+      job.error = errno;
+      return;
+   }
+
+   if ((job.checks & kPathIsFile) && !S_ISREG (status.st_mode)) {
+      job.failed = kPathIsFile;
+      return;
+   }
+
+   if ((job.checks & kPathIsDirectory) && !S_ISDIR (status.st_mode)) {
+      job.failed = kPathIsDirectory;
+      return;
+   }
+
+   if ((job.checks & kPathReadable) && (access (path, R_OK) != 0)) {
+      job.failed = kPathReadable;
+      job.error = errno;
+      return;
+   }
+
+   // The directory of a path yet to be created.
+   //
+   char directory [PATH_MAX];
+   const char* subject = path;
+   if (!exists) {
+      const char* slash = strrchr (path, '/');
+      const size_t length = slash ? std::max (size_t (slash - path), size_t (1)) : 1;
+      if (length >= sizeof (directory)) {
+         job.failed = kPathExists;
+         job.error = ENAMETOOLONG;
+         return;
+      }
+      memcpy (directory, slash ? path : ".", length);
+      directory[length] = '\0';
+      subject = directory;
+   }
+
+   if ((job.checks & kPathWritable) && (access (subject, W_OK) != 0)) {
+      job.failed = kPathWritable;
+      job.error = errno;
+      return;
+   }
+
+   if (job.minFreeSpace > 0) {
+      struct statvfs fs;
+      if (statvfs (subject, &fs) != 0) {
+         job.failed = kPathFreeSpace;
+         job.error = errno;
+      } else if (uint64_t (fs.f_bavail) * uint64_t (fs.f_frsize) < job.minFreeSpace) {
+         job.failed = kPathFreeSpace;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Gathers the defined path option values and, if checked, the parameters,
+// and checks them all concurrently: the calling thread and up to
+// m_pathThreads - 1 others. Every failure is recorded, not just the first.
+//
+bool Parsley::checkPaths (void* config) noexcept
+{
+   if (this->m_pathSlots.empty() && !this->m_parameterChecks && !this->m_parameterFreeSpace) {
+      return true;
+   }
+   INSTRUMENT_PHASE (kValidation);
+
+   PathJob job;
+   job.failed = 0;
+   job.error = 0;
+
+   for (const int slot : this->m_pathSlots) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      job.slot = slot;
+      job.parameter = -1;
+      job.checks = spec->m_pathChecks;
+      job.minFreeSpace = spec->m_minFreeSpace;
+
+      // A bound variable without a value is not checked.
+      //
+      const std::string* target = static_cast<const std::string*> (spec->bindingTarget (config));
+      if (target) {
+         if (target->empty()) continue;
+         if (!this->addText (target->data(), target->size(), job.path)) {
+            return this->fail (kOutOfMemory, slot);
+         }
+      } else {
+         if (!this->m_slots[slot].isDefined) continue;
+         job.path = this->m_slots[slot].str;
+      }
+      if (spec->m_isGlob && Glob::isPattern (this->textOf (job.path), job.path.length)) {
+         if (!this->addPathJobs (job)) return false;
+         continue;
+      }
+      if (!this->m_pathJobs.append (&job, 1)) return this->fail (kOutOfMemory, slot);
+   }
+
+   if (this->m_parameterChecks || this->m_parameterFreeSpace) {
+      for (size_t j = 0; j < this->m_parameters.size(); j++) {
+         job.slot = -1;
+         job.parameter = int (j);
+         job.path = this->m_parameters[j];
+         job.checks = this->m_parameterChecks;
+         job.minFreeSpace = this->m_parameterFreeSpace;
+         if (!this->m_pathJobs.append (&job, 1)) return this->fail (kOutOfMemory, -1);
+      }
+   }
+
+   const size_t count = this->m_pathJobs.size();
+   PathContext context;
+   context.jobs = this->m_pathJobs.data();
+   context.count = count;
+   context.text = this->m_text.data();
+   context.next = 0;
+
+   // Local checks take a microsecond or so, far less than starting a thread,
+   // so the calling thread makes the checks alone until they have taken
+   // longer than pathCheckBudgetNs, e.g. on a network filesystem, and only then
+   // starts the other threads. Should a thread not start, the others take its
+   // share.
+   //
+   const size_t wanted = std::min (size_t (this->m_pathThreads), count);
+   pthread_t threads [maxPathThreads];
+   size_t started = 0;
+   bool starting = (wanted > 1);
+   const uint64_t start = monotonicNs ();
+   for (;;) {
+      const size_t j = context.next.fetch_add (1);
+      if (j >= count) break;
+      checkPath (context.text + context.jobs[j].path.offset, context.jobs[j]);
+
+      if (starting && (monotonicNs () - start > pathCheckBudgetNs)) {
+         starting = false;
+         while (started + 1 < wanted) {
+            if (pthread_create (&threads[started], nullptr, pathWorker, &context) != 0) break;
+            started++;
+         }
+      }
+   }
+   for (size_t t = 0; t < started; t++) pthread_join (threads[t], nullptr);
+
+   // The failed path is referred to, rather than copied into the text buffer.
+   //
+   for (size_t j = 0; j < count; j++) {
+      const PathJob& item = this->m_pathJobs[j];
+      if (item.failed) {
+         this->fail (kPathCheckFailed, item.slot);
+         this->m_errorValue = item.path;
+         return false;
+      }
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+std::string Parsley::pathMessage (const PathJob& job) const
+{
+   const std::string name = (job.slot >= 0)
+         ? "--" + this->m_specs[job.slot]->textStr (OptionSpec::kLongName)
+         : "parameter " + std::to_string (job.parameter + 1);
+   const std::string error = job.error ? strerror (job.error) : "";
+
+   std::string result = name + " '" + std::string (this->textOf (job.path), job.path.length) + "' ";
+   switch (job.failed) {
+      case kPathExists:
+         result += (job.error == ENOENT) ? "does not exist" : "cannot be examined: " + error;
+         break;
+
+      case kPathIsFile:
+         result += "is not a file";
+         break;
+
+      case kPathIsDirectory:
+         result += "is not a directory";
+         break;
+
+      case kPathReadable:
+         result += "is not readable";
+         break;
+
+      case kPathWritable:
+         result += "is not writable";
+         break;
+
+      case kPathFreeSpace:
+         result += job.error ? "free space cannot be determined: " + error
+                             : "has less than " + std::to_string (job.minFreeSpace) +
+                               " bytes free";
+         break;
+
+      default:
+         break;
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+Parsley::PathFailures Parsley::pathFailures () const
+{
+   PathFailures result;
+   if (this->m_errorCode != kPathCheckFailed) return result;
+
+   for (size_t j = 0; j < this->m_pathJobs.size(); j++) {
+      const PathJob& job = this->m_pathJobs[j];
+      if (!job.failed) continue;
+
+      PathFailure item;
+      item.option = (job.slot >= 0)
+            ? "--" + this->m_specs[job.slot]->textStr (OptionSpec::kLongName)
+            : "parameter " + std::to_string (job.parameter + 1);
+      item.path = std::string (this->textOf (job.path), job.path.length);
+      item.message = this->pathMessage (job);
+      result.push_back (item);
+   }
+   return result;
+}
+
+
+//------------------------------------------------------------------------------
+// A job for each match of the glob option value referred to by the job, or
+// for the value itself should nothing match.
+//
+bool Parsley::addPathJobs (PathJob& job) noexcept
+{
+#if defined(PARSLEY_EXCEPTIONS)
+   try {
+#endif
+      const TextRef value = job.path;
+      Glob glob (std::string (this->textOf (value), value.length), this->m_pathThreads);
+      size_t found = 0;
+      for (const char* path : glob) {
+         if (!this->addText (path, strlen (path), job.path) || !this->m_pathJobs.append (&job, 1)) {
+            return this->fail (kOutOfMemory, job.slot);
+         }
+         found++;
+      }
+      job.path = value;
+      if (!found && !this->m_pathJobs.append (&job, 1)) return this->fail (kOutOfMemory, job.slot);
+      return true;
+#if defined(PARSLEY_EXCEPTIONS)
+   } catch (const std::bad_alloc&) {
+      return this->fail (kOutOfMemory, job.slot);
+   }
+#endif
+}
+
+
+//==============================================================================
+// Glob
+//==============================================================================
+//
+// The pattern's components are the states of the walk, component n (beyond
+// the last) being the matching state. The set of states a name reaches, as a
+// bit set, determines whether it matches and, if it is a directory, the
+// states with which the directory is read. A ** component keeps its state
+// for the names within it.
+//
+// The caller walks the directories depth first, each in sorted order, while
+// the worker threads read the directories that it will soon need: up to
+// globReadAhead directories of each level, the deepest level first.
+//
+static const size_t maxGlobComponents = 63;
+static const size_t globReadAhead = 64;
+
+struct Parsley::Glob::Walk {
+   struct Component {
+      size_t offset;       // in m_pattern
+      size_t length;
+      bool isLiteral;
+      bool isRecursive;    // **
+   };
+
+   // A name kept from a directory: whether it matches and the states with
+   // which it is read as a directory (0 if not).
+   //
+   struct Entry {
+      uint64_t key;        // the name's first 8 bytes, big endian, for sorting
+      size_t offset;       // in names
+      bool isMatch;
+      uint64_t states;
+   };
+
+   enum Status { kQueued, kReading, kReady };
+
+   struct Directory {
+      std::string path;    // ending with '/', or empty for the current directory
+      uint64_t states;
+      Status status;
+      std::vector<char> names;      // null terminated, packed
+      std::vector<Entry> entries;   // in sorted order once read
+   };
+
+   struct Frame {
+      Directory* directory;
+      size_t next;                      // the next entry
+      size_t ahead;                     // the next entry to be read ahead
+      bool isRead;                      // the directory has been awaited
+      std::deque<Directory*> children;  // read ahead, in order
+   };
+
+   Walk (const std::string& pattern, const int threads);
+   ~Walk ();
+
+   const char* next ();
+   uint64_t closure (uint64_t states) const;
+   bool matches (const Component& component, const char* name) const;
+   void read (Directory& directory) const;
+   void consider (Directory& directory, const char* name, const unsigned char type,
+                  const int fd) const;
+   void await (Directory* directory);
+   void readAhead (Frame& frame);
+   static void* worker (void* context);
+
+   std::string m_pattern;
+   std::vector<Component> m_components;
+   uint64_t m_final;
+   bool m_directoriesOnly;
+   bool m_isLiteral;
+   bool m_isDelivered;                 // the literal pattern
+   std::string m_path;                 // the current match
+
+   std::vector<Frame> m_frames;
+   std::deque<Directory*> m_queue;
+   pthread_mutex_t m_mutex;
+   pthread_cond_t m_work;
+   pthread_cond_t m_ready;
+   pthread_t m_threads [maxPathThreads];
+   size_t m_wanted;
+   size_t m_started;
+   bool m_stopping;
+};
+
+//------------------------------------------------------------------------------
+//
+Parsley::Glob::Walk::Walk (const std::string& pattern, const int threads) :
+   m_pattern (pattern)
+{
+   pthread_mutex_init (&this->m_mutex, nullptr);
+   pthread_cond_init (&this->m_work, nullptr);
+   pthread_cond_init (&this->m_ready, nullptr);
+   this->m_wanted = size_t (std::max (1, std::min (threads, maxPathThreads)));
+   this->m_started = 0;
+   this->m_stopping = false;
+   this->m_final = 0;
+   this->m_isDelivered = false;
+
+   const size_t length = pattern.size();
+   this->m_isLiteral = !Glob::isPattern (pattern.data(), length);
+   this->m_directoriesOnly = (length > 1) && (pattern[length - 1] == '/');
+
+   // Empty components, as in "a//b", are skipped, and ** ** is as **.
+   //
+   for (size_t start = 0; !this->m_isLiteral && (start < length); ) {
+      size_t end = pattern.find ('/', start);
+      if (end == std::string::npos) end = length;
+      if (end > start) {
+         Component component;
+         component.offset = start;
+         component.length = end - start;
+         component.isLiteral = !Glob::isPattern (pattern.data() + start, end - start);
+         component.isRecursive = (pattern.compare (start, end - start, "**") == 0);
+         if (!component.isRecursive || this->m_components.empty() ||
+             !this->m_components.back().isRecursive) {
+            this->m_components.push_back (component);
+         }
+      }
+      start = end + 1;
+   }
+
+   // Too many components to walk: taken as is.
+   //
+   if (this->m_components.size() > maxGlobComponents) this->m_isLiteral = true;
+   if (this->m_isLiteral) return;
+
+   this->m_final = uint64_t (1) << this->m_components.size();
+   Frame frame;
+   frame.directory = new Directory;
+   frame.directory->path = (pattern[0] == '/') ? "/" : "";
+   frame.directory->states = this->closure (1);
+   frame.directory->status = kQueued;
+   frame.next = 0;
+   frame.ahead = 0;
+   frame.isRead = false;
+   this->m_frames.push_back (frame);
+}
+
+//------------------------------------------------------------------------------
+// Any directories still being read are awaited.
+//
+Parsley::Glob::Walk::~Walk ()
+{
+   pthread_mutex_lock (&this->m_mutex);
+   this->m_stopping = true;
+   pthread_cond_broadcast (&this->m_work);
+   pthread_mutex_unlock (&this->m_mutex);
+   for (size_t t = 0; t < this->m_started; t++) pthread_join (this->m_threads[t], nullptr);
+
+   for (Frame& frame : this->m_frames) {
+      delete frame.directory;
+      for (Directory* child : frame.children) delete child;
+   }
+   pthread_cond_destroy (&this->m_ready);
+   pthread_cond_destroy (&this->m_work);
+   pthread_mutex_destroy (&this->m_mutex);
+}
+
+//------------------------------------------------------------------------------
+// A ** component may match no directories at all.
+//
+uint64_t Parsley::Glob::Walk::closure (uint64_t states) const
+{
+   for (size_t s = 0; s < this->m_components.size(); s++) {
+      if (((states >> s) & 1) && this->m_components[s].isRecursive) {
+         states |= uint64_t (2) << s;
+      }
+   }
+   return states;
+}
+
+//------------------------------------------------------------------------------
+// Matches a name to a component with * ? and [...]; a failed match after a *
+// resumes from the * one character further on.
+//
+bool Parsley::Glob::Walk::matches (const Component& component, const char* name) const
+{
+   const char* p = this->m_pattern.data() + component.offset;
+   const char* const end = p + component.length;
+   const char* star = nullptr;
+   const char* resume = nullptr;
+
+   while (*name) {
+      if ((p < end) && (*p == '*')) {
+         star = ++p;
+         resume = name;
+         continue;
+      }
+
+      bool okay = false;
+      const char* after = p + 1;
+      if (p >= end) {
+         okay = false;
+      } else if (*p == '?') {
+         okay = true;
+      } else if (*p == '[') {
+         // A leading ] is a member, and a [ without a ] a literal.
+         //
+         const char* q = p + 1;
+         const bool negated = (q < end) && ((*q == '!') || (*q == '^'));
+         if (negated) q++;
+         const char* first = q;
+         while ((q < end) && ((*q != ']') || (q == first))) q++;
+         if (q < end) {
+            const unsigned char c = *name;
+            bool member = false;
+            for (const char* m = first; m < q; m++) {
+               if ((m + 2 < q) && (m[1] == '-')) {
+                  member |= (c >= (unsigned char) m[0]) && (c <= (unsigned char) m[2]);
+                  m += 2;
+               } else {
+                  member |= (c == (unsigned char) *m);
+               }
+            }
+            okay = (member != negated);
+            after = q + 1;
+         } else {
+            okay = (*name == '[');
+         }
+      } else {
+         okay = (*p == *name);
+      }
+
+      if (okay) {
+         p = after;
+         name++;
+      } else if (star) {
+         p = star;
+         name = ++resume;
+      } else {
+         return false;
+      }
+   }
+
+   while ((p < end) && (*p == '*')) p++;
+   return p == end;
+}
+
+//------------------------------------------------------------------------------
+// Reads the names of the directory that may match. When the directory is
+// read only with literal components there is nothing to list: each name is
+// looked up instead.
+//
+void Parsley::Glob::Walk::read (Directory& directory) const
+{
+   const uint64_t active = directory.states & ~this->m_final;
+   bool isLiteral = true;
+   for (size_t s = 0; s < this->m_components.size(); s++) {
+      if (((active >> s) & 1) && !this->m_components[s].isLiteral) isLiteral = false;
+   }
+
+   if (isLiteral) {
+      std::vector<std::string> names;
+      for (size_t s = 0; s < this->m_components.size(); s++) {
+         if (!((active >> s) & 1)) continue;
+         const Component& component = this->m_components[s];
+         names.push_back (this->m_pattern.substr (component.offset, component.length));
       }
-      clone->m_defaultInt = defValue;
-      clone->m_defaultIsDefined = true;
+      std::sort (names.begin(), names.end());
+      names.erase (std::unique (names.begin(), names.end()), names.end());
+      for (const std::string& name : names) {
+         this->consider (directory, name.c_str(), DT_UNKNOWN, -1);
+      }
+      return;
    }
 
-   return Parsley::OptionSpecPointer (clone);
+   DIR* stream = opendir (directory.path.empty() ? "." : directory.path.c_str());
+   if (!stream) return;   // as though empty
+
+   const int fd = dirfd (stream);
+   while (const struct dirent* item = readdir (stream)) {
+      const char* name = item->d_name;
+      if ((name[0] == '.') && ((name[1] == '\0') || ((name[1] == '.') && (name[2] == '\0')))) {
+         continue;
+      }
+      this->consider (directory, name, item->d_type, fd);
+   }
+   closedir (stream);
+
+   const char* names = directory.names.data();
+   std::sort (directory.entries.begin(), directory.entries.end(),
+              [names] (const Entry& a, const Entry& b) {
+                 if (a.key != b.key) return a.key < b.key;
+                 return strcmp (names + a.offset, names + b.offset) < 0;
+              });
 }
 
 //------------------------------------------------------------------------------
+// Keeps the name if it matches or is a directory to be read. A name beginning
+// with '.' is only matched explicitly, i.e. not by wildcards nor **.
 //
-Parsley::OptionSpecPointer
-Parsley::OptionSpec::intRange (const intp_t min, const intp_t max)
+void Parsley::Glob::Walk::consider (Directory& directory, const char* name,
+                                    const unsigned char type, const int fd) const
 {
-   OptionSpec* clone = new OptionSpec(*this);
+   const uint64_t active = directory.states & ~this->m_final;
+   const bool isHidden = (name[0] == '.');
+   uint64_t matched = 0;
+   uint64_t within = 0;
+   for (size_t s = 0; s < this->m_components.size(); s++) {
+      if (!((active >> s) & 1)) continue;
+      const Component& component = this->m_components[s];
+      if (component.isRecursive) {
+         if (!isHidden) within |= uint64_t (1) << s;
+      } else if ((!isHidden || (this->m_pattern[component.offset] == '.')) &&
+                 this->matches (component, name)) {
+         matched |= uint64_t (2) << s;
+      }
+   }
+   if (!(matched | within)) return;
 
-   if (clone->m_kind != kInt) {
-      warning ("integer range constraint for " + this->info() + " ignored.");
-   } else if (clone->m_rangeIsDefined) {
-      warning ("secondary range constraint for " + this->info() + " ignored.");
-   } else {
-      if (clone->m_defaultIsDefined && (clone->m_defaultInt < min || clone->m_defaultInt > max)) {
-         warning ("the default value for " + this->info() + " is out of range.");
+   const uint64_t reached = this->closure (matched | within);
+
+   // The type is only sought when needed. A ** is not followed into a
+   // symbolic link, in case of cycles.
+   //
+   bool isDirectory = (type == DT_DIR);
+   bool isRealDirectory = isDirectory;
+   if ((type == DT_UNKNOWN) || (type == DT_LNK)) {
+      if ((reached & ~this->m_final) || this->m_directoriesOnly || (fd < 0)) {
+         struct stat status;
+         const std::string path = (fd < 0) ? directory.path + name : std::string ();
+         const int at = (fd < 0) ? AT_FDCWD : fd;
+         const char* subject = (fd < 0) ? path.c_str() : name;
+         if (fstatat (at, subject, &status, AT_SYMLINK_NOFOLLOW) != 0) return;
+         isRealDirectory = S_ISDIR (status.st_mode);
+         isDirectory = isRealDirectory;
+         if (S_ISLNK (status.st_mode) && (fstatat (at, subject, &status, 0) == 0)) {
+            isDirectory = S_ISDIR (status.st_mode);
+         }
       }
-      clone->m_minIntValue = min;
-      clone->m_maxIntValue = max;
-      clone->m_rangeIsDefined = true;
    }
 
-   return Parsley::OptionSpecPointer (clone);
+   Entry entry;
+   entry.key = 0;
+   for (size_t j = 0; (j < 8) && name[j]; j++) {
+      entry.key |= uint64_t ((unsigned char) name[j]) << (56 - 8 * j);
+   }
+   entry.offset = directory.names.size();
+   entry.isMatch = (reached & this->m_final) && (isDirectory || !this->m_directoriesOnly);
+   entry.states = this->closure ((isDirectory ? matched : 0) | (isRealDirectory ? within : 0)) &
+                  ~this->m_final;
+   if (!entry.isMatch && !entry.states) return;
+
+   directory.names.insert (directory.names.end(), name, name + strlen (name) + 1);
+   directory.entries.push_back (entry);
 }
 
 //------------------------------------------------------------------------------
+// Should the directory not yet have been taken by a worker, the caller reads
+// it itself rather than wait.
 //
-Parsley::OptionSpecPointer
-Parsley::OptionSpec::defReal (const double defValue)
+void Parsley::Glob::Walk::await (Directory* directory)
 {
-   OptionSpec* clone = new OptionSpec(*this);
-
-   if (clone->m_kind != kReal) {
-      warning ("default real value for " + this->info() + " ignored.");
-   } else if (clone->m_defaultIsDefined) {
-      warning ("secondary default value for " + this->info() + " ignored.");
-   } else {
-      if (clone->m_rangeIsDefined && (defValue < clone->m_minRealValue || defValue > clone->m_maxRealValue)) {
-         warning ("the default value for " + this->info() + " is out of range.");
-      }       clone->m_defaultReal = defValue;
-      clone->m_defaultIsDefined = true;
+   pthread_mutex_lock (&this->m_mutex);
+   if (directory->status == kQueued) {
+      directory->status = kReading;
+      const auto position = std::find (this->m_queue.begin(), this->m_queue.end(), directory);
+      if (position != this->m_queue.end()) this->m_queue.erase (position);
+      pthread_mutex_unlock (&this->m_mutex);
+
+      this->read (*directory);
+      directory->status = kReady;
+      return;
    }
-
-   return Parsley::OptionSpecPointer (clone);
+   while (directory->status != kReady) {
+      pthread_cond_wait (&this->m_ready, &this->m_mutex);
+   }
+   pthread_mutex_unlock (&this->m_mutex);
 }
 
 //------------------------------------------------------------------------------
+// Queues the frame's directories yet to be read, up to globReadAhead of them,
+// ahead of those of the outer frames, which are needed later. The workers
+// are started once there are two or more directories to be read.
 //
-Parsley::OptionSpecPointer
-Parsley::OptionSpec::realRange (const double min, const double max)
+void Parsley::Glob::Walk::readAhead (Frame& frame)
 {
-   OptionSpec* clone = new OptionSpec (*this);
-
-   if (clone->m_kind != kReal) {
-      warning ("real range constraint for " + this->info() + " ignored.");
-   } else if (clone->m_rangeIsDefined) {
-      warning ("secondary range constraint for " + this->info() + " ignored.");
-   } else {
-      if (clone->m_defaultIsDefined && (clone->m_defaultReal < min || clone->m_defaultReal > max)) {
-         warning ("the default value for " + this->info() + " is out of range.");
+   const Directory* directory = frame.directory;
+   std::deque<Directory*> batch;
+   while ((frame.ahead < directory->entries.size()) && (frame.children.size() < globReadAhead)) {
+      const Entry& entry = directory->entries[frame.ahead++];
+      if (!entry.states) continue;
+
+      Directory* child = new Directory;
+      child->path = directory->path + &directory->names[entry.offset] + "/";
+      child->states = entry.states;
+      child->status = kQueued;
+      frame.children.push_back (child);
+      batch.push_back (child);
+   }
+   if (batch.empty()) return;
+
+   pthread_mutex_lock (&this->m_mutex);
+   this->m_queue.insert (this->m_queue.begin(), batch.begin(), batch.end());
+   if ((this->m_started == 0) && (this->m_queue.size() > 1)) {
+      while (this->m_started + 1 < this->m_wanted) {
+         if (pthread_create (&this->m_threads[this->m_started], nullptr, worker, this) != 0) break;
+         this->m_started++;
       }
-      clone->m_minRealValue = min;
-      clone->m_maxRealValue = max;
-      clone->m_rangeIsDefined = true;
    }
-
-   return Parsley::OptionSpecPointer (clone);
+   pthread_cond_broadcast (&this->m_work);
+   pthread_mutex_unlock (&this->m_mutex);
 }
 
 //------------------------------------------------------------------------------
-//
-Parsley::OptionSpecPointer Parsley::OptionSpec::envVar (const std::string& envVarName)
+// static
+void* Parsley::Glob::Walk::worker (void* context)
 {
-   OptionSpec* clone = new OptionSpec(*this);
+   Walk* walk = static_cast<Walk*> (context);
+   pthread_mutex_lock (&walk->m_mutex);
+   for (;;) {
+      while (!walk->m_stopping && walk->m_queue.empty()) {
+         pthread_cond_wait (&walk->m_work, &walk->m_mutex);
+      }
+      if (walk->m_stopping) break;
 
-   if (clone->m_evIsDefined) {
-      warning ("secondary environment variable for " + this->info() + " ignored.");
-   } else {
-      clone->m_evName = envVarName;
-      clone->m_evIsDefined = (envVarName.length() > 0);
-   }
+      Directory* directory = walk->m_queue.front();
+      walk->m_queue.pop_front();
+      directory->status = kReading;
+      pthread_mutex_unlock (&walk->m_mutex);
 
-   return Parsley::OptionSpecPointer (clone);
+      walk->read (*directory);
+
+      pthread_mutex_lock (&walk->m_mutex);
+      directory->status = kReady;
+      pthread_cond_broadcast (&walk->m_ready);
+   }
+   pthread_mutex_unlock (&walk->m_mutex);
+   return nullptr;
 }
 
 //------------------------------------------------------------------------------
-// Used for the error message.
+// A name is delivered before the names within it.
 //
-std::string Parsley::OptionSpec::name() const
+const char* Parsley::Glob::Walk::next ()
 {
-   if (this->m_shortName != '\0') {
-      return std::string ("-") + this->m_shortName + ", --" + this->m_longName;
-   } else {
-      return "--" + this->m_longName;
+   while (!this->m_frames.empty()) {
+      Frame& frame = this->m_frames.back();
+      Directory* directory = frame.directory;
+      if (!frame.isRead) {
+         this->await (directory);
+         frame.isRead = true;
+      }
+
+      if (frame.next >= directory->entries.size()) {
+         delete directory;
+         this->m_frames.pop_back();
+         continue;
+      }
+
+      this->readAhead (frame);
+      const Entry& entry = directory->entries[frame.next++];
+      this->m_path = directory->path;
+      this->m_path += &directory->names[entry.offset];
+
+      if (entry.states) {
+         Frame child;
+         child.directory = frame.children.front();
+         child.next = 0;
+         child.ahead = 0;
+         child.isRead = false;
+         frame.children.pop_front();
+         this->m_frames.push_back (child);   // frame is no longer valid
+      }
+
+      if (entry.isMatch) {
+         if (this->m_directoriesOnly) this->m_path += '/';
+         return this->m_path.c_str();
+      }
    }
+   return nullptr;
 }
 
 //------------------------------------------------------------------------------
-//
-std::string Parsley::OptionSpec::range() const
+// constructor
+Parsley::Glob::Glob (const std::string& pattern, const int threads) :
+   m_walk (new Walk (pattern, threads))
 {
-   if ((this->m_kind != kInt) && (this->m_kind != kReal)) return "";
-   if (!this->m_rangeIsDefined) return "";
-
-   std::string v1;
-   std::string v2;
+}
 
-   if (this->m_kind == kInt) {
-      v1 = int2str (this->m_minIntValue);
-      v2 = int2str (this->m_maxIntValue);
-   } else if (this->m_kind == kReal) {
-      v1 = real2str (this->m_minRealValue);
-      v2 = real2str (this->m_maxRealValue);
-   }
+//------------------------------------------------------------------------------
+// constructor
+Parsley::Glob::Glob (Glob&& other) noexcept :
+   m_walk (other.m_walk)
+{
+   other.m_walk = nullptr;
+}
 
-   char buffer [40];
-   snprintf (buffer, sizeof(buffer), "%s to %s", v1.c_str(), v2.c_str());
-   return std::string (buffer);
+//------------------------------------------------------------------------------
+// destructor
+Parsley::Glob::~Glob ()
+{
+   delete this->m_walk;
 }
 
 //------------------------------------------------------------------------------
+// A literal pattern, other than the empty pattern, is delivered once.
 //
-std::string Parsley::OptionSpec::enum_set() const
+const char* Parsley::Glob::next ()
 {
-   if (this->m_kind != kEnum) return "(nil)";
-   return "(" + Parsley::join (m_enumOptions, ", ") + ")";
+   Walk* walk = this->m_walk;
+   if (!walk) return nullptr;
+   if (walk->m_isLiteral) {
+      if (walk->m_pattern.empty() || walk->m_isDelivered) return nullptr;
+      walk->m_isDelivered = true;
+      return walk->m_pattern.c_str();
+   }
+   return walk->next ();
 }
 
 //------------------------------------------------------------------------------
-//
-std::string Parsley::OptionSpec::info () const
+// static
+bool Parsley::Glob::isPattern (const char* path, const size_t length) noexcept
 {
-   return "the " + kindImage (this->m_kind) + " option '" + this->m_longName + '\'';
+   for (size_t j = 0; j < length; j++) {
+      if ((path[j] == '*') || (path[j] == '?') || (path[j] == '[')) return true;
+   }
+   return false;
 }
 
 //------------------------------------------------------------------------------
 //
-std::string Parsley::OptionSpec::helpConstraint () const
+void Parsley::setGlobParameters (const bool expand)
 {
-   std::string result = "";
+   this->m_globParameters = expand;
+}
 
-   switch (this->m_kind) {
-      case kEnum:
-         result = "Allowed values: " + this->enum_set() + ". ";
-         break;
+//------------------------------------------------------------------------------
+// The expanded parameters are appended after the original parameters, which
+// are then removed. The matches' text is held in the text buffer.
+//
+bool Parsley::expandParameters () noexcept
+{
+   if (!this->m_globParameters) return true;
 
-      case kReal:
-      case kInt:
-         if (this->m_rangeIsDefined) {
-            result = "Range: " + this->range() + ". ";
+   const size_t number = this->m_parameters.size();
+   bool any = false;
+   for (size_t j = 0; j < number; j++) {
+      const TextRef& ref = this->m_parameters[j];
+      any |= Glob::isPattern (this->textOf (ref), ref.length);
+   }
+   if (!any) return true;
+
+#if defined(PARSLEY_EXCEPTIONS)
+   try {
+#endif
+      for (size_t j = 0; j < number; j++) {
+         const TextRef ref = this->m_parameters[j];
+         size_t found = 0;
+         if (Glob::isPattern (this->textOf (ref), ref.length)) {
+            Glob glob (std::string (this->textOf (ref), ref.length), this->m_pathThreads);
+            for (const char* path : glob) {
+               TextRef match;
+               if (!this->addText (path, strlen (path), match) ||
+                   !this->m_parameters.append (&match, 1)) {
+                  return this->fail (kOutOfMemory, -1);
+               }
+               found++;
+            }
          }
-         break;
-
-      default:
-         break;
+         if (!found && !this->m_parameters.append (&ref, 1)) return this->fail (kOutOfMemory, -1);
+      }
+#if defined(PARSLEY_EXCEPTIONS)
+   } catch (const std::bad_alloc&) {
+      return this->fail (kOutOfMemory, -1);
    }
+#endif
 
-   return result;
+   const size_t expanded = this->m_parameters.size() - number;
+   memmove (this->m_parameters.data(), this->m_parameters.data() + number,
+            expanded * sizeof (TextRef));
+   this->m_parameters.truncate (expanded);
+   return true;
 }
 
 //------------------------------------------------------------------------------
 //
-std::string Parsley::OptionSpec::helpDefault () const
+Parsley::Glob Parsley::matches (const std::string& longName) const
 {
-   if (!this->m_defaultIsDefined) return "";
-
-   std::string result = "Default value: ";
-
-   switch (this->m_kind) {
-      case kFlag:
-         result += "n/a";
-         break;
+   const int slot = this->m_index ? this->m_index->findLong (longName.data(), longName.size())
+                                  : -1;
+   if ((slot < 0) || !this->m_specs[slot]->m_isGlob || !this->m_slots[slot].isDefined) {
+      return Glob ("");
+   }
+   const TextRef& value = this->m_slots[slot].str;
+   return Glob (std::string (this->textOf (value), value.length), this->m_pathThreads);
+}
 
-      case kStr:
-      case kEnum:
-         result += "'" + this->m_defaultStr + "'";
-         break;
 
-      case kInt:
-         result += int2str (this->m_defaultInt);
-         break;
+//==============================================================================
+// Interpreter
+//==============================================================================
+//
+Parsley::Interpreter::Handler::Handler () {}
 
-      case kReal:
-         result += real2str (this->m_defaultReal);
-         break;
-   }
-   result += ". ";
+//------------------------------------------------------------------------------
+//
+Parsley::Interpreter::Handler::~Handler () {}
 
-   return result;
+//------------------------------------------------------------------------------
+// constructor
+Parsley::Interpreter::Interpreter (MemoryResource& resource) :
+   m_resource (&resource),
+   m_words (Allocator<const char*> (&resource))
+{
+   this->m_outcome = kEmpty;
+   this->m_failedVerb = nullptr;
 }
 
+//------------------------------------------------------------------------------
+// destructor
+Parsley::Interpreter::~Interpreter () {}
+
 //------------------------------------------------------------------------------
 //
-std::string Parsley::OptionSpec::helpEnvVar () const
+bool Parsley::Interpreter::addVerb (const std::string& verb,
+                                    const OptionSpecifications& specList,
+                                    Handler& handler,
+                                    const std::string& description)
 {
-   if (!this->m_evIsDefined) return "";
+   AllocationScope scope;
 
-   std::string result = "Use the " + this->m_evName + " environment variable to ";
+   if (verb.empty() || (verb.find_first_of (" \t\r\n'\"\\#") != std::string::npos)) {
+      warning ("invalid verb '" + verb + "' ignored.");
+      return false;
+   }
 
-   if (this->m_defaultIsDefined) {
-      result += "override the default value. ";
-   } else {
-      result += "provide a default value. ";
+   const auto position = std::lower_bound (this->m_verbs.begin(), this->m_verbs.end(), verb,
+                                           [] (const Verb& item, const std::string& name) {
+                                              return item.name < name;
+                                           });
+   if ((position != this->m_verbs.end()) && (position->name == verb)) {
+      warning ("duplicate verb '" + verb + "' ignored.");
+      return false;
    }
 
-   return result;
+   Verb item;
+   item.name = verb;
+   item.description = description;
+   item.parser = std::allocate_shared<Parsley> (Allocator<Parsley> (this->m_resource),
+                                                specList, *this->m_resource);
+   item.values = std::allocate_shared<OptionValues> (Allocator<OptionValues> (this->m_resource),
+                                                     *this->m_resource);
+   item.handler = &handler;
+   this->m_verbs.insert (position, item);
+   this->m_failedVerb = nullptr;   // may have moved
+   return true;
 }
 
-
-//==============================================================================
-// Parsley::OptionValue
-//==============================================================================
+//------------------------------------------------------------------------------
+// Splits the line into words, in place: each word is unquoted by moving its
+// characters down, and is null terminated. False if a quote is not closed.
 //
-Parsley::OptionValue::OptionValue ()
+template <typename Words>
+static bool splitWords (char* line, Words& words)
 {
-   this->isDefined = false;
-   this->flag = false;
-   this->str = "";
-   this->ival = 0;
-   this->real = 0.0;
+   char* from = line;
+   for (;;) {
+      while (*from && isspace ((unsigned char) *from)) from++;
+      if (!*from || (*from == '#')) return true;
+
+      char* to = from;
+      words.push_back (to);
+      char quote = '\0';
+      while (*from) {
+         const char c = *from;
+         if (quote) {
+            if (c == quote) {
+               quote = '\0';
+               from++;
+            } else if ((quote == '"') && (c == '\\') && ((from[1] == '"') || (from[1] == '\\'))) {
+               *to++ = from[1];
+               from += 2;
+            } else {
+               *to++ = *from++;
+            }
+         } else if (isspace ((unsigned char) c)) {
+            break;
+         } else if ((c == '\'') || (c == '"')) {
+            quote = c;
+            from++;
+         } else if ((c == '\\') && from[1]) {
+            *to++ = from[1];
+            from += 2;
+         } else {
+            *to++ = *from++;
+         }
+      }
+      if (quote) return false;
+
+      // to <= from, so the terminator replaces at most the separator.
+      //
+      const bool isLast = (*from == '\0');
+      *to = '\0';
+      if (isLast) return true;
+      from++;
+   }
 }
 
 //------------------------------------------------------------------------------
+// The handler is called outside the allocation scope, as its allocations are
+// the caller's own.
 //
-Parsley::OptionValue::~OptionValue () {}
-
-
-//==============================================================================
-// Parsley::ProxyValue
-//==============================================================================
-//
-class Parsley::ProxyValue {
-public:
-   ~ProxyValue();     // this needs to be public
-
-private:
-   explicit ProxyValue();
+bool Parsley::Interpreter::execute (char* line)
+{
+   const Verb* verb = nullptr;
+   {
+      AllocationScope scope;
 
-   // These members get copied to an OptionValue by the [] operator out of
-   // the OptionValues class.
-   //
-   bool isDefined;    // either explicitly or by default
-   bool flag;
-   std::string str;   // str or enum value
-   intp_t ival;       // int value or enum index
-   double real;
+      this->m_words.clear();
+      if (!splitWords (line, this->m_words)) return this->failed (kUnterminatedQuote, nullptr, nullptr);
+      if (this->m_words.empty()) {
+         this->m_outcome = kEmpty;
+         return true;
+      }
 
-   bool m_alreadySpecified;             // for inernal use to detect duplicates.
-   Parsley::OptionSpecPointer m_spec;   // the associated option spec
+      const char* word = this->m_words[0];
+      const auto position = std::lower_bound (this->m_verbs.begin(), this->m_verbs.end(), word,
+                                              [] (const Verb& item, const char* name) {
+                                                 return strcmp (item.name.c_str(), name) < 0;
+                                              });
+      if ((position == this->m_verbs.end()) || (position->name != word)) {
+         return this->failed (kNoSuchVerb, nullptr, word);
+      }
+      verb = &*position;
 
-   friend class Parsley;
-};
+      if (!verb->parser->process (int (this->m_words.size()), this->m_words.data(), true)) {
+         return this->failed (kInvalidCommand, verb, nullptr);
+      }
+      verb->parser->options (*verb->values);
+   }
 
+   if (!verb->handler->onCommand (verb->name.c_str(), *verb->parser, *verb->values)) {
+      return this->failed (kCommandFailed, verb, nullptr);
+   }
+   this->m_outcome = kExecuted;
+   return true;
+}
 
-//==============================================================================
+//------------------------------------------------------------------------------
 //
-Parsley::ProxyValue::ProxyValue ()
+size_t Parsley::Interpreter::run (std::istream& input, std::ostream& errors)
 {
-   this->isDefined = false;
-   this->flag = false;
-   this->str = "";
-   this->ival = 0;
-   this->real = 0.0;
-   this->m_alreadySpecified = false;
+   size_t failures = 0;
+   size_t number = 0;
+   while (std::getline (input, this->m_line)) {
+      number++;
+      if (!this->execute (&this->m_line[0])) {
+         errors << "line " << number << ": " << this->errorMessage() << nl;
+         failures++;
+      }
+   }
+   return failures;
 }
 
 //------------------------------------------------------------------------------
 //
-Parsley::ProxyValue::~ProxyValue () {}
-
-
-//==============================================================================
-// Parsley::OptionValues
-//==============================================================================
-//
-Parsley::OptionValues::OptionValues () {}
+Parsley::Interpreter::Outcome Parsley::Interpreter::outcome () const noexcept
+{
+   return this->m_outcome;
+}
 
 //------------------------------------------------------------------------------
 //
-Parsley::OptionValues::~OptionValues ()
+std::string Parsley::Interpreter::errorMessage () const
 {
-   this->theMap.clear();
+   const Verb* verb = this->m_failedVerb;
+   switch (this->m_outcome) {
+      case kNoSuchVerb:
+         return "no such command: " + this->m_failedWord;
+
+      case kUnterminatedQuote:
+         return "unterminated quote";
+
+      case kInvalidCommand:
+         return verb ? verb->name + ": " + verb->parser->errorMessage() : "invalid command";
+
+      case kCommandFailed:
+         return verb ? verb->name + ": command failed" : "command failed";
+
+      default:
+         return "";
+   }
 }
 
 //------------------------------------------------------------------------------
 //
-void Parsley::OptionValues::clear ()
+Parsley* Parsley::Interpreter::parser (const std::string& verb) const
 {
-   this->theMap.clear();
+   for (const Verb& item : this->m_verbs) {
+      if (item.name == verb) return item.parser.get();
+   }
+   return nullptr;
 }
 
 //------------------------------------------------------------------------------
 //
-void Parsley::OptionValues::set (const std::string& option,
-                                 const ProxyValuePointer& value)
+std::ostream& Parsley::Interpreter::commandHelp (std::ostream& stream) const
 {
-   this->theMap[option] = value;
+   stream << "Commands:" << nl;
+   for (const Verb& item : this->m_verbs) {
+      stream << formatLongLine (helpGap, item.name, item.description, 92);
+   }
+   return stream;
 }
 
 //------------------------------------------------------------------------------
 //
-Parsley::OptionValue
-Parsley::OptionValues::operator[] (const std::string& option) const
+bool Parsley::Interpreter::failed (const Outcome outcome, const Verb* verb, const char* word)
 {
-   auto entry = this->theMap.find(option);
-   if (entry == this->theMap.end()) {
-      OptionValue empty = OptionValue();
-      return empty;
-   } else {
-      OptionValue item;
-      // Recall entry->second is a ProxyValuePointer
-      if (entry->second) {
-         item.isDefined = entry->second->isDefined;
-         item.flag = entry->second->flag;
-         item.str = entry->second->str;
-         item.ival = entry->second->ival;
-         item.real = entry->second->real;
-      }
-
-      return item;
-   }
+   this->m_outcome = outcome;
+   this->m_failedVerb = verb;
+   this->m_failedWord = word ? word : "";
+   return false;
 }
 
 
 //==============================================================================
-// Parsley
+// Environment prefix
 //==============================================================================
-// static
-Parsley::Arguments Parsley::formArguments (const int argc,
-                                           const char* const* argv)
-{
-   Arguments result;
-   result.reserve (argc);
-
-   for (int j = 0; j < argc; j++) {
-      const std::string arg = argv[j];
-      result.push_back (arg);
-   }
-
-   return result;
-}
+//
+extern char** environ;
 
 //------------------------------------------------------------------------------
-// static
-int Parsley::indexOf (const EnumOptions& opts,
-                      const std::string& value)
+// The prefix, then the long name in upper case with hyphens replaced by
+// underscores.
+//
+static std::string mangledName (const std::string& prefix, const std::string& longName)
 {
-   int index = -1;
-   for (std::string item : opts) {
-      index++;
-      if (value == item) {
-         return index;
-      }
+   std::string result = prefix;
+   for (const char c : longName) {
+      result += (c == '-') ? '_' : char (toupper ((unsigned char) c));
    }
-   return -1;
+   return result;
 }
 
 //------------------------------------------------------------------------------
-// constructor
-Parsley::Parsley (const OptionSpecifications& specList) :
-   m_specList (specList)
+// The index holds the options' own variable names having the prefix, so that
+// these are not reported as unknown, followed by the mapped names. A mapped
+// name already in use is not mapped.
+//
+void Parsley::envPrefix (const std::string& prefix)
 {
-   // Set defaults.
-   //
-   this->m_cpl = 92;
-   this->m_extraNewLine = false;
-   this->m_includeNoMore = false;
-
-   this->m_specListOkay = true;   // hypothesize ok
+   AllocationScope scope;
+
+   this->m_envPrefix = prefix;
+   this->m_envIndex.reset ();
+   this->m_envValues.clear ();
+   this->m_warnings.truncate (0);
+   if (prefix.empty()) return;
+
+   const size_t number = this->m_specs.size();
+   std::shared_ptr<NameIndex> index = std::allocate_shared<NameIndex>
+         (Allocator<NameIndex> (this->m_resource), 2 * number, *this->m_resource);
+
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      if (!spec->m_evIsDefined) continue;
+      const char* name = spec->text (OptionSpec::kEvName);
+      const size_t length = spec->textLength (OptionSpec::kEvName);
+      if (strncmp (name, prefix.data(), prefix.size()) != 0) continue;
+      index->insertLong (name, length, int (slot));   // may be shared
+   }
 
-   // check for duplicates
-   // Note: specList is a list not a vector so we have do own quazi indexing
-   //
-   int skip = 0;
-   for (OptionSpecPointer specA : specList) {
-      skip++;
-
-      int count = 0;
-      for (OptionSpecPointer specB : specList) {
-         count++;
-         if (count <= skip) continue;
-
-         if ((specA->m_longName == specB->m_longName) ||
-             ((specA->m_shortName != '\0') && (specA->m_shortName == specB->m_shortName))) {
-             warning ("conflicting option names: " + specA->name() +
-                      " and " + specB->name());
-             this->m_specListOkay = false;
-         }
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      if (spec->m_evIsDefined || spec->m_isSingleton) continue;
+      const std::string name = mangledName (prefix, spec->textStr (OptionSpec::kLongName));
+      const int existing = index->insertLong (name.data(), name.size(), int (slot));
+      if (existing >= 0) {
+         warning ("environment variable " + name + " for " + spec->name() +
+                  " is already used by " + this->m_specs[existing]->name() +
+                  " - not mapped.");
       }
    }
+
+   this->m_envIndex = index;
+   this->m_envValues.assign (number, nullptr);
 }
 
 //------------------------------------------------------------------------------
-// destructor
-Parsley::~Parsley () { }
+// The option's own environment variable, else its mapped name, if any.
+//
+std::string Parsley::envVarName (const OptionSpec& spec) const
+{
+   if (spec.m_evIsDefined) return spec.textStr (OptionSpec::kEvName);
+   if (!this->m_envIndex || spec.m_isSingleton) return "";
+
+   const std::string name = mangledName (this->m_envPrefix,
+                                         spec.textStr (OptionSpec::kLongName));
+   const int slot = this->m_envIndex->findLong (name.data(), name.size());
+   if ((slot < 0) || (this->m_specs[slot].get() != &spec)) return "";
+   return name;
+}
 
 //------------------------------------------------------------------------------
+// The single pass over the environment: each variable having the prefix is
+// looked up in the index - no name is formed and no getenv is called.
+// The unknown variable names are copied into the text buffer, space permitting.
 //
-void Parsley::setOptionHelpCpl (const int cpl)
+void Parsley::scanEnvironment () noexcept
 {
-   this->m_cpl = cpl >= 40 ? cpl : 40;   // ensure sensible
+   const char** values = this->m_envValues.data();
+   const size_t number = this->m_envValues.size();
+   for (size_t j = 0; j < number; j++) values[j] = nullptr;
+
+   const char* prefix = this->m_envPrefix.data();
+   const size_t prefixLength = this->m_envPrefix.size();
+
+   for (char** envp = environ; envp && *envp; envp++) {
+      const char* item = *envp;
+      if (strncmp (item, prefix, prefixLength) != 0) continue;
+      const char* equals = strchr (item + prefixLength, '=');
+      if (!equals) continue;
+
+      INSTRUMENT_COUNT (envLookups, 1);
+      const size_t length = size_t (equals - item);
+      const int slot = this->m_envIndex->findLong (item, length);
+      if (slot < 0) {
+         Warning unknown;
+         unknown.slot = -1;
+         if (this->addText (item, length, unknown.name)) this->m_warnings.append (&unknown, 1);
+      } else if (!this->m_specs[slot]->m_evIsDefined) {
+         values[slot] = equals + 1;
+      }
+   }
 }
 
 //------------------------------------------------------------------------------
+// As scanEnvironment, but for the one option and the given environment, for
+// processSafe. This neither allocates nor modifies the parser.
 //
-void Parsley::setOptionNewLineSeparator (const bool extraNewLine)
+const char* Parsley::mappedEnv (const char* const* envp, const int slot) const noexcept
 {
-   this->m_extraNewLine = extraNewLine;
+   if (!envp) return nullptr;
+
+   const char* prefix = this->m_envPrefix.data();
+   const size_t prefixLength = this->m_envPrefix.size();
+
+   for (; *envp; envp++) {
+      const char* item = *envp;
+      if (strncmp (item, prefix, prefixLength) != 0) continue;
+      const char* equals = strchr (item + prefixLength, '=');
+      if (!equals) continue;
+      if (this->m_envIndex->findLong (item, size_t (equals - item)) == slot) {
+         return equals + 1;
+      }
+   }
+   return nullptr;
 }
 
 //------------------------------------------------------------------------------
 //
-void Parsley::setOptionIncludeNoMore (const bool includeNoMore)
+Parsley::Arguments Parsley::warnings () const
 {
-   this->m_includeNoMore = includeNoMore;
+   AllocationScope scope;
+
+   Arguments result;
+   for (size_t j = 0; j < this->m_warnings.size(); j++) {
+      const Warning& item = this->m_warnings[j];
+      const std::string name (this->textOf (item.name), item.name.length);
+      if (item.slot < 0) {
+         result.push_back ("unknown environment variable " + name);
+      } else {
+         result.push_back ("option " + name + " is deprecated, use --" +
+                           this->m_specs[item.slot]->textStr (OptionSpec::kLongName) +
+                           " instead");
+      }
+   }
+   return result;
+}
+
+//==============================================================================
+// Completion queries
+//==============================================================================
+//
+// The slot of the option given by an argument, or -1.
+//
+int Parsley::lookup (const char* arg, const size_t length) const
+{
+   if ((length == 2) && (arg[0] == '-')) {
+      return this->m_index->findShort (arg[1]);
+   }
+   if ((length >= 3) && (arg[0] == '-') && (arg[1] == '-')) {
+      return this->m_index->findLong (arg + 2, length - 2);
+   }
+   return -1;
 }
 
 //------------------------------------------------------------------------------
+// The words preceding the current word are scanned as process would, so as
+// to determine if the current word is an option, an option value, or a
+// parameter. Parameters are left to the shell.
 //
-std::ostream& Parsley::optionHelp (std::ostream& os)
+template <typename Source>
+bool Parsley::complete (const Source& source, const bool skipProgramName,
+                        std::ostream& os) const
 {
-   static const std::string gap = "                    ";
-   static const size_t gapSize = gap.size();
+   const size_t first = skipProgramName ? 1 : 0;
+   if (source.size() < first + 2) return false;
+   if (strcmp (source.item (first), completeQueryOption) != 0) return false;
+
+   if (!this->m_specListOkay) return true;
 
-   os << "Options:" << nl;
+   // The words start with the program name.
+   //
+   intp_t cword = 0;
+   const size_t words = first + 2;
+   const size_t number = source.size() - words;
+   if (!parseInt (source.item (first + 1), cword) || (cword < 1) ||
+       (size_t (cword) > number)) {
+      return true;
+   }
 
-   for (OptionSpecPointer spec : this->m_specList) {
+   const char* current = (size_t (cword) < number) ? source.item (words + cword) : "";
+   const size_t currentLength = (size_t (cword) < number) ? source.length (words + cword) : 0;
 
-      const bool literalDescription =
-            (spec->m_description.size() >= 1) && (spec->m_description[0] == '!');
+   int valueSlot = -1;
+   bool optionsComplete = false;
+   for (size_t k = 1; k < size_t (cword); k++) {
+      const char* arg = source.item (words + k);
+      const size_t length = source.length (words + k);
+      if ((length == 2) && (arg[0] == '-') && (arg[1] == '-')) {
+         optionsComplete = true;
+         break;
+      }
+      if ((length == 0) || (arg[0] != '-')) {
+         optionsComplete = true;
+         break;
+      }
 
-      if (literalDescription) {
-         const std::string desc = spec->m_description.substr(1);   // Drop the '!'
-         const std::list<std::string> ds = splitString (desc, "\n", true);
+      const int slot = this->lookup (arg, length);
+      if ((slot >= 0) && (this->m_specs[slot]->m_kind != OptionSpec::Kind::kFlag)) {
+         if (k + 1 == size_t (cword)) valueSlot = slot;
+         k++;   // skip the value
+      }
+   }
 
-         std::string prefix = spec->name() + " ";   // always want at least one space
-         while (prefix.size() < gapSize) prefix += " ";
-         for (std::string part : ds) {
-            os << prefix << part << nl;
-            prefix = gap;
+   if (valueSlot >= 0) {
+      const OptionSpec* spec = this->m_specs[valueSlot].get();
+      for (int j = 0; j < spec->enumCount(); j++) {
+         const int item = OptionSpec::kFirstEnumOption + j;
+         const size_t length = spec->textLength (item);
+         if ((length >= currentLength) &&
+             (memcmp (spec->text (item), current, currentLength) == 0)) {
+            os << spec->text (item) << nl;
          }
-
-      } else {
-         // Just use regular long line formatting
-         //
-         os << formatLongLine (gap, spec->name(), spec->m_description, this->m_cpl);
       }
+      return true;
+   }
 
-      std::string extra = "";
-      if (spec->m_isRequired && !spec->m_defaultIsDefined) {
-         // If a default is defined, then input is not required per se.
-         extra += "Required. ";
+   if (optionsComplete || (currentLength == 0) || (current[0] != '-')) {
+      return true;
+   }
+
+   // Just "-" matches the short names as well as the long names.
+   //
+   if (currentLength <= 2) {
+      for (const OptionSpecPointer& spec : this->m_specs) {
+         if (spec->m_isHidden || (spec->m_shortName == '\0')) continue;
+         if ((currentLength == 2) && (spec->m_shortName != current[1])) continue;
+         os << '-' << spec->m_shortName << nl;
       }
+   }
 
-      switch (spec->m_kind) {
-         case OptionSpec::Kind::kFlag:
-            if (spec->m_evIsDefined) {
-               extra += "Use the " + spec->m_evName +
-                        " environment variable set to 'Y', 'YES' or '1' to set flag on. ";
-            }
-            break;
+   if ((currentLength == 1) || (current[1] == '-')) {
+      const size_t prefix = (currentLength >= 2) ? 2 : 1;
+      this->m_index->matchLong (current + prefix, currentLength - prefix, [&] (const int slot) {
+         const OptionSpec* spec = this->m_specs[slot].get();
+         if (!spec->m_isHidden) os << "--" << spec->text (OptionSpec::kLongName) << nl;
+      });
+   }
 
-         case OptionSpec::Kind::kStr:
-            extra += spec->helpDefault();
-            extra += spec->helpEnvVar();
-            break;
+   return true;
+}
 
-         case OptionSpec::Kind::kEnum:
-         case OptionSpec::Kind::kInt:
-         case OptionSpec::Kind::kReal:
-            extra += spec->helpConstraint();
-            extra += spec->helpDefault();
-            extra += spec->helpEnvVar();
-            break;
+//------------------------------------------------------------------------------
+//
+bool Parsley::completionQuery (const Arguments& arguments, const bool skipProgramName,
+                               std::ostream& stream) const
+{
+   AllocationScope scope;
+   return this->complete (ArgumentList (arguments), skipProgramName, stream);
+}
 
-         default:
-            break;
-      }
+//------------------------------------------------------------------------------
+//
+bool Parsley::completionQuery (const int argc, const char* const* argv,
+                               const bool skipProgramName, std::ostream& stream) const
+{
+   AllocationScope scope;
+   return this->complete (ArgumentVector (argc, argv), skipProgramName, stream);
+}
 
-      if (extra.length() > 0) {
-         os << formatLongLine (gap, "", extra, this->m_cpl);
-      }
 
-      if (this->m_extraNewLine) os << nl;
-   }
+//==============================================================================
+// Async-signal-safe processing
+//==============================================================================
+//
+Parsley::SafeResult::SafeResult (OptionView* valuesIn, const size_t valueCapacityIn,
+                                 const char** parametersIn, const size_t parameterCapacityIn) :
+   values (valuesIn),
+   valueCapacity (valueCapacityIn),
+   parameters (parametersIn),
+   parameterCapacity (parameterCapacityIn),
+   parameterCount (0),
+   error (kNoError),
+   errorArgument (-1),
+   errorSlot (-1) { }
 
-   static const std::string nullDecrption =
-         "The null option indicating no more options. "
-         "This is useful if/when the initial parameters \"look like\" options. ";
+//------------------------------------------------------------------------------
+//
+Parsley::SafeResult::~SafeResult () { }
 
-   if (this->m_includeNoMore) {
-       os << formatLongLine (gap, "--", nullDecrption, this->m_cpl);
+//------------------------------------------------------------------------------
+// As getenv, but searches the given environment, which may be nullptr.
+//
+static const char* safeGetenv (const char* const* envp, const char* name,
+                               const size_t length) noexcept
+{
+   if (!envp) return nullptr;
+   for (; *envp; envp++) {
+      const char* item = *envp;
+      if ((strncmp (item, name, length) == 0) && (item[length] == '=')) {
+         return item + length + 1;
+      }
    }
+   return nullptr;
+}
 
-   return os;
+//------------------------------------------------------------------------------
+// Records the error in the result - always returns false.
+//
+static bool safeError (Parsley::SafeResult& result, const Parsley::ErrorCode code,
+                       const int argument, const int slot) noexcept
+{
+   result.error = code;
+   result.errorArgument = argument;
+   result.errorSlot = slot;
+   return false;
 }
 
 //------------------------------------------------------------------------------
+// Note: this mirrors process, but uses only the precompiled name index and
+// specifications, the caller's storage and the stack.
 //
-bool Parsley::process (const Arguments& arguments,
-                       const bool skipProgramName)
+bool Parsley::processSafe (const int argc, const char* const* argv,
+                           const char* const* envp, const bool skipProgramName,
+                           SafeResult& result) const noexcept
 {
-   this->m_errorMessage = "";
-   this->m_optionValues.clear();
-   this->m_parameters.clear();
+   result.parameterCount = 0;
+   safeError (result, kNoError, -1, -1);
 
    if (!this->m_specListOkay) {
-      this->m_errorMessage = "option specification errors";
-      return false;
+      return safeError (result, this->m_specListError, -1, -1);
    }
 
-   // First create a map of options with default values.
-   //
-   for (auto iter = this->m_specList.cbegin();
-        iter != this->m_specList.cend(); ++iter) {
-
-      const OptionSpecPointer spec = *iter;
+   const size_t number = this->m_specs.size();
+   if (!result.values || (result.valueCapacity < number)) {
+      return safeError (result, kInsufficientStorage, -1, -1);
+   }
 
-      ProxyValue value;
+   // First set each slot to its default value.
+   //
+   for (size_t slot = 0; slot < number; slot++) {
+      const OptionSpec* spec = this->m_specs[slot].get();
+      OptionView& value = result.values[slot];
 
-      value.m_alreadySpecified = false;
       value.isDefined = spec->m_defaultIsDefined;
-      value.m_spec = spec;
+      value.flag = (spec->m_kind == OptionSpec::Kind::kFlag) && (spec->m_defaultValue.i != 0);
+      value.str = "";
+      value.length = 0;
+      value.ival = 0;
+      value.real = 0.0;
 
-      std::string source = spec->m_defaultIsDefined ? "default" : "";
-
-      bool envVarValueAvalable = false;
-      std::string evValue = "";
+      const char* envValue = nullptr;
       if (spec->m_evIsDefined) {
-         const char* envp = std::getenv (spec->m_evName.c_str());
-         if (envp) {
-            evValue = std::string (envp);
-            envVarValueAvalable = true;
-         }
+         envValue = safeGetenv (envp, spec->text (OptionSpec::kEvName),
+                                  spec->textLength (OptionSpec::kEvName));
+      } else if (this->m_envIndex) {
+         envValue = this->mappedEnv (envp, int (slot));
       }
 
-      // Note: we often just copy undefined default values as is
-      // as opposed to doing a check - what would be the point?
-      //
       switch (spec->m_kind) {
          case OptionSpec::Kind::kFlag:
-            value.flag = false;
-            if (envVarValueAvalable) {
-               if ((evValue == "1") || (evValue == "Y") || (evValue == "YES")) {
+            if (envValue) {
+               if ((strcmp (envValue, "1") == 0) || (strcmp (envValue, "Y") == 0) ||
+                   (strcmp (envValue, "YES") == 0)) {
                   value.flag = true;
                }
             }
             break;
 
          case OptionSpec::Kind::kStr:
-            value.str = spec->m_defaultStr;
-            if (envVarValueAvalable) {
-               value.str = evValue;
-               value.isDefined = true;
-            }
-            break;
-
          case OptionSpec::Kind::kEnum:
-            value.str = spec->m_defaultStr;
-            if (envVarValueAvalable) {
-               source = "environment variable " + spec->m_evName;
-               value.str = evValue;
+         case OptionSpec::Kind::kCustom:
+            if (envValue) {
+               value.str = envValue;
+               value.length = strlen (envValue);
                value.isDefined = true;
+            } else {
+               value.str = spec->text (OptionSpec::kDefaultStr);
+               value.length = spec->textLength (OptionSpec::kDefaultStr);
             }
-            if (value.isDefined) {  // default or env var
-               value.ival = indexOf (spec->m_enumOptions, value.str);
+            if ((spec->m_kind == OptionSpec::Kind::kEnum) && value.isDefined) {
+               value.ival = spec->enumIndex (value.str, value.length);
                if (value.ival < 0) {
-                  this->m_errorMessage =
-                        "invalid " + source + " value for " +
-                        spec->name() + " : " + value.str +
-                        " is not one of " +  spec->enum_set();
-                  return false;
+                  return safeError (result, kInvalidEnumValue, -1, int (slot));
+               }
+            }
+            if ((spec->m_kind == OptionSpec::Kind::kCustom) && envValue) {
+               CustomValue custom;
+               if (!spec->m_customType->parse (value.str, value.length, &custom)) {
+                  return safeError (result, kInvalidValue, -1, int (slot));
                }
             }
+            if (spec->m_pattern && envValue &&
+                !spec->m_pattern->matches (value.str, value.length)) {
+               return safeError (result, kPatternMismatch, -1, int (slot));
+            }
             break;
 
          case OptionSpec::Kind::kInt:
-            value.ival = spec->m_defaultInt;
-            if (envVarValueAvalable) {
-               source = "environment variable " + spec->m_evName;
-               bool status = str2int (evValue, value.ival);
-               if (!status) {
-                  this->m_errorMessage =
-                        "invalid " + source + " value for " +
-                        spec->name() + " : '" + evValue +
-                        "' is not a valid integer.";
-                  return false;
+            value.ival = spec->m_defaultValue.i;
+            if (envValue) {
+               if (!parseInt (envValue, value.ival)) {
+                  return safeError (result, kInvalidInteger, -1, int (slot));
                }
                value.isDefined = true;
             }
             break;
 
          case OptionSpec::Kind::kReal:
-            value.real = spec->m_defaultReal;
-            if (envVarValueAvalable) {
-               source = "environment variable " + spec->m_evName;
-               bool status = str2real (evValue, value.real);
-               if (!status) {
-                  this->m_errorMessage =
-                        "invalid " + source + " value for " +
-                        spec->name() + " : '" + evValue +
-                        "' is not a valid floating point number.";
-                  return false;
+            value.real = spec->m_defaultValue.r;
+            if (envValue) {
+               if (!parseReal (envValue, value.real)) {
+                  return safeError (result, kInvalidReal, -1, int (slot));
                }
                value.isDefined = true;
             }
             break;
 
          default:
-            this->m_errorMessage = "*** program error";
-            return false;
+            return safeError (result, kProgramError, -1, int (slot));
       }
-
-
-      ProxyValue* ref = new ProxyValue(value);  // Why does this work
-      ProxyValuePointer ptr = ProxyValuePointer (ref);
-      this->m_optionValues.set (spec->m_longName, ptr);
    }
 
-   // Next process all arguments.
+   // Duplicate detection - a bit per slot, on the stack. Specifications with
+   // more options than this are rejected rather than using the heap.
    //
-   int index = -1;
+   static const size_t maxSlots = 4096;
+   if (number > maxSlots) {
+      return safeError (result, kInsufficientStorage, -1, -1);
+   }
+   uint32_t specified [maxSlots / 32];
+   memset (specified, 0, ((number + 31) / 32) * sizeof (uint32_t));
+
    bool optionsComplete = false;
+   for (int index = skipProgramName ? 1 : 0; index < argc; index++) {
+      const char* arg = argv[index];
 
-   // We have to use the iter format here (as opposed to for (item : container) {} )
-   //
-   for (auto iter = arguments.cbegin(); iter != arguments.cend(); ++iter) {
+      if (!optionsComplete) {
+         const size_t length = strlen (arg);
 
-      index++;
-      if ((index == 0) && skipProgramName) continue;
+         if (strcmp (arg, "--") == 0) {
+            optionsComplete = true;
+            continue;
+         }
 
-      const std::string arg = *iter;
+         if ((length > 0) && (arg[0] == '-')) {
+            int slot = -1;
+            NameIndex::NameKind nameKind = NameIndex::kName;
+            if (length == 2) {
+               slot = this->m_index->findShort (arg[1]);
+            } else if ((length >= 3) && (arg[1] == '-')) {
+               slot = this->m_index->findLong (arg + 2, length - 2, nameKind);
+            } else {
+               return safeError (result, kInvalidOptionFormat, index, -1);
+            }
 
-      if (optionsComplete) {
-         // Just add the the parameter list
-         this->m_parameters.push_back (arg);
-         continue;
-      }
+            if (slot < 0) {
+               return safeError (result, kNoSuchOption, index, -1);
+            }
 
-      if (arg == "--") {
-         // "--" is the specual null option for no more options.
-         // Useful for when a paramaeter starts with -
-         //
-         optionsComplete = true;
-         continue;
-      }
+            const uint32_t bit = uint32_t (1) << (slot % 32);
+            if (specified[slot / 32] & bit) {
+               return safeError (result, kDuplicateOption, index, slot);
+            }
+            specified[slot / 32] |= bit;
 
-      if ((arg.length() == 0) || (arg[0] != '-')) {
-         // Not an option - so must is first paramter.
-         //
-         this->m_parameters.push_back (arg);
-         optionsComplete = true;
-         continue;
-      }
+            const OptionSpec* spec = this->m_specs[slot].get();
+            OptionView& value = result.values[slot];
 
-      // Start processing the options.
-      //
-      OptionSpecPointer spec = nullptr;
-      if (arg.length() == 2) {
-         // Must be short form, e.g. -h, -x.
-         //
-         for (OptionSpecPointer checkSpec : this->m_specList) {
-            if (checkSpec->m_shortName == arg[1]) {
-               spec = checkSpec;  // found it
-               break;
+            if (spec->m_kind == OptionSpec::Kind::kFlag) {
+               value.flag = (nameKind != NameIndex::kNegation);
+               value.isDefined = true;
+               if (spec->m_isSingleton) return true;
+               continue;
             }
-         }
-      }
-
-      else if ((arg.length() >= 3) && (arg.substr(0,2) == "--")) {
-         // Must be long form, e.g. --help
-         //
-         std::string longName = arg.substr(2);
 
-         for (OptionSpecPointer checkSpec : this->m_specList) {
-            if (checkSpec->m_longName == longName) {
-               spec = checkSpec;   // found it
-               break;
+            if (index + 1 >= argc) {
+               return safeError (result, kMissingArgument, index, slot);
             }
+            const char* argValue = argv[++index];
+
+            switch (spec->m_kind) {
+               case OptionSpec::Kind::kStr:
+                  if (spec->m_pattern && !spec->m_pattern->matches (argValue, strlen (argValue))) {
+                     return safeError (result, kPatternMismatch, index, slot);
+                  }
+                  break;
+
+               case OptionSpec::Kind::kEnum:
+                  value.ival = spec->enumIndex (argValue, strlen (argValue));
+                  if (value.ival < 0) {
+                     return safeError (result, kInvalidEnumValue, index, slot);
+                  }
+                  break;
+
+               case OptionSpec::Kind::kCustom:
+                  {
+                     CustomValue custom;
+                     if (!spec->m_customType->parse (argValue, strlen (argValue), &custom)) {
+                        return safeError (result, kInvalidValue, index, slot);
+                     }
+                  }
+                  break;
+
+               case OptionSpec::Kind::kInt:
+                  if (!parseInt (argValue, value.ival)) {
+                     return safeError (result, kInvalidInteger, index, slot);
+                  }
+                  if (spec->m_rangeIsDefined &&
+                      ((value.ival < spec->m_minValue.i) || (value.ival > spec->m_maxValue.i))) {
+                     return safeError (result, kOutOfRange, index, slot);
+                  }
+                  break;
+
+               case OptionSpec::Kind::kReal:
+                  if (!parseReal (argValue, value.real)) {
+                     return safeError (result, kInvalidReal, index, slot);
+                  }
+                  if (spec->m_rangeIsDefined &&
+                      ((value.real < spec->m_minValue.r) || (value.real > spec->m_maxValue.r))) {
+                     return safeError (result, kOutOfRange, index, slot);
+                  }
+                  break;
+
+               default:
+                  return safeError (result, kProgramError, index, slot);
+            }
+
+            value.str = argValue;
+            value.length = strlen (argValue);
+            value.isDefined = true;
+
+            if (spec->m_isSingleton) return true;
+            continue;
          }
 
-      } else {
-         // Is something like: -xxx
+         // Not an option - so must be the first parameter.
          //
-         this->m_errorMessage = "invalid option format: " + arg;
-         return false;
+         optionsComplete = true;
       }
 
-      if (!spec) {
-         this->m_errorMessage = "no such option: " + arg;
-         return false;
+      if (result.parameterCount >= result.parameterCapacity) {
+         return safeError (result, kInsufficientStorage, index, -1);
       }
+      result.parameters[result.parameterCount++] = arg;
+   }
 
-      ProxyValuePointer value = this->m_optionValues.theMap[spec->m_longName];
-
-      if (value->m_alreadySpecified) {
-         this->m_errorMessage = "duplicate option: " + spec->name();
-         return false;
+   // Only the required options without a default need be visited, in spec order.
+   //
+   for (size_t w = 0; w < this->m_required.size(); w++) {
+      for (uint64_t bits = this->m_required[w]; bits != 0; bits &= bits - 1) {
+         const int slot = int (w * 64) + lowestBit (bits);
+         if (!result.values[slot].isDefined) {
+            return safeError (result, kValueRequired, -1, slot);
+         }
       }
-      value->m_alreadySpecified = true;
-
-      std::string argValue;
+   }
 
-      // Macro function to check for an option argument.
-      //
-#define CHECK_ARGUMENT {                                   \
-   ++iter;                                                 \
-   if (iter == arguments.cend()) {                         \
-      this->m_errorMessage = "option " + spec->name() +    \
-                             " requires an argument.";     \
-      return false;                                        \
-   }                                                       \
-   argValue = *iter;                                       \
+   return true;
 }
 
-      bool status;
-      switch (spec->m_kind) {
-         case OptionSpec::Kind::kFlag:
-            value->flag = true;
-            value->isDefined = true;
-            break;
-
-         case OptionSpec::Kind::kStr:
-            CHECK_ARGUMENT;
-            value->str = argValue;
-            value->isDefined = true;
-            break;
-
-         case OptionSpec::Kind::kEnum:
-            CHECK_ARGUMENT;
-            value->ival = indexOf (spec->m_enumOptions, argValue);
-            if (value->ival < 0) {
-               this->m_errorMessage =
-                     "invalid value for " + spec->name() + " : " + argValue +
-                     " is not one of " +  spec->enum_set();
-               return false;
-            }
-            value->str = argValue;
-            value->isDefined = true;
-            break;
-
-         case OptionSpec::Kind::kInt:
-            CHECK_ARGUMENT;
-            status = str2int (argValue, value->ival);
-            if (!status) {
-               this->m_errorMessage =
-                     "invalid value for " + spec->name() + " : '" + argValue +
-                     "' is not a valid integer.";
-               return false;
-            }
-
-            if (spec->m_rangeIsDefined) {
-               if ((value->ival < spec->m_minIntValue) ||
-                   (value->ival > spec->m_maxIntValue)) {
-                  this->m_errorMessage =
-                        "invalid value for " + spec->name() + " : " +
-                        int2str (value->ival) +
-                        " is out of range " + spec->range() + ".";
-                  return false;
-               }
-            }
-            value->isDefined = true;
-            break;
-
-         case OptionSpec::Kind::kReal:
-            CHECK_ARGUMENT;
-            status = str2real (argValue, value->real);
-            if (!status) {
-               this->m_errorMessage =
-                     "invalid value for " + spec->name() + " : '" + argValue +
-                     "' is not a valid floating point number.";
-               return false;
-            }
-
-            if (spec->m_rangeIsDefined) {
-               if ((value->real < spec->m_minRealValue) ||
-                   (value->real > spec->m_maxRealValue)) {
-                  this->m_errorMessage =
-                        "invalid value for " + spec->name() + " : " +
-                        real2str (value->real) +
-                        " is out of range " + spec->range() + ".";
-                  return false;
-               }
-            }
+//------------------------------------------------------------------------------
+//
+size_t Parsley::optionCount () const noexcept
+{
+   return this->m_specs.size();
+}
 
-            value->isDefined = true;
-            break;
+//------------------------------------------------------------------------------
+//
+int Parsley::slotOf (const char* longName) const noexcept
+{
+   if (!this->m_index) return -1;
+   return this->m_index->findLong (longName, strlen (longName));
+}
 
-         default:
-            this->m_errorMessage = "*** program error";
-            return false;
-            break;
-      }
+//------------------------------------------------------------------------------
+//
+Parsley::OptionValues Parsley::options () const
+{
+   AllocationScope scope;
 
-#undef CHECK_ARGUMENT
+   OptionValues result;
+   this->options (result);
+   return result;
+}
 
-      // A singleton option has been specified - this overrides all else.
-      //
-      if (spec->m_isSingleton) return true;
-   }
+//------------------------------------------------------------------------------
+// The slots and text buffer are copied as is, into the target's own storage.
+//
+void Parsley::options (OptionValues& into) const
+{
+   AllocationScope scope;
 
-   // Now check all the options to verify all values are required have been defined.
-   // This is really for those that have no default.
-   //
-   for (auto const& node : this->m_optionValues.theMap)
-   {
-      // const std::string name = node.first;
-      const ProxyValuePointer value = node.second;
+   into.m_index = this->m_index;
+   into.m_slots.assign (this->m_slots.begin(), this->m_slots.end());
+   into.m_text.assign (this->m_text.data(), this->m_text.data() + this->m_text.size());
+}
 
-      if (value->m_spec->m_isRequired && !value->isDefined) {
-         this->m_errorMessage = "a value is required for: " + value->m_spec->name();
-         return false;
-      }
-   }
+//------------------------------------------------------------------------------
+//
+Parsley::Arguments Parsley::parameters () const
+{
+   AllocationScope scope;
 
-   return true;
+   Arguments result;
+   this->parameters (result);
+   return result;
 }
 
 //------------------------------------------------------------------------------
 //
-std::string Parsley::errorMessage() const
+void Parsley::parameters (Arguments& into) const
 {
-   return this->m_errorMessage;
+   AllocationScope scope;
+
+   const size_t number = this->m_parameters.size();
+   into.resize (number);
+   for (size_t j = 0; j < number; j++) {
+      const TextRef& ref = this->m_parameters[j];
+      into[j].assign (this->textOf (ref), ref.length);
+   }
 }
 
 //------------------------------------------------------------------------------
 //
-Parsley::OptionValues Parsley::options () const
+size_t Parsley::parameterCount () const noexcept
 {
-   return this->m_optionValues;
+   return this->m_parameters.size();
 }
 
 //------------------------------------------------------------------------------
 //
-Parsley::Arguments Parsley::parameters () const
+const char* Parsley::parameter (const size_t j) const noexcept
 {
-   return this->m_parameters;
+   if (j >= this->m_parameters.size()) return nullptr;
+   return this->textOf (this->m_parameters[j]);
 }
 
 // end
@@ -13,21 +13,48 @@
 #ifndef PARSLEY_H
 #define PARSLEY_H
 
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
 #include <iostream>
 #include <list>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
 #include <vector>
 
+// The std::pmr adapter (Parsley::PmrResource) is available to C++17 clients.
+//
+#if (__cplusplus >= 201703L) && defined(__has_include)
+#   if __has_include(<memory_resource>)
+#      include <memory_resource>
+#      define PARSLEY_HAS_PMR 1
+#   endif
+#endif
+
+// Parsley may be built with exceptions disabled, e.g. -fno-exceptions.
+//
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#   define PARSLEY_EXCEPTIONS 1
+#endif
+
+// The library is built with hidden visibility (-fvisibility=hidden), so only
+// the Parsley class is exported; PARSLEY_LOCAL marks its internal parts that
+// need not be. Define PARSLEY_STATIC when using libparsley.a or the single
+// header build (parsley_single.h) on Windows.
+//
 #if defined(_WIN32)
-#   if defined(BUILDING_PARSLEY_LIBRARY)
+#   if defined(PARSLEY_STATIC)
+#      define PARSLEY_SHARED
+#   elif defined(BUILDING_PARSLEY_LIBRARY)
 #      define PARSLEY_SHARED __declspec(dllexport)
 #   else
 #      define PARSLEY_SHARED __declspec(dllimport)
 #   endif
+#   define PARSLEY_LOCAL
 #elif __GNUC__ >= 4
 #   define PARSLEY_SHARED    __attribute__ ((visibility("default")))
+#   define PARSLEY_LOCAL     __attribute__ ((visibility("hidden")))
 #else
 #warning "Unknown compiler environment - proceeding cautiously"
 #endif
@@ -60,6 +87,178 @@ public:
    ///
    typedef int intp_t;   // parsely integer type
 
+   //---------------------------------------------------------------------------
+   /// MemoryResource - the source of memory for the allocator aware variants of
+   /// the option specification builder (SpecBuilder), the parser and the option
+   /// values. The interface mirrors that of std::pmr::memory_resource, which is
+   /// only available from C++17 - see PmrResource.
+   ///
+   /// Implementations' doAllocate must return nullptr when unable to allocate,
+   /// rather than throw, so that process may report allocation failure as an
+   /// error (kOutOfMemory) even when exceptions are disabled.
+   ///
+   class MemoryResource {
+   public:
+      virtual ~MemoryResource ();
+
+      /// \brief allocate - allocates memory. Throws std::bad_alloc if unable,
+      /// or when built without exceptions, aborts.
+      /// \param bytes - the required size.
+      /// \param alignment - the required alignment.
+      /// \return pointer to the allocated memory.
+      ///
+      void* allocate (const size_t bytes,
+                      const size_t alignment = alignof (std::max_align_t));
+
+      /// \brief tryAllocate - as allocate, but returns nullptr if unable.
+      ///
+      void* tryAllocate (const size_t bytes,
+                         const size_t alignment = alignof (std::max_align_t)) noexcept;
+
+      /// \brief deallocate - returns memory obtained from allocate.
+      ///
+      void deallocate (void* p, const size_t bytes,
+                       const size_t alignment = alignof (std::max_align_t)) noexcept;
+
+   protected:
+      virtual void* doAllocate (const size_t bytes, const size_t alignment) noexcept = 0;
+      virtual void doDeallocate (void* p, const size_t bytes, const size_t alignment) noexcept = 0;
+   };
+
+   /// \brief defaultResource - the resource used when none specified, which
+   /// uses the global operator new and delete.
+   ///
+   static MemoryResource& defaultResource ();
+
+   /// \brief nullResource - a resource that never allocates any memory.
+   /// Useful as a MonotonicArena upstream to ensure the arena's buffer is
+   /// never exceeded.
+   ///
+   static MemoryResource& nullResource ();
+
+   /// MonotonicArena - a memory resource that hands out memory from a buffer,
+   /// and then from blocks obtained from the upstream resource, but only
+   /// reclaims memory when released (or destroyed). Not thread safe.
+   ///
+   class MonotonicArena : public MemoryResource {
+   public:
+      /// \brief MonotonicArena - uses the caller's buffer first.
+      /// \param buffer - the initial buffer - may be nullptr.
+      /// \param size - the initial buffer size.
+      /// \param upstream - the source of any further memory.
+      ///
+      MonotonicArena (void* buffer, const size_t size,
+                      MemoryResource& upstream = defaultResource ());
+
+      /// \brief MonotonicArena - obtains all its memory from upstream.
+      /// \param blockSize - the initial block size.
+      /// \param upstream - the source of the memory.
+      ///
+      explicit MonotonicArena (const size_t blockSize = 4096,
+                               MemoryResource& upstream = defaultResource ());
+      ~MonotonicArena ();
+
+      /// \brief release - frees everything allocated from the arena at once,
+      /// and returns any upstream blocks.
+      ///
+      void release () noexcept;
+
+      /// \brief bytesAllocated - total bytes allocated since the last release.
+      ///
+      size_t bytesAllocated () const noexcept;
+
+   protected:
+      void* doAllocate (const size_t bytes, const size_t alignment) noexcept;
+      void doDeallocate (void* p, const size_t bytes, const size_t alignment) noexcept;
+
+   private:
+      MonotonicArena (const MonotonicArena&);              // not copyable
+      MonotonicArena& operator= (const MonotonicArena&);
+
+      struct Block;
+
+      MemoryResource* m_upstream;
+      char* m_buffer;          // the initial buffer
+      size_t m_bufferSize;
+      char* m_current;         // next free byte
+      size_t m_remaining;      // in the current buffer/block
+      Block* m_blocks;         // upstream blocks, most recent first
+      size_t m_nextBlockSize;
+      size_t m_allocated;
+   };
+
+#if defined(PARSLEY_HAS_PMR)
+   /// PmrResource - adapts a std::pmr::memory_resource for use by parsley.
+   /// Only available when compiled as C++17 or later.
+   ///
+   class PmrResource : public MemoryResource {
+   public:
+      explicit PmrResource (std::pmr::memory_resource* upstream =
+                                  std::pmr::get_default_resource ()) :
+         m_upstream (upstream) { }
+
+   protected:
+      void* doAllocate (const size_t bytes, const size_t alignment) noexcept override
+      {
+#if defined(PARSLEY_EXCEPTIONS)
+         try {
+            return this->m_upstream->allocate (bytes, alignment);
+         } catch (...) {
+            return nullptr;
+         }
+#else
+         return this->m_upstream->allocate (bytes, alignment);
+#endif
+      }
+
+      void doDeallocate (void* p, const size_t bytes, const size_t alignment) noexcept override
+      {
+         this->m_upstream->deallocate (p, bytes, alignment);
+      }
+
+   private:
+      std::pmr::memory_resource* m_upstream;
+   };
+#endif
+
+   /// Allocator - a std allocator that obtains memory from a MemoryResource,
+   /// cf. std::pmr::polymorphic_allocator. As with the latter, containers
+   /// copied from containers using this allocator use the default resource.
+   ///
+   template <typename T>
+   class Allocator {
+   public:
+      typedef T value_type;
+
+      Allocator () : m_resource (&Parsley::defaultResource ()) { }
+      Allocator (MemoryResource* resource) : m_resource (resource) { }
+      template <typename U>
+      Allocator (const Allocator<U>& other) : m_resource (other.resource ()) { }
+
+      T* allocate (const size_t n)
+      {
+         return static_cast<T*> (this->m_resource->allocate (n * sizeof (T), alignof (T)));
+      }
+
+      void deallocate (T* p, const size_t n)
+      {
+         this->m_resource->deallocate (p, n * sizeof (T), alignof (T));
+      }
+
+      Allocator select_on_container_copy_construction () const { return Allocator (); }
+
+      MemoryResource* resource () const { return this->m_resource; }
+
+      template <typename U>
+      bool operator== (const Allocator<U>& other) const { return this->m_resource == other.resource (); }
+
+      template <typename U>
+      bool operator!= (const Allocator<U>& other) const { return this->m_resource != other.resource (); }
+
+   private:
+      MemoryResource* m_resource;
+   };
+
    //---------------------------------------------------------------------------
    // OptionSpec characterises/specifies an option.
    //
@@ -73,6 +272,12 @@ public:
    //
    typedef std::list <OptionSpecPointer> OptionSpecifications;
 
+   /// Pattern - this is a private/internal class. A string option's pattern
+   /// (see OptionSpec::pattern) compiled to a table driven DFA.
+   ///
+   class PARSLEY_LOCAL Pattern;
+   typedef std::shared_ptr<const Pattern> PatternPointer;
+
    /// OptionSpec construction methods that return a OptionSpecPointer.
    /// OptionSpecPointer is a shared pointer, so no need to manually free these.
    ///
@@ -84,6 +289,17 @@ public:
    //
    static OptionSpecPointer version ();  // version option - singleton
 
+   /// Provides: --completion SHELL (bash, zsh or fish)   with description:
+   /// "Write a shell completion script and exit." This option is not shown
+   /// by optionHelp. The value's index is the Shell, see completionScript.
+   //
+   static OptionSpecPointer completion ();  // completion option - singleton
+
+   /// Provides: --profile NAMES   with description: "Apply the named profiles,
+   /// comma separated, in order." The profiles are defined by setProfiles.
+   //
+   static OptionSpecPointer profileOption ();
+
    /// This constructs a flag option specification.
    /// This is implicitly optional, default false.
    //
@@ -101,6 +317,29 @@ public:
             const std::string& description,
             const bool isRequired = false);
 
+   /// This constructs a path option specification: a string option whose
+   /// value is a file or directory name, which may be checked (see
+   /// OptionSpec::checkPath) and which the completion scripts complete as
+   /// a file name.
+   //
+   static OptionSpecPointer
+   pathSpec (const std::string& longName,
+             const char shortName,
+             const std::string& description,
+             const bool isRequired = false);
+
+   /// PathCheck - the checks made of a path option's value (see
+   /// OptionSpec::checkPath) or of the parameters (see setParameterChecks).
+   /// These may be or'ed together.
+   ///
+   enum PathCheck : unsigned {
+      kPathExists = 0x01,       ///< the path exists
+      kPathIsFile = 0x02,       ///< and is a regular file
+      kPathIsDirectory = 0x04,  ///< and is a directory
+      kPathReadable = 0x08,     ///< and is readable
+      kPathWritable = 0x10      ///< is writable, or may be created if it does not exist
+   };
+
    /// This constructs an enumeration option specification.
    //
    static OptionSpecPointer
@@ -126,6 +365,166 @@ public:
              const std::string& description,
              const bool isRequired = false);
 
+   //---------------------------------------------------------------------------
+   /// Converter - the traits of a user defined option type, see customSpec.
+   /// Specialise this for each type, e.g.:
+   ///
+   /// template <> struct Parsley::Converter<Endpoint> {
+   ///    static const char* name () { return "endpoint"; }   // help and errors
+   ///    static bool parse (const char* str, const size_t length, Endpoint& value);
+   ///    static std::string format (const Endpoint& value);
+   ///    static bool validate (const Endpoint& value);
+   /// };
+   ///
+   /// The type must be default constructible and trivially copyable, and no
+   /// larger than kCustomValueSize bytes, as the value is held within the
+   /// option's value slot (see OptionValues::custom).
+   ///
+   template <typename T> struct Converter;
+
+   /// The maximum size of a user defined option type.
+   ///
+   static const size_t kCustomValueSize = 16;
+
+   /// This constructs an option specification of a user defined type, T,
+   /// for which Converter<T> is defined. Defaults (defStr or defCustom),
+   /// envVar and optionHelp are as for the built-in kinds.
+   //
+   template <typename T>
+   static OptionSpecPointer
+   customSpec (const std::string& longName,
+               const char shortName,
+               const std::string& description,
+               const bool isRequired = false)
+   {
+      return SpecBuilder (defaultResource ()).customSpec<T>
+            (longName.c_str(), shortName, description.c_str(), isRequired);
+   }
+
+private:
+   // The conversion functions of a user defined type, instantiated from its
+   // Converter, so that the values are converted without any virtual call.
+   //
+   struct CustomType {
+      const char* (*name) ();
+      bool (*parse) (const char* str, const size_t length, void* value);   // and validate
+      std::string (*format) (const void* value);
+   };
+
+   template <typename T>
+   static bool parseCustom (const char* str, const size_t length, void* value)
+   {
+      T item;
+      if (!Converter<T>::parse (str, length, item)) return false;
+      if (!Converter<T>::validate (item)) return false;
+      *static_cast<T*> (value) = item;
+      return true;
+   }
+
+   template <typename T>
+   static std::string formatCustom (const void* value)
+   {
+      return Converter<T>::format (*static_cast<const T*> (value));
+   }
+
+   template <typename T>
+   static const CustomType* customType ()
+   {
+      static_assert (sizeof (T) <= kCustomValueSize, "custom option type is too large");
+      static_assert (alignof (T) <= alignof (double), "custom option type is over aligned");
+      static_assert (std::is_trivially_copyable<T>::value,
+                     "custom option type must be trivially copyable");
+
+      static const CustomType type = { &Converter<T>::name, &parseCustom<T>, &formatCustom<T> };
+      return &type;
+   }
+
+   // Identifies the configuration struct type whose members are bound, so
+   // that process may reject a struct of any other type - see bind.
+   //
+   template <typename Config>
+   static const void* configType ()
+   {
+      static const char type = 0;
+      return &type;
+   }
+
+   // The aligned storage of a user defined type's value.
+   //
+   union CustomValue {
+      double alignment;
+      unsigned char bytes [kCustomValueSize];
+   };
+
+public:
+
+   //---------------------------------------------------------------------------
+   /// SpecBuilder - as the flagSpec, strSpec etc. functions above, but the
+   /// option specifications (including those formed by defStr, envVar etc.)
+   /// are allocated from the given memory resource. The const char* parameters
+   /// avoid the need for any temporary strings.
+   ///
+   class SpecBuilder {
+   public:
+      explicit SpecBuilder (MemoryResource& resource);
+      ~SpecBuilder ();
+
+      OptionSpecPointer help () const;
+      OptionSpecPointer version () const;
+      OptionSpecPointer completion () const;
+      OptionSpecPointer profileOption () const;
+
+      OptionSpecPointer flagSpec (const char* longName,
+                                  const char shortName,
+                                  const char* description,
+                                  const bool isSingleton = false) const;
+
+      OptionSpecPointer strSpec (const char* longName,
+                                 const char shortName,
+                                 const char* description,
+                                 const bool isRequired = false) const;
+
+      OptionSpecPointer pathSpec (const char* longName,
+                                  const char shortName,
+                                  const char* description,
+                                  const bool isRequired = false) const;
+
+      OptionSpecPointer enumSpec (const char* longName,
+                                  const char shortName,
+                                  const char* description,
+                                  std::initializer_list<const char*> enumOptions,
+                                  const bool isRequired = false) const;
+
+      OptionSpecPointer intSpec (const char* longName,
+                                 const char shortName,
+                                 const char* description,
+                                 const bool isRequired = false) const;
+
+      OptionSpecPointer realSpec (const char* longName,
+                                  const char shortName,
+                                  const char* description,
+                                  const bool isRequired = false) const;
+
+      template <typename T>
+      OptionSpecPointer customSpec (const char* longName,
+                                    const char shortName,
+                                    const char* description,
+                                    const bool isRequired = false) const
+      {
+         return this->makeCustomSpec (customType<T> (), longName, shortName,
+                                      description, isRequired);
+      }
+
+   private:
+      OptionSpecPointer makeCustomSpec (const CustomType* type,
+                                        const char* longName,
+                                        const char shortName,
+                                        const char* description,
+                                        const bool isRequired) const;
+
+      MemoryResource* m_resource;
+   };
+
 
    //---------------------------------------------------------------------------
    /// Options are specified using the flagSpec, strSpec etc. defined above.
@@ -151,6 +550,7 @@ public:
       /// \return OptionSpecPointer
       ///
       OptionSpecPointer defStr (const std::string& defValue);
+      OptionSpecPointer defStr (const char* defValue);
 
       /// \brief defInt adds a default value to an integer option specification.
       /// \param defValue - intp_t - the default value.
@@ -164,6 +564,24 @@ public:
       ///
       OptionSpecPointer defReal (const double defValue);
 
+      /// \brief defFlag sets the default state of a flag option specification,
+      /// e.g. on for a flag that may be turned off by its negation (see negatable).
+      /// \param defValue - bool - the default state.
+      /// \return  OptionSpecPointer
+      ///
+      OptionSpecPointer defFlag (const bool defValue);
+
+      /// \brief defCustom adds a default value to a user defined type option
+      /// specification (see customSpec).
+      /// \param defValue - T - the default value.
+      /// \return  OptionSpecPointer
+      ///
+      template <typename T>
+      OptionSpecPointer defCustom (const T& defValue)
+      {
+         return this->withDefCustom (customType<T> (), Converter<T>::format (defValue));
+      }
+
       // Provided an allowed range - numeric options only.
       //
       /// \brief intRange adds a range constraint to an integer option specification.
@@ -180,6 +598,42 @@ public:
       ///
       OptionSpecPointer realRange (const double min, const double max);
 
+      /// \brief pattern adds a pattern constraint to a string option
+      /// specification: the whole value must match the regular expression.
+      /// The expression is compiled, once, to a DFA when the specification is
+      /// built, and each value is then matched in a single pass. The subset
+      /// supported is: literal characters, '.', classes such as [a-z_] and
+      /// [^:], the escapes \d \w \s (and \D \W \S), grouping with ( ),
+      /// alternation with |, and the quantifiers * + ? {n} {n,} {n,m}.
+      /// \param regex - e.g. "[a-z][a-z0-9_]*"
+      /// \return OptionSpecPointer
+      ///
+      OptionSpecPointer pattern (const std::string& regex);
+
+      /// \brief checkPath adds checks to a path option specification (see
+      /// pathSpec). The checks of all the path options and parameters are
+      /// made concurrently, on a few threads, once process has scanned the
+      /// arguments; see pathFailures.
+      /// \param checks - PathCheck values or'ed together.
+      /// \return OptionSpecPointer
+      ///
+      OptionSpecPointer checkPath (const unsigned checks);
+
+      /// \brief minFreeSpace adds a check to a path option specification that
+      /// the file system holding the path (or, if it does not exist, its
+      /// directory) has at least the given free space.
+      /// \param bytes - the space required.
+      /// \return OptionSpecPointer
+      ///
+      OptionSpecPointer minFreeSpace (const uint64_t bytes);
+
+      /// \brief glob marks a path option specification as taking a glob
+      /// pattern (see Glob), the matches of which are obtained by matches.
+      /// Any path checks are made of each match.
+      /// \return OptionSpecPointer
+      ///
+      OptionSpecPointer glob ();
+
       // Defines the name of an environment variable that can supply
       // the option value if not otherwise specified.
       //
@@ -190,26 +644,206 @@ public:
       /// \return OptionSpecPointer
       //
       OptionSpecPointer envVar (const std::string& envVarName);
+      OptionSpecPointer envVar (const char* envVarName);
+
+      ///
+      /// \brief fileValue - marks the option's value as a file name, so that
+      /// the completion scripts (see completionScript) complete file names
+      /// rather than leave the value to the user.
+      /// \return OptionSpecPointer
+      //
+      OptionSpecPointer fileValue ();
+
+      ///
+      /// \brief dynamicValues - the completion scripts query the program for
+      /// the option's values (see completionQuery) rather than embed them. For
+      /// enumerations whose values are only known at run time, e.g. loaded
+      /// from a file.
+      /// \return OptionSpecPointer
+      //
+      OptionSpecPointer dynamicValues ();
+
+      ///
+      /// \brief alias - adds another long name for the option. All the names of
+      /// an option map to the same value, and are listed by optionHelp.
+      /// \param longName - the alias, e.g. "color" for "colour".
+      /// \return OptionSpecPointer
+      //
+      OptionSpecPointer alias (const std::string& longName);
+
+      ///
+      /// \brief deprecated - adds a former long name for the option, e.g. when
+      /// the option has been renamed. The name is still accepted, but each use
+      /// is reported by Parsley::warnings. It is not listed by optionHelp.
+      /// \param longName - the former name.
+      /// \return OptionSpecPointer
+      //
+      OptionSpecPointer deprecated (const std::string& longName);
+
+      ///
+      /// \brief negatable - flags only: adds the --no-<name> option, which turns
+      /// the flag off, typically used with defFlag (true).
+      /// \return OptionSpecPointer
+      //
+      OptionSpecPointer negatable ();
+
+      ///
+      /// \brief bind - binds the option to a variable, into which process
+      /// writes the option's value directly, including any default or
+      /// environment variable value. Flags bind to bool, integers to intp_t,
+      /// reals to double, strings to std::string and enumerations to either
+      /// std::string (the value) or intp_t (the index). A variable whose option
+      /// has no default keeps its value unless the option is given. The value
+      /// of a bound option is not then available from options.
+      /// \param target - the variable, which must outlive the parser.
+      /// \return OptionSpecPointer
+      ///
+      OptionSpecPointer bind (bool* target);
+      OptionSpecPointer bind (intp_t* target);
+      OptionSpecPointer bind (double* target);
+      OptionSpecPointer bind (std::string* target);
+
+      ///
+      /// \brief bind - binds the option to a member of a configuration struct,
+      /// as above. The members are written by process (arguments,
+      /// skipProgramName, config); other calls of process ignore the binding.
+      /// The configuration struct must be a standard layout type, and all the
+      /// options of a parser must be bound to members of the same struct type.
+      /// \param member - e.g. &Config::verbose
+      /// \return OptionSpecPointer
+      ///
+      template <typename Config, typename T>
+      OptionSpecPointer bind (T Config::* member)
+      {
+         static_assert (std::is_standard_layout<Config>::value,
+                        "configuration struct must be a standard layout type");
+
+         BindTarget target;
+         target.offset = memberOffset (member);
+         return this->withBinding (bindingOf (static_cast<T*> (nullptr)), target,
+                                   configType<Config> ());
+      }
 
    private:
-      enum Kind {
+      // The type of a bound variable - see bind.
+      //
+      enum Binding : uint8_t {
+         kNotBound = 0,
+         kBindBool,
+         kBindInt,
+         kBindReal,
+         kBindStr
+      };
+
+      // The bound variable's address, or the member's offset.
+      //
+      union BindTarget {
+         void* pointer;
+         size_t offset;
+      };
+
+      static Binding bindingOf (const bool*)        { return kBindBool; }
+      static Binding bindingOf (const intp_t*)      { return kBindInt; }
+      static Binding bindingOf (const double*)      { return kBindReal; }
+      static Binding bindingOf (const std::string*) { return kBindStr; }
+
+      // As offsetof, which may not be given a member pointer: the member's
+      // address is formed relative to a nominal, suitably aligned, address.
+      // No object is accessed. Only used for standard layout types.
+      //
+      template <typename Config, typename T>
+      static size_t memberOffset (T Config::* member)
+      {
+         const Config* object = reinterpret_cast<const Config*> (uintptr_t (alignof (Config)));
+         return size_t (reinterpret_cast<const char*> (&(object->*member)) -
+                        reinterpret_cast<const char*> (object));
+      }
+
+      enum Kind : uint8_t {
          kFlag = 0,
          kStr,
          kEnum,
          kInt,
-         kReal   // double
+         kReal,   // double
+         kCustom  // user defined, see Converter
+      };
+
+      // The text items held in the text pool, in this order. Any enumeration
+      // options follow the default string.
+      //
+      enum TextItem {
+         kLongName = 0,
+         kDescription,
+         kEvName,
+         kDefaultStr,
+         kAliases,          // space separated
+         kDeprecated,       // space separated
+         kPattern,          // the source of m_pattern
+         kFirstEnumOption
+      };
+
+      // Numeric range limit or default value - the member used depends on
+      // the kind: integer or real. Not used by the other kinds.
+      //
+      union Numeric {
+         intp_t i;
+         double r;
       };
 
       static std::string kindImage (const Kind kind);
 
-      OptionSpec (const Kind kind,
-                  const std::string& longName,
+      OptionSpec (MemoryResource& resource,
+                  const Kind kind,
+                  const char* longName,
                   const char shortName,
-                  const std::string& description,
+                  const char* description,
                   const bool isRequired);
 
       OptionSpec (const OptionSpec& other);
 
+      // Text pool access. Each item is null terminated.
+      //
+      const char* text (const int item) const;
+      size_t textLength (const int item) const;
+      std::string textStr (const int item) const;
+      size_t textPoolSize () const;
+      void setTextPool (char* pool, const uint32_t count);
+      void replaceText (const int item, const char* value, const size_t length);
+
+      template <typename Iterator>
+      void addEnumOptions (Iterator first, Iterator last);
+
+      OptionSpecPointer withDefStr (const char* defValue, const size_t length);
+      OptionSpecPointer withEnvVar (const char* envVarName, const size_t length);
+      OptionSpecPointer withBinding (const Binding binding, const BindTarget target,
+                                     const void* config);
+      OptionSpecPointer withDefCustom (const CustomType* type, const std::string& defValue);
+      OptionSpecPointer withName (const int item, const std::string& longName);
+
+      // Calls function (name, length) for each name held in the space
+      // separated kAliases or kDeprecated item.
+      //
+      template <typename Function>
+      void forEachName (const int item, Function function) const
+      {
+         const char* names = this->text (item);
+         const size_t length = this->textLength (item);
+         size_t start = 0;
+         for (size_t j = 0; j <= length; j++) {
+            if ((j == length) || (names[j] == ' ')) {
+               if (j > start) function (names + start, j - start);
+               start = j + 1;
+            }
+         }
+      }
+
+      // The bound variable, given the configuration struct (if any).
+      //
+      void* bindingTarget (void* config) const;
+
+      int enumCount () const;
+      int enumIndex (const char* value, const size_t length) const;
+
       std::string name () const;      // Used for the error messages.
       std::string range () const;
       std::string enum_set () const;
@@ -218,31 +852,44 @@ public:
       std::string info () const;
       std::string helpConstraint () const;
       std::string helpDefault () const;
-      std::string helpEnvVar () const;
+      std::string helpEnvVar (const std::string& name) const;
+      std::string helpAliases () const;
 
-      const Kind m_kind;
-      const std::string m_longName;
-      const char m_shortName;
-      const std::string m_description;
-      const bool m_isRequired;
-
-      bool m_isSingleton;
-      Parsley::EnumOptions m_enumOptions;
+      size_t footprint () const;   // including the object itself
 
-      bool m_rangeIsDefined;
-      intp_t m_minIntValue;
-      intp_t m_maxIntValue;
-      double m_minRealValue;
-      double m_maxRealValue;
-
-      // Environment variable
-      bool m_evIsDefined;
-      std::string m_evName;
+      // All the text items (long name, description, environment variable
+      // name, default string and enumeration options) are held in a single
+      // allocation: the item offsets, followed by the items themselves.
+      //
+      MemoryResource* m_resource;
+      char* m_textPool;
+      uint32_t m_textCount;
+
+      Numeric m_minValue;
+      Numeric m_maxValue;
+      Numeric m_defaultValue;
+      BindTarget m_bindTarget;
+      const void* m_bindConfig;         // members only, the struct's configType
+      const CustomType* m_customType;   // kCustom only
+      PatternPointer m_pattern;         // kStr only, shared by the clones
+      uint64_t m_minFreeSpace;          // paths only, see minFreeSpace
 
-      bool m_defaultIsDefined;
-      std::string m_defaultStr;   // string or enum
-      intp_t m_defaultInt;
-      double m_defaultReal;
+      const Kind m_kind;
+      const char m_shortName;
+      Binding m_binding;
+
+      bool m_isRequired : 1;
+      bool m_isSingleton : 1;
+      bool m_rangeIsDefined : 1;
+      bool m_evIsDefined : 1;
+      bool m_defaultIsDefined : 1;
+      bool m_isFileValue : 1;
+      bool m_isDynamic : 1;      // values completed by completionQuery
+      bool m_isHidden : 1;       // not shown by optionHelp nor completed
+      bool m_isNegatable : 1;    // flags only, see negatable
+      bool m_isProfile : 1;      // selects profiles, see profileOption
+      bool m_isGlob : 1;         // paths only, see glob
+      uint8_t m_pathChecks;      // PathCheck values
 
       friend class Parsley;
    };
@@ -283,108 +930,872 @@ public:
    };
 
    //---------------------------------------------------------------------------
-   /// ProxyValue - this is a private/internal class.
-   /// As well as holding the OptionValue values, it also hold
-   /// private/internal house-keeping data.
+   /// NameIndex - this is a private/internal class.
+   /// It maps option long and short names to value slots, one slot per option
+   /// specification, and is built once by the Parsley constructor.
    ///
-   class ProxyValue;
+   class PARSLEY_LOCAL NameIndex;
 
-   /// \brief ProxyValuePointer provides a shared pointer value to A
-   /// ProxyValue instance.
+   /// \brief NameIndexPointer provides a shared pointer to a NameIndex instance.
+   /// It is shared by the Parsley object and any OptionValues it provides.
    ///
-   typedef std::shared_ptr<ProxyValue> ProxyValuePointer;
+   typedef std::shared_ptr<const NameIndex> NameIndexPointer;
 
    //---------------------------------------------------------------------------
-   /// A wrapper class around unordered_map of ProxyValues.
-   /// This allows operator[] to be const, and therfore allows options to be
-   /// declared const: e.g.:
+   /// OptionGroup - a collection of option specifications that is compiled,
+   /// i.e. checked and indexed, once, and which has its own optionHelp section.
+   /// A parser may then be formed by merging groups (see Parsley (groups)),
+   /// which merges the groups' indexes, using the names' hashes calculated by
+   /// each group, and so checks only for conflicts across the group boundaries.
+   /// This allows a library to contribute its options to any program that
+   /// links it, e.g.:
    ///
-   /// Parsley parser (...);
-   /// const Parsley::OptionValues options = parser.options();
-   /// const Parsley::OptionValue item = options["option_name"];
+   ///    const Parsley::OptionGroupPointer& loggingOptions ()
+   ///    {
+   ///       static const Parsley::OptionGroupPointer group =
+   ///          Parsley::optionGroup ("Logging options", { ... });
+   ///       return group;
+   ///    }
    ///
-   class OptionValues {
+   class OptionGroup {
    public:
-      explicit OptionValues();
-      ~OptionValues();
-
-      /// \brief operator [] allows access to options["help"] and the like. Read-only.
-      /// \param option - the option name
-      /// \return OptionValue
+      /// \brief OptionGroup constructor.
+      /// \param title - the optionHelp section title, e.g. "Logging options".
+      /// \param specList - the collection of option specifications.
+      /// \param resource - the memory resource used for the group's storage.
       ///
-      OptionValue operator[] (const std::string& option) const;
+      OptionGroup (const std::string& title, const OptionSpecifications& specList,
+                   MemoryResource& resource = defaultResource ());
+      ~OptionGroup ();
+
+      const std::string& title () const;
+      size_t size () const;             // the number of options
+      bool isOkay () const;             // false if any option names conflict
 
    private:
-      void clear ();
-      void set (const std::string& option, const ProxyValuePointer& value);
+      OptionGroup (const OptionGroup&);              // not copyable
+      OptionGroup& operator= (const OptionGroup&);
 
-      typedef std::unordered_map <std::string, ProxyValuePointer> MapType;
-      MapType theMap;
+      std::string m_title;
+      std::vector<OptionSpecPointer, Allocator<OptionSpecPointer> > m_specs;
+      NameIndexPointer m_index;
+      bool m_isOkay;
+      bool m_outOfMemory;
 
       friend class Parsley;
    };
 
-
-   // Object instance methods.
+   /// \brief OptionGroupPointer is a std shared pointer type referencing an
+   /// OptionGroup, and OptionGroups a collection (std list) of them.
    //
-   /// \brief Parsley object constructor.
-   /// \param specList - the collection of option specifications.
-   ///
-   /// Parsley is primarily to intended to interpret and validate user command
-   /// line options. Note: there is some validation of the programmers
-   /// option specifications.
+   typedef std::shared_ptr<const OptionGroup> OptionGroupPointer;
+   typedef std::list<OptionGroupPointer> OptionGroups;
+
+   /// \brief optionGroup - constructs an option group, see OptionGroup.
    //
-   explicit Parsley (const OptionSpecifications& specList);
-   ~Parsley ();
+   static OptionGroupPointer optionGroup (const std::string& title,
+                                          const OptionSpecifications& specList);
 
-   // Qualify how the auto generated option help information is generated.
+   /// OptionNames is a collection (std vector) of option long names.
    //
-   /// \brief setOptionHelpCpl - sets number of charactres per line in
-   /// the auto generated help information.
-   /// The default is 92, the minimum is 40.
-   /// \param cpl
-   ///
-   void setOptionHelpCpl (const int cpl);
+   typedef std::vector <std::string> OptionNames;
 
-   /// \brief setOptionNewLineSeparator - set/clear extra newline between
-   /// options in the auto generated help information.
-   /// The default is unset.
-   /// \param extraNewLine
+   //---------------------------------------------------------------------------
+   /// Constraint - a relationship between options, checked once the arguments
+   /// have been scanned (see setConstraints), e.g.:
    ///
-   void setOptionNewLineSeparator (const bool extraNewLine);
-
-   /// \brief setOptionIncludeNoMore - controls if the '--' no more options option
-   /// is described in the auto generated help information.
-   /// The default is false.
-   /// \param includeNoMore
+   ///    parser.setConstraints ({
+   ///       Parsley::dependsOn ("output", { "format" }),
+   ///       Parsley::conflicting ({ "tcp", "unix" })
+   ///    });
    ///
-   void setOptionIncludeNoMore (const bool includeNoMore);
-
-   /// \brief optionHelp - provides auto generated option help information.
-   /// \param stream - the output stream which the option help is written to.
-   /// \return - the output stream.
+   /// An option is present when given by an argument or by its environment
+   /// variable. An option that another depends on may instead have a default
+   /// value (flags excepted).
    ///
-   std::ostream& optionHelp (std::ostream& stream);
+   class Constraint {
+   public:
+      enum Kind {
+         kDependsOn = 0,   ///< if the first option is present, so must the others be
+         kConflicting,     ///< at most one of the options may be present
+         kExactlyOneOf,    ///< exactly one of the options must be present
+         kAtLeastOneOf     ///< at least one of the options must be present
+      };
 
-   // Utility function for process (and any other purpose).
-   // It forms an Arguments vector from the standard argc/argv main parameters.
+      Constraint (const Kind kind, const OptionNames& options);
+      ~Constraint ();
+
+      Kind kind () const;
+      const OptionNames& options () const;
+
+      /// \brief image - the constraint in words, as used by optionHelp and
+      /// the error messages, e.g. "--output requires --format."
+      ///
+      std::string image () const;
+
+   private:
+      const Kind m_kind;
+      const OptionNames m_options;
+   };
+
+   /// ConstraintPointer is a std shared pointer type referencing a Constraint,
+   /// and Constraints a collection (std list) of them.
+   //
+   typedef std::shared_ptr<const Constraint> ConstraintPointer;
+   typedef std::list<ConstraintPointer> Constraints;
+
+   /// Constraint construction methods.
    //
+   static ConstraintPointer dependsOn (const std::string& option, const OptionNames& others);
+   static ConstraintPointer conflicting (const OptionNames& options);
+   static ConstraintPointer exactlyOneOf (const OptionNames& options);
+   static ConstraintPointer atLeastOneOf (const OptionNames& options);
+
+   //---------------------------------------------------------------------------
+   /// Profile - a named bundle of option settings, selected by the profile
+   /// option (see profileOption and setProfiles), e.g.:
    ///
-   /// \brief formArguments - utility function to convert main argc and argv
-   /// parameters into an Arguments collection.
-   /// \param argc - number of arguments.
-   /// \param argv - the char* style arguments
-   /// \return Arguments
+   ///    parser.setProfiles ({
+   ///       Parsley::profile ("low-latency", "Favour latency over throughput.",
+   ///                         { { "batch", "1" }, { "poll", "" }, { "nagle", "off" } })
+   ///    });
    ///
-   static Arguments formArguments (const int argc, const char* const* argv);
-
-   /// \brief process - processes the given arguments.
-   /// \param arguments - the list of arguments to be analysed against the
-   /// option specification list provided to the constructor.
-   /// \param skipProgramName - when true, process skips over and ignore the zeroth argument.
-   /// \return true if no error detected otherwise false.
+   ///    myprog --profile low-latency,debug --batch 4
    ///
-   bool process (const Arguments& arguments, const bool skipProgramName);
+   /// Each value is as would be given as an argument. A flag's value is empty
+   /// or "on" to set it, or "off" to turn it off.
+   ///
+   class Profile {
+   public:
+      typedef std::pair<std::string, std::string> Setting;   ///< option long name, value
+      typedef std::vector<Setting> Settings;
+
+      Profile (const std::string& name, const std::string& description,
+               const Settings& settings);
+      ~Profile ();
+
+      const std::string& name () const;
+      const std::string& description () const;
+      const Settings& settings () const;
+
+   private:
+      const std::string m_name;
+      const std::string m_description;
+      const Settings m_settings;
+   };
+
+   /// ProfilePointer is a std shared pointer type referencing a Profile,
+   /// and Profiles a collection (std list) of them.
+   //
+   typedef std::shared_ptr<const Profile> ProfilePointer;
+   typedef std::list<ProfilePointer> Profiles;
+
+   /// \brief profile - constructs a profile, see Profile.
+   //
+   static ProfilePointer profile (const std::string& name, const std::string& description,
+                                  const Profile::Settings& settings);
+
+   //---------------------------------------------------------------------------
+   /// OptionView - as OptionValue, but the string value refers to storage held
+   /// by the OptionValues object (or parser), rather than being a copy, so it
+   /// may be obtained without allocating memory. The view remains valid until
+   /// the OptionValues object is next updated or reset.
+   ///
+   class OptionView {
+   public:
+      explicit OptionView ();
+      ~OptionView ();
+
+      bool isDefined;    ///< either explicitly or by default
+      bool flag;         ///< flag value
+      const char* str;   ///< str or enum value - null terminated
+      size_t length;     ///< length of str
+      intp_t ival;       ///< int value or enum index
+      double real;       ///< real value
+      const void* custom;   ///< user defined type value, or nullptr - see customSpec
+   };
+
+private:
+   //---------------------------------------------------------------------------
+   // The internal representation of the option values: a slot per option,
+   // with any string values held in a separate text buffer, so that all
+   // storage may be obtained from a memory resource.
+   //
+   struct TextRef {
+      uint32_t offset;   // within the text buffer
+      uint32_t length;
+   };
+
+   struct Slot {
+      union {
+         double real;
+         CustomValue custom;   // kCustom only
+      };
+      intp_t ival;
+      TextRef str;
+      bool isDefined;
+      bool flag;
+      bool isCustom;
+   };
+
+   typedef std::vector<Slot, Allocator<Slot> > Slots;
+
+   // A profile's precomputed value for an option. Any text is held at the
+   // start of the text buffer, which process retains.
+   //
+   struct Preset {
+      int slot;
+      OptionSpec::Kind kind;
+      Slot value;
+   };
+   typedef std::vector<char, Allocator<char> > Text;
+
+   // A dense bit set indexed by option slot, 64 slots per word.
+   //
+   typedef std::vector<uint64_t, Allocator<uint64_t> > Bits;
+
+public:
+   //---------------------------------------------------------------------------
+   /// Footprint - an estimate of the memory used by a Parsley object or by an
+   /// OptionValues object, in bytes, broken down by component. Heap sizes are
+   /// the sizes requested, i.e. they exclude any allocator overhead.
+   ///
+   class Footprint {
+   public:
+      explicit Footprint ();
+      ~Footprint ();
+
+      size_t object;       ///< the object itself, i.e. sizeof
+      size_t specs;        ///< the option specifications, including their strings
+      size_t specTable;    ///< the table of specification pointers, one per slot
+      size_t index;        ///< the name index - note: shared with any OptionValues
+      size_t values;       ///< the value slots, including their strings
+      size_t parameters;   ///< the parameters, including their strings
+      size_t other;        ///< groups, constraints, profiles, warnings,
+                           ///< environment prefix values and path checks
+
+      /// \brief total - the sum of all components.
+      ///
+      size_t total () const;
+   };
+
+   //---------------------------------------------------------------------------
+   /// A wrapper class around the option value slots.
+   /// This allows operator[] to be const, and therfore allows options to be
+   /// declared const: e.g.:
+   ///
+   /// Parsley parser (...);
+   /// const Parsley::OptionValues options = parser.options();
+   /// const Parsley::OptionValue item = options["option_name"];
+   ///
+   /// An OptionValues object may be given a memory resource, from which its
+   /// storage is obtained. When given a MonotonicArena, reset also releases
+   /// the arena, i.e. frees everything at once. Note: a copy always uses the
+   /// default resource.
+   ///
+   class OptionValues {
+   public:
+      explicit OptionValues();
+      explicit OptionValues (MemoryResource& resource);
+      explicit OptionValues (MonotonicArena& arena);
+      OptionValues (const OptionValues& other);
+      OptionValues& operator= (const OptionValues& other);
+      ~OptionValues();
+
+      /// \brief operator [] allows access to options["help"] and the like. Read-only.
+      /// \param option - the option name
+      /// \return OptionValue
+      ///
+      OptionValue operator[] (const std::string& option) const;
+
+      /// \brief view - as operator [], but does not allocate memory.
+      /// \param option - the option name
+      /// \return OptionView
+      ///
+      OptionView view (const char* option) const noexcept;
+
+      /// \brief custom - the value of a user defined type option, see customSpec.
+      /// \param option - the option name
+      /// \return the value, or T () if not defined.
+      ///
+      template <typename T>
+      T custom (const char* option) const noexcept
+      {
+         const OptionView item = this->view (option);
+         T result = T ();
+         if (item.isDefined && item.custom) result = *static_cast<const T*> (item.custom);
+         return result;
+      }
+
+      /// \brief reset - frees all the storage held by this object, and when
+      /// this object was constructed with a MonotonicArena, releases the arena.
+      ///
+      void reset ();
+
+      /// \brief footprint - estimates the memory used by this object.
+      /// \return Footprint - object, index and values only.
+      ///
+      Footprint footprint () const;
+
+   private:
+      NameIndexPointer m_index;
+      Slots m_slots;
+      Text m_text;
+      MonotonicArena* m_arena;   // released by reset, if any
+
+      friend class Parsley;
+   };
+
+   // Object instance methods.
+   //
+   /// \brief Parsley object constructor.
+   /// \param specList - the collection of option specifications.
+   ///
+   /// Parsley is primarily to intended to interpret and validate user command
+   /// line options. Note: there is some validation of the programmers
+   /// option specifications.
+   //
+   explicit Parsley (const OptionSpecifications& specList);
+
+   /// \brief Parsley object constructor - as above, but all the object's own
+   /// storage (name index, value slots, parameters) is obtained from the given
+   /// memory resource, which must out live the object and any OptionValues it
+   /// provides. Once warmed up, process does not allocate memory for valid
+   /// input. Note: error messages use the global heap.
+   /// \param specList - the collection of option specifications.
+   /// \param resource - the memory resource.
+   ///
+   Parsley (const OptionSpecifications& specList, MemoryResource& resource);
+
+   /// \brief Parsley object constructor - the options are those of the given
+   /// groups, in order, and optionHelp provides a section per group.
+   /// \param groups - the collection of option groups.
+   /// \param resource - the memory resource, as above.
+   ///
+   explicit Parsley (const OptionGroups& groups,
+                     MemoryResource& resource = defaultResource ());
+   ~Parsley ();
+
+   // Qualify how the auto generated option help information is generated.
+   //
+   /// \brief setOptionHelpCpl - sets number of charactres per line in
+   /// the auto generated help information.
+   /// The default is 92, the minimum is 40.
+   /// \param cpl
+   ///
+   void setOptionHelpCpl (const int cpl);
+
+   /// \brief setOptionNewLineSeparator - set/clear extra newline between
+   /// options in the auto generated help information.
+   /// The default is unset.
+   /// \param extraNewLine
+   ///
+   void setOptionNewLineSeparator (const bool extraNewLine);
+
+   /// \brief setOptionIncludeNoMore - controls if the '--' no more options option
+   /// is described in the auto generated help information.
+   /// The default is false.
+   /// \param includeNoMore
+   ///
+   void setOptionIncludeNoMore (const bool includeNoMore);
+
+   /// \brief setConstraints - defines the constraints between the options,
+   /// replacing any previously set. These are compiled into bit masks over the
+   /// option slots, and are all evaluated, in a single pass, once process (or
+   /// visit) has scanned the arguments. Any violation is reported as the
+   /// kConstraintViolation error; see also violations. The constraints are
+   /// listed by optionHelp. An unknown option name is a specification error.
+   /// \param constraints - the collection of constraints.
+   ///
+   void setConstraints (const Constraints& constraints);
+
+   /// Violation - a constraint violated by the last call of process or visit.
+   ///
+   struct Violation {
+      ConstraintPointer constraint;
+      std::string message;
+   };
+   typedef std::list<Violation> Violations;
+
+   /// \brief violations - all the constraints violated by the last call of
+   /// process or visit, in the order set. Empty unless the error code is
+   /// kConstraintViolation.
+   /// \return Violations
+   ///
+   Violations violations () const;
+
+   /// \brief setProfiles - defines the profiles selected by the profile option
+   /// (see profileOption), replacing any previously set. Each setting is
+   /// validated and converted here, once, so that selecting a profile copies
+   /// the precomputed values. The profiles given are applied in order, so a
+   /// later profile overrides an earlier one, and options given explicitly,
+   /// by argument, override them all; the profiles override environment
+   /// variables and defaults. The profiles are listed by optionHelp.
+   /// An unknown option or invalid value is a specification error.
+   /// \param profiles - the collection of profiles.
+   ///
+   void setProfiles (const Profiles& profiles);
+
+   /// \brief setParameterChecks - the checks made of each parameter, as a
+   /// path, together with those of the path options (see OptionSpec::checkPath).
+   /// \param checks - PathCheck values or'ed together, 0 for none.
+   /// \param minFreeSpace - the free space required, 0 for no check.
+   ///
+   void setParameterChecks (const unsigned checks, const uint64_t minFreeSpace = 0);
+
+   /// \brief setPathCheckThreads - the maximum number of threads on which
+   /// process makes the path checks. The default is 8; 1 makes the checks on
+   /// the calling thread. The other threads are started only once the checks
+   /// have taken 100 microseconds, so fast local checks incur no thread costs.
+   /// \param number - the number of threads.
+   ///
+   void setPathCheckThreads (const int number);
+
+   /// PathFailure - a path check failed by the last call of process.
+   ///
+   struct PathFailure {
+      std::string option;      // the option's name, or "parameter N"
+      std::string path;
+      std::string message;     // e.g. "--input 'data.csv' does not exist"
+   };
+   typedef std::list<PathFailure> PathFailures;
+
+   /// \brief pathFailures - all the path checks failed by the last call of
+   /// process, in option order followed by the parameters. Empty unless the
+   /// error code is kPathCheckFailed, the message of which lists them all.
+   /// \return PathFailures
+   ///
+   PathFailures pathFailures () const;
+
+   //---------------------------------------------------------------------------
+   /// Glob - the paths matching a glob pattern, as a single pass range, e.g.:
+   ///
+   ///    for (const char* path : Parsley::Glob ("/data/run42/**/*.h5")) ...
+   ///
+   /// Any component of the pattern may use * ? and [...] (negated by ! or ^,
+   /// with ranges such as a-z), and a ** component matches zero or more
+   /// directories. A name beginning with '.' is only matched explicitly, and
+   /// ** does not follow symbolic links. A pattern ending with '/' matches
+   /// directories only.
+   ///
+   /// The matches are delivered in sorted order, by component and bytewise,
+   /// as they are found: the directories are read ahead of the caller on up
+   /// to the given number of threads, each directory keeping only the names
+   /// that may match, packed into one buffer. A path without wildcards is
+   /// delivered as is; otherwise nothing is delivered when nothing matches.
+   ///
+   class Glob {
+   public:
+      explicit Glob (const std::string& pattern, const int threads = 8);
+      Glob (Glob&& other) noexcept;
+      ~Glob ();
+
+      Glob (const Glob&) = delete;
+      Glob& operator= (const Glob&) = delete;
+
+      /// \brief next - returns the next match, or nullptr once there are no
+      /// more. The path remains valid until the next call.
+      ///
+      const char* next ();
+
+      /// \brief isPattern - true when the path has any wildcards.
+      ///
+      static bool isPattern (const char* path, const size_t length) noexcept;
+
+      /// Iterator - an input iterator over the matches, by way of next.
+      ///
+      class Iterator {
+      public:
+         explicit Iterator (Glob* glob) : m_glob (glob), m_path (glob ? glob->next () : nullptr) { }
+         const char* operator* () const { return this->m_path; }
+         Iterator& operator++ () { this->m_path = this->m_glob->next (); return *this; }
+         bool operator!= (const Iterator& other) const { return this->m_path != other.m_path; }
+
+      private:
+         Glob* m_glob;
+         const char* m_path;
+      };
+
+      Iterator begin () { return Iterator (this); }
+      Iterator end () { return Iterator (nullptr); }
+
+   private:
+      struct PARSLEY_LOCAL Walk;
+      Walk* m_walk;
+   };
+
+   /// \brief setGlobParameters - when set, process replaces each parameter
+   /// that is a glob pattern by its matches (see Glob), in order; a pattern
+   /// that matches nothing is left as is. The default is not to.
+   /// \param expand - true to expand the parameters.
+   ///
+   void setGlobParameters (const bool expand);
+
+   /// \brief matches - the matches of a glob option's value (see
+   /// OptionSpec::glob), found on up to setPathCheckThreads threads. The
+   /// range is empty when the option is undefined or is not a glob option.
+   /// Only applicable if/when Parsley::process returned true.
+   /// \param longName - the option's long name.
+   /// \return Glob
+   ///
+   Glob matches (const std::string& longName) const;
+
+   /// \brief envPrefix - maps each option to an environment variable, formed
+   /// from the prefix and the option's long name in upper case with hyphens
+   /// replaced by underscores, e.g. with the prefix APP_, --foo-bar may be set
+   /// by APP_FOO_BAR. An option's own environment variable (see envVar) takes
+   /// precedence, and singleton options are not mapped.
+   /// The mapped names are indexed once, and process then resolves them by a
+   /// single pass over the environment rather than a getenv per option.
+   /// Any other variable starting with the prefix, usually a typo, is reported
+   /// by warnings. An empty prefix removes the mapping.
+   /// \param prefix - the environment variable name prefix, e.g. "APP_".
+   ///
+   void envPrefix (const std::string& prefix);
+
+   /// \brief warnings - the warnings arising from the last call of process or
+   /// visit, i.e. the unknown environment variables having the envPrefix and
+   /// the use of deprecated option names (see OptionSpec::deprecated).
+   /// These do not cause process to fail.
+   /// \return Arguments - the warning messages, environment variables first.
+   ///
+   Arguments warnings () const;
+
+   /// \brief optionHelp - provides auto generated option help information.
+   /// \param stream - the output stream which the option help is written to.
+   /// \return - the output stream.
+   ///
+   std::ostream& optionHelp (std::ostream& stream);
+
+   /// The shells for which completionScript can provide a script, in the
+   /// order of the completion option's values.
+   ///
+   enum Shell {
+      kBash = 0,
+      kZsh,
+      kFish
+   };
+
+   /// \brief completionScript - writes a self contained completion script for
+   /// the given shell. The script embeds the option names, which options take
+   /// values, the enumeration values and the file name hints (see fileValue),
+   /// so that completion does not run the program. Parameters complete as file
+   /// names. Typically provided by way of the completion option, e.g.:
+   ///
+   ///    eval "$(myprog --completion bash)"
+   ///
+   /// \param stream - the output stream which the script is written to.
+   /// \param shell - the shell.
+   /// \param program - the program name as typed by the user.
+   /// \return - the output stream.
+   ///
+   std::ostream& completionScript (std::ostream& stream, const Shell shell,
+                                   const std::string& program) const;
+
+   /// \brief completionQuery - answers a completion query, of the form:
+   ///
+   ///    myprog --parsley-complete <cword> <words...>
+   ///
+   /// where the words are those being completed, the first being the program
+   /// name, and cword is the index of the current word. The option names, or
+   /// the option values, that match the current word are written one per line.
+   /// No environment variables, defaults or help are resolved; call this as
+   /// soon as the option specifications are known, before process, e.g.:
+   ///
+   ///    if (parser.completionQuery (argc, argv, true, std::cout)) return 0;
+   ///
+   /// \param arguments - the program's arguments.
+   /// \param skipProgramName - as for process.
+   /// \param stream - the output stream which the candidates are written to.
+   /// \return true if the arguments are a completion query, otherwise false.
+   ///
+   bool completionQuery (const Arguments& arguments, const bool skipProgramName,
+                         std::ostream& stream) const;
+
+   /// \brief completionQuery - as above, using the main argc and argv parameters.
+   ///
+   bool completionQuery (const int argc, const char* const* argv,
+                         const bool skipProgramName, std::ostream& stream) const;
+
+   // Utility function for process (and any other purpose).
+   // It forms an Arguments vector from the standard argc/argv main parameters.
+   //
+   ///
+   /// \brief formArguments - utility function to convert main argc and argv
+   /// parameters into an Arguments collection.
+   /// \param argc - number of arguments.
+   /// \param argv - the char* style arguments
+   /// \return Arguments
+   ///
+   static Arguments formArguments (const int argc, const char* const* argv);
+
+   /// \brief process - processes the given arguments.
+   /// \param arguments - the list of arguments to be analysed against the
+   /// option specification list provided to the constructor.
+   /// \param skipProgramName - when true, process skips over and ignore the zeroth argument.
+   /// \return true if no error detected otherwise false.
+   ///
+   /// process does not throw: all errors, including exhaustion of the parser's
+   /// memory resource (kOutOfMemory), are reported by the return value and
+   /// errorCode. The error message is only formed when requested.
+   ///
+   bool process (const Arguments& arguments, const bool skipProgramName) noexcept;
+
+   /// \brief process - as above, but the arguments are in the main argc/argv
+   /// form, so need not be copied into an Arguments collection first.
+   ///
+   bool process (const int argc, const char* const* argv, const bool skipProgramName) noexcept;
+
+   /// \brief process - as above, but also writes the values of the options
+   /// bound to members of the configuration struct (see OptionSpec::bind)
+   /// into config. A config of other than the bound struct type is rejected,
+   /// as a kProgramError.
+   /// \param arguments - the list of arguments to be analysed.
+   /// \param skipProgramName - when true, the zeroth argument is skipped.
+   /// \param config - the configuration struct.
+   /// \return true if no error detected otherwise false.
+   ///
+   template <typename Config>
+   bool process (const Arguments& arguments, const bool skipProgramName,
+                 Config& config) noexcept
+   {
+      static_assert (std::is_standard_layout<Config>::value,
+                     "configuration struct must be a standard layout type");
+
+      return this->processInto (arguments, skipProgramName, &config, configType<Config> ());
+   }
+
+   /// ErrorCode - identifies the first error detected by process, visit or
+   /// processSafe.
+   ///
+   enum ErrorCode {
+      kNoError = 0,             ///< no error
+      kSpecificationError,      ///< the option specifications are inconsistent
+      kInvalidOptionFormat,     ///< e.g. -xyz
+      kNoSuchOption,            ///< unknown option name
+      kDuplicateOption,         ///< option specified more than once
+      kMissingArgument,         ///< option requires an argument
+      kInvalidEnumValue,        ///< value is not one of the enumeration options
+      kInvalidInteger,          ///< value is not a valid integer
+      kInvalidReal,             ///< value is not a valid floating point number
+      kInvalidValue,            ///< value is not valid for a user defined type
+      kOutOfRange,              ///< value is out of the specified range
+      kValueRequired,           ///< a required option has no value
+      kConstraintViolation,     ///< a constraint between options is not met
+      kNoSuchProfile,           ///< unknown profile name
+      kPatternMismatch,         ///< value does not match the option's pattern
+      kPathCheckFailed,         ///< one or more path checks failed
+      kInsufficientStorage,     ///< processSafe result storage is too small
+      kOutOfMemory,             ///< the parser's memory resource is exhausted
+      kStopped,                 ///< a visitor stopped processing
+      kProgramError             ///< internal error
+   };
+
+   /// \brief errorCodeName - a short, static description of an error code.
+   /// Async-signal-safe.
+   /// \param code - the error code.
+   /// \return null terminated static string.
+   ///
+   static const char* errorCodeName (const ErrorCode code) noexcept;
+
+   /// SafeResult - the caller provided, fixed capacity, storage updated by
+   /// processSafe. The values array is indexed by slot, i.e. the position of
+   /// the option within the specifications (see slotOf). The string values and
+   /// parameters point into argv, envp or the option specifications.
+   ///
+   class SafeResult {
+   public:
+      explicit SafeResult (OptionView* values, const size_t valueCapacity,
+                           const char** parameters, const size_t parameterCapacity);
+      ~SafeResult ();
+
+      OptionView* values;         ///< one per option, caller provided
+      size_t valueCapacity;       ///< must be >= optionCount ()
+      const char** parameters;    ///< caller provided
+      size_t parameterCapacity;   ///< the maximum number of parameters
+      size_t parameterCount;      ///< the number of parameters found
+      ErrorCode error;            ///< kNoError if successful
+      int errorArgument;          ///< the offending argv index, or -1
+      int errorSlot;              ///< the offending option slot, or -1
+   };
+
+   /// \brief processSafe - a restricted form of process that may be used where
+   /// only async-signal-safe operations are allowed, e.g. in a child process
+   /// between fork and exec. It does not allocate memory, does not use getenv
+   /// (any environment variables are looked up in the given envp) and does not
+   /// record invocations, update metrics or form error messages - errors are
+   /// reported as codes only. The parser object is not modified; it, and so the
+   /// name index, should be constructed before the fork.
+   /// __Note:__ the numeric conversions use strtol and strtod which, while not
+   /// listed by POSIX as async-signal-safe, neither allocate nor lock.
+   /// \param argc - number of arguments.
+   /// \param argv - the arguments.
+   /// \param envp - null terminated environment array, e.g. environ as captured
+   /// before the fork. May be nullptr, in which case envVar is ignored.
+   /// \param skipProgramName - when true, the zeroth argument is skipped.
+   /// \param result - the caller's storage, updated with the values. User
+   /// defined type values (see customSpec) are validated, but only their text
+   /// is provided, i.e. custom is nullptr.
+   /// \return true if no error detected otherwise false.
+   ///
+   bool processSafe (const int argc, const char* const* argv,
+                     const char* const* envp, const bool skipProgramName,
+                     SafeResult& result) const noexcept;
+
+   /// \brief optionCount - the number of options, i.e. the number of slots.
+   ///
+   size_t optionCount () const noexcept;
+
+   /// \brief slotOf - the slot of the named option.
+   /// \param longName - the option's long name.
+   /// \return slot, or -1 if no such option.
+   ///
+   int slotOf (const char* longName) const noexcept;
+
+   //---------------------------------------------------------------------------
+   /// Visitor - receives each option value and parameter as visit recognises
+   /// it, so that a caller needing only a few values need store nothing else.
+   /// Values from environment variables (see envVar) are visited first, in slot
+   /// order, followed by those from the arguments, which may thus re-visit a
+   /// slot. Default values are not visited. The str pointers are null
+   /// terminated, and are only valid for the duration of the call.
+   /// Each function returns true to continue, or false to stop processing, in
+   /// which case visit returns false and errorCode is kStopped. The default
+   /// implementations ignore the value.
+   ///
+   class Visitor {
+   public:
+      explicit Visitor ();
+      virtual ~Visitor ();
+
+      virtual bool onFlag (const int slot);
+
+      /// A negatable flag turned off by its --no-<name> (see negatable).
+      virtual bool onNegatedFlag (const int slot);
+
+      virtual bool onInt (const int slot, const intp_t value);
+      virtual bool onReal (const int slot, const double value);
+      virtual bool onStr (const int slot, const char* str, const size_t length);
+
+      /// The default implementation calls onStr.
+      virtual bool onEnum (const int slot, const intp_t index,
+                           const char* str, const size_t length);
+
+      /// The value is of the option's user defined type (see customSpec).
+      /// The default implementation calls onStr.
+      virtual bool onCustom (const int slot, const void* value,
+                             const char* str, const size_t length);
+
+      virtual bool onParameter (const char* str, const size_t length);
+   };
+
+   /// \brief visit - as process, but rather than storing the values, calls the
+   /// visitor's functions. Once warmed up (see process), visit does not
+   /// allocate memory. Any values from a previous call to process are cleared.
+   /// process is itself implemented by way of visit.
+   /// \param arguments - the list of arguments to be analysed.
+   /// \param skipProgramName - when true, the zeroth argument is skipped.
+   /// \param visitor - receives the values.
+   /// \return true if no error detected otherwise false.
+   ///
+   bool visit (const Arguments& arguments, const bool skipProgramName,
+               Visitor& visitor) noexcept;
+
+   /// \brief visit - as above, but the arguments are in the main argc/argv form.
+   ///
+   bool visit (const int argc, const char* const* argv, const bool skipProgramName,
+               Visitor& visitor) noexcept;
+
+   //---------------------------------------------------------------------------
+   /// Invocation - a recorded call of the process method.
+   ///
+   /// When the PARSLEY_RECORD_FILE environment variable is set to the name of
+   /// a file, each call to process appends a record of the arguments, together
+   /// with the values of the relevant environment variables (those named by
+   /// envVar), to that file. Each record is appended by a single write to a
+   /// file opened with O_APPEND, so concurrently running programs may safely
+   /// share the one corpus file. These records may be read back using
+   /// readCorpus and replayed in-process, e.g. for regression benchmarking.
+   ///
+   class Invocation {
+   public:
+      explicit Invocation ();
+      ~Invocation ();
+
+      /// \brief EnvironmentValue - the value of a relevant environment variable
+      /// at the time of the invocation.
+      ///
+      class EnvironmentValue {
+      public:
+         std::string name;
+         std::string value;
+         bool isDefined;   // false when the variable was not set
+      };
+
+      std::string tool;                              ///< short program name
+      bool skipProgramName;                          ///< as passed to process
+      Arguments arguments;                           ///< as passed to process
+      std::vector<EnvironmentValue> environment;     ///< relevant env values
+   };
+
+   /// Invocations defines a collection (std vector) of recorded Invocations.
+   //
+   typedef std::vector <Invocation> Invocations;
+
+   /// \brief readCorpus - reads the invocations recorded in the given corpus file.
+   /// \param filename - the corpus file name.
+   /// \param invocations - the invocations read are appended to this collection.
+   /// \return true if the whole file was read successfully, false if the file
+   /// could not be read or a corrupt/truncated record was found.
+   ///
+   static bool readCorpus (const std::string& filename, Invocations& invocations);
+
+   /// ReplayResult - the outcome of replaying a corpus, see replay.
+   ///
+   class ReplayResult {
+   public:
+      explicit ReplayResult ();
+      ~ReplayResult ();
+
+      size_t replayed;         ///< number of process calls made
+      size_t skipped;          ///< invocations recorded by other tools
+      size_t failed;           ///< invocations for which process returned false
+      uint64_t processNs;      ///< total time spent within process
+      uint64_t allocations;    ///< made within process - see allocationStats
+      std::vector<uint64_t> digests;   ///< per invocation outcome hash, 0 if skipped
+   };
+
+   /// \brief replay - runs recorded invocations through this parser's process
+   /// method, so that a program may replay its own corpus with its own option
+   /// specifications, e.g.:
+   ///
+   ///    const char* corpusFile = getenv ("MYPROG_REPLAY");
+   ///    if (corpusFile) {
+   ///       Parsley::Invocations corpus;
+   ///       Parsley::ReplayResult result;
+   ///       Parsley::readCorpus (corpusFile, corpus);
+   ///       parser.replay (corpus, "myprog", 10, result);
+   ///       ...
+   ///    }
+   ///
+   /// The recorded environment values are applied before each call, and the
+   /// caller's values are restored once done. As setenv is not thread safe,
+   /// replay must not run alongside other threads that read the environment.
+   /// (parsley's own path check and glob threads have finished by the time
+   /// process returns, and do not read it.)
+   /// The replayed calls are not themselves recorded. Each digest
+   /// is a hash of the option values and parameters, or of the error, from
+   /// the first replay of the invocation, and may be compared with those of
+   /// an earlier build of the program.
+   /// \param corpus - the invocations, see readCorpus.
+   /// \param tool - only invocations recorded by this tool are replayed, or
+   /// all of them when empty.
+   /// \param repeat - the number of times the invocations are replayed.
+   /// \param result - the replay counts, time and digests.
+   /// \return true if any invocation was replayed.
+   ///
+   bool replay (const Invocations& corpus, const std::string& tool,
+                const int repeat, ReplayResult& result);
 
    /// \brief errorMessage - returns the first error detected by the process
    /// mothod. Only applicable if/when Parsley::process returned false.
@@ -392,24 +1803,474 @@ public:
    ///
    std::string errorMessage() const;
 
+   /// \brief errorCode - returns the code of the first error detected by the
+   /// process mothod, or kNoError.
+   /// \return ErrorCode
+   ///
+   ErrorCode errorCode () const noexcept;
+
    /// \brief options - returns the set of option values.
    /// Only applicable if/when Parsley::process returned true.
    /// \return Parsley::OptionValues
    ///
    OptionValues options () const;
 
+   /// \brief options - as above, but updates the given option values object.
+   /// When the same object is re-used for each call, this does not allocate
+   /// memory once the object has been "warmed up".
+   /// \param into - the option values object to be updated.
+   ///
+   void options (OptionValues& into) const;
+
    /// \brief parameters - returns the arguments NOT consumed as options.
    /// __Note:__ Parsley does not parse the parameter arguments, only the options.
    /// \return Arguments
    ///
    Arguments parameters () const;
 
+   /// \brief parameters - as above, but updates the given arguments object.
+   /// \param into - the arguments object to be updated.
+   ///
+   void parameters (Arguments& into) const;
+
+   /// \brief parameterCount - the number of parameters.
+   ///
+   size_t parameterCount () const noexcept;
+
+   /// \brief parameter - returns the j-th parameter, without allocating memory.
+   /// The pointer remains valid until the next call to process.
+   /// \param j - the parameter number, 0 to parameterCount () - 1.
+   /// \return the null terminated parameter, or nullptr if j out of range.
+   ///
+   const char* parameter (const size_t j) const noexcept;
+
+   //---------------------------------------------------------------------------
+   /// Interpreter - executes command lines of the form:
+   ///
+   ///    <verb> [options] [parameters]
+   ///
+   /// e.g. from an admin console or a script. Each verb has its own option
+   /// specifications, compiled once into a parser held by the interpreter,
+   /// and a handler to which each command is dispatched. A line is split into
+   /// words in place: words are separated by white space, may be quoted by
+   /// '...' or "..." (within which \" and \\ are escapes), and a \ outside
+   /// quotes escapes the next character. A # beginning a word starts a
+   /// comment. Once warmed up, execute does not allocate memory (other than
+   /// when forming an error message), the values being updated in place.
+   ///
+   class Interpreter {
+   public:
+      /// Handler - receives the commands of a verb (see addVerb).
+      ///
+      class Handler {
+      public:
+         explicit Handler ();
+         virtual ~Handler ();
+
+         /// \brief onCommand - called for each command of the verb once the
+         /// verb's parser has processed it. The parameters are available by
+         /// way of the parser's parameterCount and parameter functions.
+         /// \return true if successful, otherwise false.
+         ///
+         virtual bool onCommand (const char* verb, Parsley& parser,
+                                 const OptionValues& options) = 0;
+      };
+
+      /// The outcome of the last line executed.
+      ///
+      enum Outcome {
+         kExecuted = 0,        ///< the handler succeeded
+         kEmpty,               ///< the line was blank or a comment
+         kNoSuchVerb,          ///< the first word is not a verb
+         kUnterminatedQuote,   ///< a quoted word is not closed
+         kInvalidCommand,      ///< the verb's parser reported an error
+         kCommandFailed        ///< the handler returned false
+      };
+
+      explicit Interpreter (MemoryResource& resource = defaultResource ());
+      ~Interpreter ();
+
+      Interpreter (const Interpreter&) = delete;
+      Interpreter& operator= (const Interpreter&) = delete;
+
+      /// \brief addVerb - adds a verb, constructing its parser. A duplicate
+      /// or malformed verb is a specification error, and is ignored.
+      /// \param verb - the verb, a single word.
+      /// \param specList - the verb's option specifications.
+      /// \param handler - receives the verb's commands; it must outlive
+      /// the interpreter.
+      /// \param description - shown by commandHelp.
+      /// \return true if added.
+      ///
+      bool addVerb (const std::string& verb, const OptionSpecifications& specList,
+                    Handler& handler, const std::string& description = "");
+
+      /// \brief execute - splits the line into words, in place, and processes
+      /// and dispatches the command.
+      /// \param line - the null terminated line, which is modified.
+      /// \return true if executed, or the line was empty, otherwise false.
+      ///
+      bool execute (char* line);
+
+      /// \brief run - executes each line read from the input until its end,
+      /// writing a message to errors for each line that fails.
+      /// \return the number of lines that failed.
+      ///
+      size_t run (std::istream& input, std::ostream& errors);
+
+      /// \brief outcome - the outcome of the last line executed.
+      ///
+      Outcome outcome () const noexcept;
+
+      /// \brief errorMessage - describes the failure of the last line executed.
+      /// \return std::string, empty if it did not fail.
+      ///
+      std::string errorMessage () const;
+
+      /// \brief parser - the parser of the given verb, e.g. to set its
+      /// constraints or profiles.
+      /// \return the parser, or nullptr if there is no such verb.
+      ///
+      Parsley* parser (const std::string& verb) const;
+
+      /// \brief commandHelp - lists the verbs and their descriptions.
+      ///
+      std::ostream& commandHelp (std::ostream& stream) const;
+
+   private:
+      struct Verb {
+         std::string name;
+         std::string description;
+         std::shared_ptr<Parsley> parser;
+         std::shared_ptr<OptionValues> values;
+         Handler* handler;
+      };
+
+      PARSLEY_LOCAL bool failed (const Outcome outcome, const Verb* verb, const char* word);
+
+      MemoryResource* m_resource;
+      std::vector<Verb> m_verbs;   // in order of name
+      std::vector<const char*, Allocator<const char*> > m_words;
+      std::string m_line;          // as read by run
+      Outcome m_outcome;
+      const Verb* m_failedVerb;
+      std::string m_failedWord;    // e.g. the unknown verb
+   };
+
+   //---------------------------------------------------------------------------
+   /// AllocationStats - heap allocation counts made by the calling thread
+   /// within the parsley entry points, i.e. the Parsley constructor, process,
+   /// optionHelp, options and parameters.
+   ///
+   /// The counts are only available when the program is linked with the
+   /// parsley allocation hook (libparsley_alloc.a), which replaces the global
+   /// operator new and delete. Otherwise the counts remain zero.
+   ///
+   class AllocationStats {
+   public:
+      explicit AllocationStats ();
+      ~AllocationStats ();
+
+      uint64_t allocations;     ///< number of allocations
+      uint64_t deallocations;   ///< number of deallocations
+      uint64_t bytes;           ///< total bytes allocated
+   };
+
+   /// \brief allocationStats - returns the calling thread's allocation counts.
+   /// \return AllocationStats
+   ///
+   static AllocationStats allocationStats ();
+
+   /// \brief resetAllocationStats - zeros the calling thread's allocation counts.
+   ///
+   static void resetAllocationStats ();
+
+   /// \brief allocationStatsAvailable - indicates if the allocation hook is present.
+   /// \return true if the allocation hook has been linked into the program.
+   ///
+   static bool allocationStatsAvailable ();
+
+   /// \brief noteHookPresent - called once by the allocation hook, when the
+   /// program starts, not intended to be called directly.
+   ///
+   static void noteHookPresent ();
+
+   /// \brief noteAllocation - called by the allocation hook, not intended to be
+   /// called directly.
+   /// \param size - the allocation size
+   ///
+   static void noteAllocation (const size_t size);
+
+   /// \brief noteDeallocation - called by the allocation hook, not intended
+   /// to be called directly.
+   ///
+   static void noteDeallocation ();
+
+   //---------------------------------------------------------------------------
+   /// Metrics - per phase timings and counters for the most recent call to
+   /// process (and, for the help phase, optionHelp).
+   ///
+   /// The instrumentation is compiled out of the library unless built with
+   /// PARSLEY_INSTRUMENTATION defined (make INSTRUMENTATION=1); otherwise all
+   /// values remain zero. Times are from the monotonic clock, in nano-seconds.
+   ///
+   class Metrics {
+   public:
+      explicit Metrics ();
+      ~Metrics ();
+
+      enum Phase {
+         kEnvironment = 0,   ///< default and environment variable resolution
+         kArgumentScan,      ///< argument scanning, including conversions
+         kConversion,        ///< value conversions (within argument scan)
+         kValidation,        ///< required option validation
+         kHelp,              ///< optionHelp rendering
+         kNumberOfPhases
+      };
+
+      /// \brief phaseName - returns the name of the phase, e.g. "environment".
+      ///
+      static const char* phaseName (const Phase phase);
+
+      uint64_t phaseStartNs [kNumberOfPhases];   ///< time at (first) start of phase
+      uint64_t phaseNs [kNumberOfPhases];        ///< total time spent in phase
+
+      uint64_t lookups;       ///< option name look ups
+      uint64_t conversions;   ///< integer, real and enumeration conversions
+      uint64_t envLookups;    ///< environment variable look ups
+      uint64_t envHits;       ///< environment variable look ups that found a value
+      uint64_t bytesCopied;   ///< string bytes copied into values and parameters
+      uint64_t arguments;     ///< arguments examined
+
+   private:
+      void clear (const bool includeHelp);
+      void begin (const Phase phase);
+      void end (const Phase phase);
+
+      uint64_t m_current [kNumberOfPhases];   // start time of current phase
+
+      friend class Parsley;
+   };
+
+   /// \brief instrumentationEnabled - indicates if the library was built with
+   /// instrumentation enabled.
+   /// \return true if enabled.
+   ///
+   static bool instrumentationEnabled ();
+
+   /// \brief metrics - returns the metrics of the most recent process call.
+   /// \return Metrics
+   ///
+   const Metrics& metrics () const;
+
+   /// \brief writeTraceEvents - writes the metrics as Chrome trace-event
+   /// format JSON (complete 'X' events for each phase, and a 'C' counter event).
+   /// Time stamps are the monotonic clock in micro-seconds, so these events
+   /// may be merged with other traces that use the same clock.
+   /// \param os - the output stream.
+   /// \param complete - when true, the events are written as a complete JSON
+   /// document ({"traceEvents": [...]}), otherwise as a comma separated list
+   /// of event objects suitable for inclusion in a larger trace.
+   /// \return the output stream.
+   ///
+   std::ostream& writeTraceEvents (std::ostream& os, const bool complete = true) const;
+
+   /// \brief footprint - estimates the memory used by this object, including
+   /// the option specifications and the name index.
+   /// \return Footprint
+   ///
+   Footprint footprint () const;
+
 private:
-   const OptionSpecifications m_specList;
+   // An OptionSpec allocated together with its shared pointer control block.
+   //
+   class PARSLEY_LOCAL SharedSpec;
+
+   // A growable array of trivially copyable items, as std::vector, except
+   // that growth reports allocation failure rather than throwing.
+   //
+   template <typename T>
+   class PARSLEY_LOCAL Buffer {
+   public:
+      explicit Buffer (MemoryResource* resource);
+      ~Buffer ();
+
+      bool append (const T* items, const size_t number) noexcept;
+      void truncate (const size_t size) noexcept;   // to a smaller size only
+
+      T* data () noexcept { return this->m_data; }
+      const T* data () const noexcept { return this->m_data; }
+      size_t size () const noexcept { return this->m_size; }
+      size_t capacity () const noexcept { return this->m_capacity; }
+      const T& operator[] (const size_t j) const noexcept { return this->m_data[j]; }
+
+   private:
+      Buffer (const Buffer&);              // not copyable
+      Buffer& operator= (const Buffer&);
+
+      MemoryResource* m_resource;
+      T* m_data;
+      size_t m_size;
+      size_t m_capacity;
+   };
+
+   // Where the value concerned by an error came from.
+   //
+   enum ErrorSource { kFromArgument, kFromEnvironment, kFromDefault };
+
+   MemoryResource* m_resource;
+   std::vector<OptionSpecPointer, Allocator<OptionSpecPointer> > m_specs;   // slot order
+   NameIndexPointer m_index;
+   std::vector<OptionGroupPointer, Allocator<OptionGroupPointer> > m_groups;  // if any
+   const void* m_configType;    // of the struct whose members are bound, if any
    bool m_specListOkay;
-   std::string m_errorMessage;
-   OptionValues m_optionValues;
-   Arguments m_parameters;
+   ErrorCode m_specListError;   // kSpecificationError or kOutOfMemory
+
+   // The error context, from which errorMessage forms the message.
+   //
+   ErrorCode m_errorCode;
+   int m_errorSlot;             // the option concerned, or -1
+   ErrorSource m_errorSource;
+   TextRef m_errorValue;        // the offending value, held in the text buffer
+   intp_t m_errorInt;           // the out of range value
+   double m_errorReal;
+
+   // Per slot values, the text buffer holding the string values and the
+   // parameters - all re-used by each call to process.
+   //
+   Slots m_slots;
+   Bits m_seen;                 // given by argument - to detect duplicates
+   Bits m_defined;              // by environment variable or argument
+   Bits m_required;             // required, and without a default - fixed
+   Buffer<char> m_text;
+   Buffer<TextRef> m_parameters;
+   bool m_singletonGiven;       // by the last scan, which stopped there
+
+   // The environment prefix mapping, see envPrefix. The index holds the full
+   // variable names; the values found by scan's pass over the environment are
+   // held per slot.
+   //
+   std::string m_envPrefix;
+   NameIndexPointer m_envIndex;
+   std::vector<const char*, Allocator<const char*> > m_envValues;
+
+   // The unknown environment variable or deprecated option name, held in
+   // the text buffer - see warnings.
+   //
+   struct Warning {
+      TextRef name;
+      int slot;            // the deprecated option's slot, or -1
+   };
+   Buffer<Warning> m_warnings;
+
+   // The compiled constraints. Each rule's mask is held as the non-zero words
+   // only, in m_ruleMasks, so large specifications cost no more per rule.
+   //
+   struct MaskWord {
+      uint32_t word;
+      uint64_t bits;
+   };
+
+   struct Rule {
+      Constraint::Kind kind;
+      int subject;         // kDependsOn only - the dependent option's slot
+      uint32_t first;      // mask words
+      uint32_t count;
+   };
+
+   std::vector<ConstraintPointer, Allocator<ConstraintPointer> > m_constraints;
+   std::vector<Rule, Allocator<Rule> > m_rules;                 // as m_constraints
+   std::vector<MaskWord, Allocator<MaskWord> > m_ruleMasks;
+   Bits m_defaulted;                                            // have a default
+   std::vector<int, Allocator<int> > m_violated;                // rule indices
+
+   // The compiled profiles: each profile's presets are contiguous in
+   // m_presets. The profiles selected by the last scan, in order.
+   //
+   struct PresetRange {
+      uint32_t first;
+      uint32_t count;
+   };
+
+   std::vector<ProfilePointer, Allocator<ProfilePointer> > m_profiles;
+   std::vector<PresetRange, Allocator<PresetRange> > m_presetRanges;   // as m_profiles
+   std::vector<Preset, Allocator<Preset> > m_presets;
+   std::vector<int, Allocator<int> > m_selected;
+   size_t m_textBase;           // the text buffer prefix retained by process
+
+   // A path to be checked: the value of a path option (slot) or a parameter
+   // (slot -1). Any failure is recorded by the thread making the check.
+   //
+   struct PathJob {
+      int slot;
+      int parameter;
+      TextRef path;
+      unsigned checks;
+      uint64_t minFreeSpace;
+      unsigned failed;     // the check failed, 0 if none
+      int error;           // errno, if the path could not be examined
+   };
+   Buffer<PathJob> m_pathJobs;
+   std::vector<int, Allocator<int> > m_pathSlots;   // the checked path options
+   unsigned m_parameterChecks;
+   uint64_t m_parameterFreeSpace;
+   int m_pathThreads;
+   bool m_globParameters;
+
+   Metrics m_metrics;
+   class PARSLEY_LOCAL PhaseScope;
+
+   // The visitor by which process stores the values, and the adapters that
+   // present either form of the arguments to scan.
+   //
+   class PARSLEY_LOCAL SlotWriter;
+   struct PARSLEY_LOCAL PathContext;
+   class PARSLEY_LOCAL ArgumentList;
+   class PARSLEY_LOCAL ArgumentVector;
+
+   template <typename Collection>
+   PARSLEY_LOCAL void construct (const Collection& collection);
+   PARSLEY_LOCAL void initialise (const OptionSpecifications& specList);
+   PARSLEY_LOCAL void initialise (const OptionGroups& groups);
+   PARSLEY_LOCAL void allocateSlots ();
+   PARSLEY_LOCAL static NameIndexPointer
+   buildIndex (const std::vector<OptionSpecPointer, Allocator<OptionSpecPointer> >& specs,
+               MemoryResource& resource, bool& isOkay);
+   PARSLEY_LOCAL void specHelp (std::ostream& os, const OptionSpec& spec) const;
+   PARSLEY_LOCAL bool checkConstraints () noexcept;
+   PARSLEY_LOCAL std::string envVarName (const OptionSpec& spec) const;
+   PARSLEY_LOCAL void scanEnvironment () noexcept;
+   PARSLEY_LOCAL bool selectProfiles (const char* names, const size_t length) noexcept;
+   PARSLEY_LOCAL bool checkPaths (void* config) noexcept;
+   PARSLEY_LOCAL static void checkPath (const char* path, PathJob& job) noexcept;
+   PARSLEY_LOCAL static void* pathWorker (void* context);
+   PARSLEY_LOCAL std::string pathMessage (const PathJob& job) const;
+   PARSLEY_LOCAL bool expandParameters () noexcept;
+   PARSLEY_LOCAL bool addPathJobs (PathJob& job) noexcept;
+   PARSLEY_LOCAL const char* mappedEnv (const char* const* envp, const int slot) const noexcept;
+   PARSLEY_LOCAL void record (const Arguments& arguments, const bool skipProgramName) const;
+   PARSLEY_LOCAL uint64_t digest (const bool status) const;
+   PARSLEY_LOCAL void clear () noexcept;
+   bool processInto (const Arguments& arguments, const bool skipProgramName,
+                     void* config, const void* type) noexcept;
+   template <typename Source>
+   PARSLEY_LOCAL bool processSource (const Source& source, const bool skipProgramName,
+                                     void* config) noexcept;
+   template <typename Source>
+   PARSLEY_LOCAL bool scan (const Source& source, const bool skipProgramName,
+                            Visitor& visitor, SlotWriter* writer = nullptr) noexcept;
+   PARSLEY_LOCAL static bool visitPreset (Visitor& visitor, const Preset& preset,
+                                          const char* str);
+   template <typename Source>
+   PARSLEY_LOCAL bool complete (const Source& source, const bool skipProgramName,
+                                std::ostream& stream) const;
+   PARSLEY_LOCAL int lookup (const char* arg, const size_t length) const;
+   PARSLEY_LOCAL bool fail (const ErrorCode code, const int slot,
+                            const ErrorSource source = kFromArgument,
+                            const char* value = nullptr, const size_t length = 0) noexcept;
+   PARSLEY_LOCAL bool addParameter (const char* str, const size_t length) noexcept;
+   PARSLEY_LOCAL bool addText (const char* str, const size_t length, TextRef& ref) noexcept;
+   PARSLEY_LOCAL const char* textOf (const TextRef& ref) const noexcept;
 
    // Qualifies optionHelp output.
    //
@@ -0,0 +1,92 @@
+/* parsley_alloc.cpp
+ *
+ * Description:
+ * The optional parsley allocation hook. This replaces the global operator new
+ * and delete with versions that report each allocation to Parsley, which keeps
+ * per thread counts of the allocations made within the parsley entry points.
+ * See Parsley::allocationStats.
+ *
+ * This is built into libparsley_alloc.a, and must be linked into the program
+ * itself (as opposed to a shared library), e.g.:
+ *
+ *    g++ -o myprog myprog.o -lparsley_alloc -lparsley
+ *
+ * SPDX-FileCopyrightText: 2025  Andrew C. Starritt
+ * SPDX-License-Identifier: LGPL-2.1-only
+ */
+
+#include "parsley.h"
+#include <cstdlib>
+#include <new>
+
+//------------------------------------------------------------------------------
+// Makes allocationStatsAvailable true from the start, rather than have each
+// allocation set it.
+//
+static const bool hookPresent = [] () {
+   Parsley::noteHookPresent ();
+   return true;
+} ();
+
+//------------------------------------------------------------------------------
+//
+void* operator new (std::size_t size)
+{
+   Parsley::noteAllocation (size);
+   void* p = std::malloc (size ? size : 1);
+   if (!p) throw std::bad_alloc ();
+   return p;
+}
+
+//------------------------------------------------------------------------------
+//
+void* operator new[] (std::size_t size)
+{
+   return ::operator new (size);
+}
+
+//------------------------------------------------------------------------------
+//
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+   Parsley::noteAllocation (size);
+   return std::malloc (size ? size : 1);
+}
+
+//------------------------------------------------------------------------------
+//
+void* operator new[] (std::size_t size, const std::nothrow_t& tag) noexcept
+{
+   return ::operator new (size, tag);
+}
+
+//------------------------------------------------------------------------------
+//
+void operator delete (void* p) noexcept
+{
+   if (p) Parsley::noteDeallocation ();
+   std::free (p);
+}
+
+//------------------------------------------------------------------------------
+//
+void operator delete[] (void* p) noexcept
+{
+   ::operator delete (p);
+}
+
+//------------------------------------------------------------------------------
+//
+void operator delete (void* p, std::size_t) noexcept
+{
+   ::operator delete (p);
+}
+
+//------------------------------------------------------------------------------
+//
+void operator delete[] (void* p, std::size_t) noexcept
+{
+   ::operator delete (p);
+}
+
+// end
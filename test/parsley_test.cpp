@@ -1,8 +1,15 @@
 // parsley test
 //
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <parsley.h>
 
 #define nl                '\n'
@@ -16,6 +23,34 @@ static const Parsley::EnumOptions enumChoice = {
    "aaa", "bbb", "ccc", "ddd", "eee", "fff"
 };
 
+//------------------------------------------------------------------------------
+// Malloc interposer - once armed, any allocation aborts the program.
+// Used by the async-signal-safe tests.
+//
+extern "C" void* __libc_malloc (size_t size);
+extern "C" void* __libc_calloc (size_t number, size_t size);
+extern "C" void* __libc_realloc (void* ptr, size_t size);
+
+static volatile bool mallocArmed = false;
+
+extern "C" void* malloc (size_t size)
+{
+   if (mallocArmed) abort ();
+   return __libc_malloc (size);
+}
+
+extern "C" void* calloc (size_t number, size_t size)
+{
+   if (mallocArmed) abort ();
+   return __libc_calloc (number, size);
+}
+
+extern "C" void* realloc (void* ptr, size_t size)
+{
+   if (mallocArmed) abort ();
+   return __libc_realloc (ptr, size);
+}
+
 //------------------------------------------------------------------------------
 // This get and dumps an arbirary OptionValue
 // Will rebadge SimpleValue, OptionValue => OptionValue, OptionValueHolder
@@ -235,46 +270,1512 @@ static int group4 (const Parsley::Arguments& args)
    return 0;
 }
 
-// Like group 2 but with both program defined and environment variable
-// defined defaults
+//------------------------------------------------------------------------------
+// Allocation tests: once warmed up, neither process (given valid input)
+// nor options/parameters into re-used objects should allocate.
+//
+static int group5 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      Parsley::enumSpec ("mode", 'm', "The mode option description.", enumChoice)->envVar("PARSLEY_ENUM"),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->envVar("PARSLEY_INT"),
+      Parsley::realSpec ("real", 'r', "The real option description.")->defReal(31.6227),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   std::cout << "allocation stats available: "
+             << (Parsley::allocationStatsAvailable() ? "yes" : "no") << nl;
+
+   Parsley parser (optionsSpec);
+   Parsley::OptionValues options;
+   Parsley::Arguments parameters;
+
+   // Warm up.
+   //
+   Parsley::resetAllocationStats ();
+   bool status = parser.process (args, true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      return 2;
+   }
+   parser.options (options);
+   parser.parameters (parameters);
+   std::cout << "warm up allocates: "
+             << (Parsley::allocationStats().allocations > 0 ? "yes" : "no") << nl;
+
+   // Steady state.
+   //
+   Parsley::resetAllocationStats ();
+   for (int j = 0; j < 10; j++) {
+      status = status && parser.process (args, true);
+      parser.options (options);
+      parser.parameters (parameters);
+   }
+   const Parsley::AllocationStats stats = Parsley::allocationStats();
+   std::cout << "steady state status: " << (status ? "okay" : "failed")
+             << " allocations: " << stats.allocations
+             << " deallocations: " << stats.deallocations << nl;
 
+   dump (options, "flag");
+   dump (options, "string");
+   dump (options, "mode");
+   dump (options, "number");
+   dump (options, "real");
 
+   std::cout << "params: " << Parsley::join (parameters) << nl;
+   return 0;
+}
 
 //------------------------------------------------------------------------------
+// Footprint tests: the actual numbers are platform specific, so only the
+// relationships between them are reported.
 //
-int main (int argc, char** argv)
+static int group6 (const Parsley::Arguments& args)
 {
-   std::cout << "parsley test: ";
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      Parsley::enumSpec ("mode", 'm', "The mode option description.", enumChoice)->envVar("PARSLEY_ENUM"),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->intRange(-100, 100),
+      Parsley::realSpec ("real", 'r', "The real option description.")->defReal(31.6227),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
 
-   Parsley::Arguments args = Parsley::formArguments (argc, argv);
-   std::cout << Parsley::join (args) << nl;
+   Parsley parser (optionsSpec);
+   const Parsley::Footprint initial = parser.footprint();
 
-   // We use the last parameter to select which option specification
-   // group we are interested in.
+   bool status = parser.process (args, true);
+   if (!status) {
+      std::cerr << "error: " << parser.errorMessage() << nl;
+      return 2;
+   }
+
+   const Parsley::Footprint fp = parser.footprint();
+   const Parsley::OptionValues options = parser.options();
+   const Parsley::Footprint ofp = options.footprint();
+
+   const size_t sum = fp.object + fp.specs + fp.specTable + fp.index +
+                      fp.values + fp.parameters + fp.other;
+
+   std::cout << "components sum to total: " << (sum == fp.total() ? "yes" : "no") << nl;
+   std::cout << "specs, index and values non-zero: "
+             << ((fp.specs > 0) && (fp.index > 0) && (fp.values > 0) ? "yes" : "no") << nl;
+   std::cout << "specs unchanged by process: "
+             << (fp.specs == initial.specs ? "yes" : "no") << nl;
+   std::cout << "values grown by process: "
+             << (fp.values > initial.values ? "yes" : "no") << nl;
+   std::cout << "result shares index: "
+             << (ofp.index == fp.index ? "yes" : "no") << nl;
+   std::cout << "result has no specs: "
+             << ((ofp.specs == 0) && (ofp.specTable == 0) ? "yes" : "no") << nl;
+
+   Parsley constrained (optionsSpec);
+   const size_t other = constrained.footprint().other;
+   constrained.setConstraints ({ Parsley::conflicting ({ "flag", "string" }) });
+   std::cout << "constraints counted as other: "
+             << (constrained.footprint().other > other ? "yes" : "no") << nl;
+
+   dump (options, "string");
+   dump (options, "mode");
+   std::cout << "params: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Memory resource tests: with the specifications, the parser and the option
+// values all using an arena over a local buffer, no global allocations at all.
+//
+static int group7 (const Parsley::Arguments& args)
+{
+   static char buffer [16384];
+   Parsley::MonotonicArena arena (buffer, sizeof (buffer), Parsley::nullResource());
+
+   const Parsley::SpecBuilder build (arena);
+   const Parsley::OptionSpecifications optionsSpec = {
+      build.flagSpec ("flag", 'f',  "The flag option description."),
+      build.strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      build.enumSpec ("mode", 'm', "The mode option description.",
+                      { "aaa", "bbb", "ccc", "ddd", "eee", "fff" })->envVar("PARSLEY_ENUM"),
+      build.intSpec  ("number", 'n', "The number option description.")->envVar("PARSLEY_INT"),
+      build.realSpec ("real", 'r', "The real option description.")->defReal(31.6227),
+      build.version(),  // pre-defined singleton
+      build.help ()     // pre-defined singleton
+   };
+
+   const size_t specBytes = arena.bytesAllocated();
+   std::cout << "specs allocated from arena: " << (specBytes > 0 ? "yes" : "no") << nl;
+
+   Parsley::resetAllocationStats ();
+   bool status;
+   {
+      Parsley parser (optionsSpec, arena);
+      Parsley::OptionValues options (arena);
+
+      for (int j = 0; j < 3; j++) {
+         status = parser.process (args, true);
+         if (!status) {
+            std::cerr << "error: " << parser.errorMessage() << nl;
+            return 2;
+         }
+         parser.options (options);
+      }
+
+      const Parsley::OptionView mode = options.view ("mode");
+      const Parsley::OptionView str = options.view ("string");
+      const Parsley::AllocationStats stats = Parsley::allocationStats();
+
+      std::cout << "status: " << (status ? "okay" : "failed")
+                << " global allocations: " << stats.allocations << nl;
+      std::cout << "parser allocated from arena: "
+                << (arena.bytesAllocated() > specBytes ? "yes" : "no") << nl;
+      std::cout << "mode: " << mode.str << " (" << mode.ival << ")"
+                << " string: '" << str.str << "' length: " << str.length << nl;
+
+      std::cout << "params:";
+      for (size_t j = 0; j < parser.parameterCount(); j++) {
+         std::cout << " " << parser.parameter (j);
+      }
+      std::cout << nl;
+
+      dump (options, "flag");
+      dump (options, "number");
+   }
+
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Async-signal-safe output support - write (2) only.
+//
+static void safeWrite (const int fd, const char* text)
+{
+   ssize_t status = write (fd, text, strlen (text));
+   (void) status;
+}
+
+static void safeWriteInt (const int fd, const long value)
+{
+   char buffer [24];
+   char* p = buffer + sizeof (buffer);
+   *--p = '\0';
+   unsigned long n = value < 0 ? -(unsigned long) value : value;
+   do { *--p = char ('0' + n % 10); n /= 10; } while (n);
+   if (value < 0) *--p = '-';
+   safeWrite (fd, p);
+}
+
+//------------------------------------------------------------------------------
+// Async-signal-safe tests: processSafe is run in a child process, between
+// fork and (a would be) exec, with malloc armed to abort on any allocation.
+//
+static int group8 (const Parsley::Arguments& args, const int argc, char** argv)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      Parsley::enumSpec ("mode", 'm', "The mode option description.", enumChoice)->envVar("PARSLEY_ENUM"),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->intRange(-100, 100),
+      Parsley::realSpec ("real", 'r', "The real option description.")->defReal(31.6227),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+   static const char* const names [] = { "flag", "string", "mode", "number" };
+
+   // All the set up is done before the fork.
    //
-   int groupNumber;
-   if (!Parsley::str2int (argv[argc -1], groupNumber)) {
-      std::cerr << "parsley test invalid group number: " << argv[argc -1] <<  nl;
-      return 4;
+   Parsley parser (optionsSpec);
+   int slots [ARRAY_LENGTH (names)];
+   for (int j = 0; j < ARRAY_LENGTH (names); j++) {
+      slots[j] = parser.slotOf (names[j]);
    }
+   extern char** environ;
+   const char* const* envp = environ;
 
-   int status;
-   switch (groupNumber) {
+   // The group number is the last argument - exclude it.
+   //
+   const int safeArgc = argc - 1;
 
-      case 1:
-         status = group1 (args);
-         break;
+   int fds [2];
+   if (pipe (fds) != 0) return 2;
 
-      case 2:
-         status = group2 (args);
-         break;
+   std::cout.flush();
+   const pid_t pid = fork ();
+   if (pid < 0) return 2;
 
-      case 3:
-         status = group3 (args);
-         break;
+   if (pid == 0) {
+      mallocArmed = true;
 
-      case 4:
-         status = group4 (args);
+      Parsley::OptionView values [16];
+      const char* parameters [4];
+      Parsley::SafeResult result (values, ARRAY_LENGTH (values),
+                                  parameters, ARRAY_LENGTH (parameters));
+
+      const bool status = parser.processSafe (safeArgc, argv, envp, true, result);
+
+      const int fd = fds[1];
+      safeWrite (fd, "status: ");
+      safeWrite (fd, status ? "okay" : "failed");
+      safeWrite (fd, " error: ");
+      safeWrite (fd, Parsley::errorCodeName (result.error));
+      safeWrite (fd, " argument: ");
+      safeWriteInt (fd, result.errorArgument);
+      safeWrite (fd, " slot: ");
+      safeWriteInt (fd, result.errorSlot);
+      safeWrite (fd, "\n");
+
+      if (status) {
+         for (int j = 0; j < ARRAY_LENGTH (names); j++) {
+            const Parsley::OptionView& value = values[slots[j]];
+            safeWrite (fd, names[j]);
+            safeWrite (fd, value.isDefined ? " defined" : " not defined");
+            safeWrite (fd, " flag: ");
+            safeWrite (fd, FLAG (value.flag));
+            safeWrite (fd, " ival: ");
+            safeWriteInt (fd, value.ival);
+            safeWrite (fd, " str: '");
+            safeWrite (fd, value.str);
+            safeWrite (fd, "'\n");
+         }
+
+         safeWrite (fd, "params:");
+         for (size_t j = 0; j < result.parameterCount; j++) {
+            safeWrite (fd, " ");
+            safeWrite (fd, result.parameters[j]);
+         }
+         safeWrite (fd, "\n");
+      }
+      _exit (0);
+   }
+
+   close (fds[1]);
+   char buffer [1024];
+   ssize_t n;
+   while ((n = read (fds[0], buffer, sizeof (buffer))) > 0) {
+      std::cout.write (buffer, n);
+   }
+   close (fds[0]);
+
+   int wstatus = 0;
+   waitpid (pid, &wstatus, 0);
+   std::cout << "child: "
+             << (WIFEXITED (wstatus) && WEXITSTATUS (wstatus) == 0 ? "exited normally" :
+                 WIFSIGNALED (wstatus) && WTERMSIG (wstatus) == SIGABRT ? "aborted (allocation)" :
+                 "failed") << nl;
+
+   // And the normal process agrees on the error code.
+   //
+   parser.process (args, true);
+   std::cout << "process error: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Allocation failure tests: the parser's storage is a bounded arena, which
+// long arguments exhaust. This group is also run by parsley_test_noexcept,
+// i.e. built with exceptions disabled.
+//
+static int group9 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->intRange(-100, 100),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+#if defined(PARSLEY_EXCEPTIONS)
+   // Exhausted during construction - reported by process.
+   {
+      char tiny [256];
+      Parsley::MonotonicArena arena (tiny, sizeof (tiny), Parsley::nullResource());
+      Parsley parser (optionsSpec, arena);
+      const bool status = parser.process (args, true);
+      std::cout << "construction: " << (status ? "okay" : "failed")
+                << " error: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+   }
+#endif
+
+   // Size the arena so as to leave just 256 bytes for process.
+   //
+   size_t required;
+   {
+      Parsley::MonotonicArena probe;
+      Parsley parser (optionsSpec, probe);
+      required = probe.bytesAllocated() + 64;   // allow for alignment
+   }
+
+   static char buffer [16384];
+   Parsley::MonotonicArena arena (buffer, required + 256, Parsley::nullResource());
+   Parsley parser (optionsSpec, arena);
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed")
+             << " error: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+   } else {
+      std::cout << "string length: " << parser.options().view ("string").length
+                << " parameters: " << parser.parameterCount() << nl;
+   }
+
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Visitor tests: each value is printed as visited, and the parameter "stop"
+// stops processing. The arguments are visited in the argc/argv form.
+//
+class PrintVisitor : public Parsley::Visitor {
+public:
+   bool onFlag (const int slot)
+   {
+      std::cout << "flag   " << slot << nl;
+      return true;
+   }
+
+   bool onInt (const int slot, const Parsley::intp_t value)
+   {
+      std::cout << "int    " << slot << " " << value << nl;
+      return true;
+   }
+
+   bool onReal (const int slot, const double value)
+   {
+      std::cout << "real   " << slot << " " << value << nl;
+      return true;
+   }
+
+   bool onStr (const int slot, const char* str, const size_t length)
+   {
+      std::cout << "str    " << slot << " '" << str << "' " << length << nl;
+      return true;
+   }
+
+   bool onParameter (const char* str, const size_t length)
+   {
+      std::cout << "param  '" << str << "' " << length << nl;
+      return strcmp (str, "stop") != 0;
+   }
+};
+
+static int group10 (const int argc, char** argv)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->defStr("one"),
+      Parsley::enumSpec ("mode", 'm', "The mode option description.", enumChoice),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->
+                                        envVar("PARSLEY_INT")->intRange(-2000, 2000),
+      Parsley::realSpec ("real", 'r', "The real option description."),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+   PrintVisitor visitor;
+
+   const bool status = parser.visit (argc, argv, true, visitor);
+   std::cout << "visit: " << (status ? "okay" : "failed")
+             << " error: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Binding tests: options bound to the members of a configuration struct, and
+// to a variable. Values not given keep their default, or initial, value.
+//
+struct Config {
+   bool flag;
+   std::string str;
+   std::string mode;
+   Parsley::intp_t modeIndex;
+   Parsley::intp_t number;
+   double real;
+};
+
+struct Other {
+   bool on;
+};
+
+static int group11 (const Parsley::Arguments& args)
+{
+   static std::string name = "initial";
+
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description.")->bind (&Config::flag),
+      Parsley::strSpec  ("string", 's', "The string option description.")->
+                                        defStr("one")->bind (&Config::str),
+      Parsley::enumSpec ("mode", 'm', "The mode option description.", enumChoice)->
+                                        defStr("bbb")->bind (&Config::mode),
+      Parsley::enumSpec ("index", 'i', "The index option description.", enumChoice)->
+                                        envVar("PARSLEY_ENUM")->bind (&Config::modeIndex),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->
+                                        envVar("PARSLEY_INT")->bind (&Config::number),
+      Parsley::realSpec ("real", 'r', "The real option description.")->bind (&Config::real),
+      Parsley::strSpec  ("name", 'N', "The name option description.")->bind (&name),
+      Parsley::realSpec ("ignored", 'I', "The ignored option description.")->bind (&name),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+
+   // A struct of another type is rejected, as are options bound to the
+   // members of different struct types.
+   //
+   if (std::find (args.begin(), args.end(), "mismatch") != args.end()) {
+      Other other;
+      other.on = false;
+      const bool status = parser.process (args, true, other);
+      std::cout << "status: " << (status ? "okay" : "failed") << nl;
+      std::cout << "message: " << parser.errorMessage() << nl;
+      std::cout << "on:        " << FLAG(other.on) << nl;
+
+      Parsley mixed ({
+         Parsley::flagSpec ("flag", 'f', "The flag option description.")->bind (&Config::flag),
+         Parsley::flagSpec ("on", 'o', "The on option description.")->bind (&Other::on)
+      });
+      Config config;
+      const bool mixedStatus = mixed.process (args, true, config);
+      std::cout << "mixed: " << (mixedStatus ? "okay" : "failed") << nl;
+      std::cout << "message: " << mixed.errorMessage() << nl;
+      return 0;
+   }
+
+   Config config;
+   config.flag = true;
+   config.number = 7;
+   config.modeIndex = -1;
+   config.real = 1.5;
+
+   const bool status = parser.process (args, true, config);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+   }
+
+   std::cout << "flag:      " << FLAG(config.flag) << nl
+             << "str:       '" << config.str << "'" << nl
+             << "mode:      '" << config.mode << "'" << nl
+             << "modeIndex: " << config.modeIndex << nl
+             << "number:    " << config.number << nl
+             << "real:      " << config.real << nl
+             << "name:      '" << name << "'" << nl;
+
+   // Bound values are not held by the parser.
+   //
+   const Parsley::OptionValues options = parser.options();
+   dump (options, "number");
+   dump (options, "ignored");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// A user defined option type, see Parsley::customSpec.
+//
+struct Endpoint {
+   unsigned char address [4];
+   unsigned short port;
+};
+
+template <> struct Parsley::Converter<Endpoint> {
+   static const char* name () { return "endpoint"; }
+
+   // Of the form a.b.c.d:port
+   //
+   static bool parse (const char* str, const size_t length, Endpoint& value)
+   {
+      size_t j = 0;
+      for (int part = 0; part < 5; part++) {
+         const char separator = (part < 3) ? '.' : ':';
+         const unsigned long limit = (part < 4) ? 255 : 65535;
+         unsigned long number = 0;
+         const size_t start = j;
+         while ((j < length) && (str[j] >= '0') && (str[j] <= '9') && (j - start < 5)) {
+            number = 10 * number + (str[j++] - '0');
+         }
+         if ((j == start) || (number > limit)) return false;
+         if (part < 4) {
+            if ((j >= length) || (str[j] != separator)) return false;
+            value.address[part] = (unsigned char) number;
+            j++;
+         } else {
+            value.port = (unsigned short) number;
+         }
+      }
+      return j == length;
+   }
+
+   static std::string format (const Endpoint& value)
+   {
+      return std::to_string (value.address[0]) + "." + std::to_string (value.address[1]) + "." +
+             std::to_string (value.address[2]) + "." + std::to_string (value.address[3]) + ":" +
+             std::to_string (value.port);
+   }
+
+   // Port 0 is reserved.
+   //
+   static bool validate (const Endpoint& value) { return value.port != 0; }
+};
+
+static int group12 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::customSpec<Endpoint> ("listen", 'l', "The listen endpoint description.")->
+                                        defStr ("127.0.0.1:8080"),
+      Parsley::customSpec<Endpoint> ("peer", 'p', "The peer endpoint description.")->
+                                        envVar ("PARSLEY_ENDPOINT"),
+      Parsley::customSpec<Endpoint> ("backup", 'b', "The backup endpoint description.")->
+                                        defCustom (Endpoint { { 10, 0, 0, 2 }, 22 }),
+      Parsley::customSpec<Endpoint> ("relay", 'R', "The relay endpoint description."),
+      Parsley::customSpec<Endpoint> ("broken", 'B', "The broken endpoint description.")->
+                                        defStr ("1.2.3:4"),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   static const char* const names [] = { "listen", "peer", "backup", "relay" };
+   for (int j = 0; j < ARRAY_LENGTH (names); j++) {
+      const Parsley::OptionView view = options.view (names[j]);
+      std::cout << std::left << std::setw (8) << names[j] << std::right
+                << (view.isDefined ? "defined  " : "undefined") << "  '" << view.str << "'  "
+                << Parsley::Converter<Endpoint>::format (options.custom<Endpoint> (names[j]))
+                << nl;
+   }
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Shell completion scripts.
+//
+static int group13 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::strSpec  ("output", 'o', "The output file [name]: where it's written.")->
+                                        fileValue (),
+      Parsley::strSpec  ("string", 's', "The string option description."),
+      Parsley::enumSpec ("mode", 'm', "!The mode option\ndescription.", enumChoice),
+      Parsley::intSpec  ("number", '\0', "The number option description.")->fileValue (),
+      Parsley::enumSpec ("colour", 'c', "The colour option description.", { "red", "green", "blue" })->
+                                        dynamicValues (),
+      Parsley::strSpec  ("mapping", 'M', "The mapping option description."),
+      Parsley::completion (),  // pre-defined singleton
+      Parsley::version(),      // pre-defined singleton
+      Parsley::help ()         // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+
+   // Exclude the test group number from the words.
+   //
+   if (parser.completionQuery (Parsley::Arguments (args.begin(), args.end() - 1), true,
+                               std::cout)) {
+      std::cout << "(query)" << nl;
+      return 0;
+   }
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   if (options["completion"].isDefined) {
+      parser.completionScript (std::cout, Parsley::Shell (options["completion"].ival),
+                               "parsley-test");
+      return 0;
+   }
+
+   dump (options, "output");
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Option groups, as might be contributed by libraries.
+//
+static const Parsley::OptionGroupPointer& loggingOptions ()
+{
+   static const Parsley::OptionGroupPointer group = Parsley::optionGroup ("Logging options", {
+      Parsley::enumSpec ("log-level", 'l', "The log level description.",
+                         { "error", "warning", "info", "debug" })->defStr ("info"),
+      Parsley::strSpec  ("log-file", 'L', "The log file description.")->fileValue ()
+   });
+   return group;
+}
+
+static const Parsley::OptionGroupPointer& metricsOptions ()
+{
+   static const Parsley::OptionGroupPointer group = Parsley::optionGroup ("Metrics options", {
+      Parsley::flagSpec ("metrics", 'M', "The metrics option description."),
+      Parsley::intSpec  ("metrics-port", '\0', "The metrics port description.")->
+                                        intRange (1, 65535)->defInt (9100)
+   });
+   return group;
+}
+
+static int group14 (const Parsley::Arguments& args)
+{
+   const Parsley::OptionGroupPointer mainOptions = Parsley::optionGroup ("Options", {
+      Parsley::flagSpec ("flag", 'f',  "The flag option description."),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   });
+
+   // Names that conflict with those of other groups, and within the group.
+   //
+   const Parsley::OptionGroupPointer conflicting = Parsley::optionGroup ("Conflicting options", {
+      Parsley::strSpec  ("log-file", 'x', "The conflicting long name."),
+      Parsley::flagSpec ("fast", 'f', "The conflicting short name."),
+      Parsley::flagSpec ("fast", 'F', "The conflicting name within the group.")
+   });
+   std::cout << "groups: " << mainOptions->size() << " " << loggingOptions()->size() << " "
+             << metricsOptions()->size() << " " << (conflicting->isOkay() ? "okay" : "not okay")
+             << nl;
+
+   Parsley::OptionGroups groups = { mainOptions, loggingOptions(), metricsOptions() };
+   if (std::find (args.begin(), args.end(), "conflict") != args.end()) {
+      groups.push_back (conflicting);
+   }
+   if (std::find (args.begin(), args.end(), "single") != args.end()) {
+      groups = { loggingOptions() };
+   }
+
+   Parsley parser (groups);
+
+   if (parser.completionQuery (Parsley::Arguments (args.begin(), args.end() - 1), true,
+                               std::cout)) {
+      std::cout << "(query)" << nl;
+      return 0;
+   }
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "flag");
+   dump (options, "log-level");
+   dump (options, "log-file");
+   dump (options, "metrics");
+   dump (options, "metrics-port");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Constraints between options.
+//
+static int group15 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::strSpec  ("output", 'o', "The output option description."),
+      Parsley::enumSpec ("format", 'F', "The format option description.",
+                         { "json", "text" }),
+      Parsley::intSpec  ("level", 'l', "The level option description.")->defInt (3),
+      Parsley::flagSpec ("tcp", 't', "The tcp option description.")->envVar ("PARSLEY_TCP"),
+      Parsley::strSpec  ("unix", 'u', "The unix option description.")->envVar ("PARSLEY_UNIX"),
+      Parsley::flagSpec ("red", 'r', "The red option description."),
+      Parsley::flagSpec ("green", 'g', "The green option description."),
+      Parsley::flagSpec ("blue", 'b', "The blue option description."),
+      Parsley::flagSpec ("xxx", 'x', "The xxx option description."),
+      Parsley::flagSpec ("yyy", 'y', "The yyy option description."),
+      Parsley::version(),  // pre-defined singleton
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+   parser.setConstraints ({
+      Parsley::dependsOn ("output", { "format", "level" }),
+      Parsley::conflicting ({ "tcp", "unix" }),
+      Parsley::exactlyOneOf ({ "red", "green", "blue" }),
+      Parsley::atLeastOneOf ({ "xxx", "yyy" })
+   });
+
+   // An unknown option name is a specification error.
+   //
+   if (std::find (args.begin(), args.end(), "unknown") != args.end()) {
+      parser.setConstraints ({ Parsley::conflicting ({ "tcp", "nowhere" }) });
+   }
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "code: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+      std::cout << "message: " << parser.errorMessage() << nl;
+      for (const Parsley::Violation& violation : parser.violations()) {
+         std::cout << "violation: " << violation.constraint->kind() << " "
+                   << Parsley::join (violation.constraint->options()) << " : "
+                   << violation.message << nl;
+      }
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Required options either side of 70 filler flags, so that the required and
+// defined bit sets span two words. Missing options are reported in spec order.
+//
+static int group16 (const Parsley::Arguments& args)
+{
+   Parsley::OptionSpecifications optionsSpec = {
+      Parsley::strSpec  ("first", 'a', "The first option description.", true),
+      Parsley::intSpec  ("middle", 'm', "The middle option description.", true)->defInt (7)
+   };
+   for (int j = 0; j < 70; j++) {
+      char name [8];
+      snprintf (name, sizeof (name), "f%02d", j);
+      optionsSpec.push_back (Parsley::flagSpec (name, '\0',
+                                                "A filler flag."));
+   }
+   optionsSpec.push_back (Parsley::intSpec ("last", 'z', "The last option description.", true));
+   optionsSpec.push_back (Parsley::help ());
+
+   Parsley parser (optionsSpec);
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "code: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   dump (options, "first");
+   dump (options, "middle");
+   dump (options, "f69");
+   dump (options, "last");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Environment variables mapped from the option names by the PARSLEY_APP_ prefix.
+//
+static int group17 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::strSpec  ("foo-bar", 'f', "The foo-bar option description."),
+      Parsley::intSpec  ("count", 'c', "The count option description.")->defInt (1),
+      Parsley::flagSpec ("verbose", 'v', "The verbose option description."),
+      Parsley::strSpec  ("mode", 'm', "The mode option description.")->envVar ("PARSLEY_APP_MODE_X"),
+      Parsley::enumSpec ("colour", 'C', "The colour option description.",
+                         { "red", "green" }),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+   parser.envPrefix ("PARSLEY_APP_");
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   for (const std::string& warning : parser.warnings()) {
+      std::cout << "warning: " << warning << nl;
+   }
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "foo-bar");
+   dump (options, "count");
+   dump (options, "verbose");
+   dump (options, "mode");
+   dump (options, "colour");
+
+   // The same by processSafe, given the environment.
+   //
+   extern char** environ;
+   std::vector<const char*> argv;
+   for (const std::string& arg : args) argv.push_back (arg.c_str());
+   Parsley::OptionView values [8];
+   const char* parameters [4];
+   Parsley::SafeResult result (values, ARRAY_LENGTH (values),
+                               parameters, ARRAY_LENGTH (parameters));
+   const bool safeStatus = parser.processSafe (int (argv.size()), argv.data(),
+                                               environ, true, result);
+   std::cout << "safe status: " << (safeStatus ? "okay" : "failed")
+             << " foo-bar: '" << (values[0].str ? values[0].str : "") << "'"
+             << " count: " << values[1].ival << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Aliases, deprecated names and negatable flags.
+//
+static int group18 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::strSpec  ("colour", 'c', "The colour option description.")->
+                                         alias ("color")->deprecated ("tint"),
+      Parsley::flagSpec ("cache", 'k', "The cache option description.")->
+                                         defFlag (true)->negatable (),
+      Parsley::flagSpec ("verbose", 'v', "The verbose option description.")->
+                                         negatable ()->alias ("loud"),
+      Parsley::intSpec  ("jobs", 'j', "The jobs option description.")->
+                                         defInt (1)->deprecated ("threads")->deprecated ("workers"),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   // An alias may not be another option's name.
+   //
+   Parsley::OptionSpecifications specs = optionsSpec;
+   if (std::find (args.begin(), args.end(), "conflict") != args.end()) {
+      specs.push_back (Parsley::flagSpec ("quiet", 'q', "The quiet option.")->alias ("jobs"));
+   }
+
+   Parsley parser (specs);
+
+   // A negated flag is not defined, so does not conflict.
+   //
+   parser.setConstraints ({ Parsley::conflicting ({ "verbose", "cache" }) });
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   for (const std::string& warning : parser.warnings()) {
+      std::cout << "warning: " << warning << nl;
+   }
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "colour");
+   dump (options, "cache");
+   dump (options, "verbose");
+   dump (options, "jobs");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Profiles.
+//
+static const Parsley::EnumOptions levelChoice = {
+   "error", "warn", "info", "debug"
+};
+
+static int group19 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::intSpec  ("batch", 'b', "The batch option description.")->
+                                         defInt (64)->intRange (1, 1024),
+      Parsley::flagSpec ("poll", 'p', "The poll option description."),
+      Parsley::flagSpec ("nagle", 'n', "The nagle option description.")->
+                                         defFlag (true)->negatable (),
+      Parsley::enumSpec ("level", 'l', "The level option description.",
+                         levelChoice)->defStr ("warn"),
+      Parsley::realSpec ("timeout", 't', "The timeout option description.")->defReal (30.0),
+      Parsley::strSpec  ("log", 'L', "The log option description.")->defStr ("-"),
+      Parsley::profileOption (),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   Parsley parser (optionsSpec);
+
+   Parsley::Profiles profiles = {
+      Parsley::profile ("low-latency", "Favour latency over throughput.",
+                        { { "batch", "1" }, { "poll", "" }, { "nagle", "off" },
+                          { "timeout", "0.5" } }),
+      Parsley::profile ("debug", "Verbose logging to a file.",
+                        { { "level", "debug" }, { "log", "debug.log" }, { "batch", "8" },
+                          { "poll", "off" } })
+   };
+
+   // A setting's option must exist and its value must be valid.
+   //
+   if (std::find (args.begin(), args.end(), "invalid") != args.end()) {
+      profiles.push_back (Parsley::profile ("broken", "Not usable.",
+                                            { { "batch", "0" }, { "colour", "red" } }));
+   }
+   parser.setProfiles (profiles);
+
+   // A flag a profile turns off is not defined, so does not conflict.
+   //
+   parser.setConstraints ({ Parsley::conflicting ({ "nagle", "poll" }) });
+
+   // A visitor is given the profiles' values by way of its usual functions.
+   //
+   if (std::find (args.begin(), args.end(), "visit") != args.end()) {
+      PrintVisitor visitor;
+      const bool status = parser.visit (args, true, visitor);
+      std::cout << "visit: " << (status ? "okay" : "failed") << nl;
+      return 0;
+   }
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "batch");
+   dump (options, "poll");
+   dump (options, "nagle");
+   dump (options, "level");
+   dump (options, "timeout");
+   dump (options, "log");
+   dump (options, "profile");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Pattern constrained strings.
+//
+static int group20 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::strSpec  ("host", 'H', "The host option description.")->
+            pattern ("[a-z0-9]([a-z0-9-]{0,61}[a-z0-9])?(\\.[a-z0-9]([a-z0-9-]{0,61}[a-z0-9])?)*")->
+            defStr ("localhost"),
+      Parsley::strSpec  ("name", 'n', "The name option description.")->
+            pattern ("[A-Za-z_]\\w*")->defStr ("x"),
+      Parsley::strSpec  ("pair", 'p', "The pair option description.")->
+            pattern ("[^:]+:[^:]+")->defStr ("key:value"),
+      Parsley::strSpec  ("file", 'f', "The file option description.")->
+            pattern (".*\\.(txt|csv)")->defStr ("data.csv"),
+      Parsley::strSpec  ("code", 'c', "The code option description.")->
+            pattern ("[A-Z]{2}-\\d{3,4}")->defStr ("AB-123"),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   // An invalid pattern is ignored, a non matching default is reported.
+   //
+   Parsley::OptionSpecifications specs = optionsSpec;
+   if (std::find (args.begin(), args.end(), "invalid") != args.end()) {
+      specs.push_back (Parsley::strSpec ("bad", 'b', "The bad option.")->pattern ("a(b|c"));
+      specs.push_back (Parsley::strSpec ("odd", 'o', "The odd option.")->
+                                         defStr ("x")->pattern ("[0-9]+"));
+      specs.push_back (Parsley::intSpec ("num", 'N', "The num option.")->pattern ("[0-9]+"));
+   }
+
+   Parsley parser (specs);
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      std::cout << "code: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "host");
+   dump (options, "name");
+   dump (options, "pair");
+   dump (options, "file");
+   dump (options, "code");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+//
+static int group21 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::pathSpec ("input", 'i', "The input option description.")->
+            checkPath (Parsley::kPathExists | Parsley::kPathIsFile | Parsley::kPathReadable),
+      Parsley::pathSpec ("dir", 'd', "The dir option description.")->
+            checkPath (Parsley::kPathIsDirectory),
+      Parsley::pathSpec ("output", 'o', "The output option description.")->
+            checkPath (Parsley::kPathWritable)->minFreeSpace (1),
+      Parsley::pathSpec ("spool", 's', "The spool option description.")->
+            minFreeSpace (uint64_t (1) << 62),
+      Parsley::flagSpec ("params", 'P', "Check the parameters may be written."),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   // Checks for other than a path, and conflicting checks, are ignored.
+   //
+   Parsley::OptionSpecifications specs = optionsSpec;
+   if (std::find (args.begin(), args.end(), "invalid") != args.end()) {
+      specs.push_back (Parsley::strSpec ("name", 'n', "The name option.")->
+                       checkPath (Parsley::kPathExists));
+      specs.push_back (Parsley::pathSpec ("both", 'b', "The both option.")->
+                       checkPath (Parsley::kPathIsFile)->checkPath (Parsley::kPathIsDirectory));
+   }
+
+   // A default path that does not exist - only reported unless a singleton
+   // such as --help is given.
+   //
+   if (std::find (args.begin(), args.end(), "missing") != args.end()) {
+      specs.push_back (Parsley::pathSpec ("config", 'c', "The config option description.")->
+                       defStr ("/nonexistent/config")->checkPath (Parsley::kPathExists));
+   }
+
+   Parsley parser (specs);
+   if (std::find (args.begin(), args.end(), "--params") != args.end()) {
+      parser.setParameterChecks (Parsley::kPathWritable, 1);
+   } else if (std::find (args.begin(), args.end(), "missing") != args.end()) {
+      parser.setParameterChecks (Parsley::kPathExists);
+   }
+   parser.setPathCheckThreads (4);
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      std::cout << "code: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+      for (const Parsley::PathFailure& failure : parser.pathFailures()) {
+         std::cout << "failure: " << failure.option << " " << failure.path << nl;
+      }
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "input");
+   dump (options, "dir");
+   dump (options, "output");
+   dump (options, "spool");
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+//
+static int group22 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::pathSpec ("input", 'i', "The input option description.")->glob (),
+      Parsley::pathSpec ("output", 'o', "The output option description.")->
+            glob ()->checkPath (Parsley::kPathIsFile),
+      Parsley::flagSpec ("expand", 'e', "Expand the parameters."),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   // Glob for other than a path is ignored.
+   //
+   Parsley::OptionSpecifications specs = optionsSpec;
+   if (std::find (args.begin(), args.end(), "invalid") != args.end()) {
+      specs.push_back (Parsley::strSpec ("name", 'n', "The name option.")->glob ());
+   }
+
+   Parsley parser (specs);
+   if (std::find (args.begin(), args.end(), "--expand") != args.end()) {
+      parser.setGlobParameters (true);
+   }
+
+   const bool status = parser.process (args, true);
+   std::cout << "status: " << (status ? "okay" : "failed") << nl;
+   if (!status) {
+      std::cout << "message: " << parser.errorMessage() << nl;
+      std::cout << "code: " << Parsley::errorCodeName (parser.errorCode()) << nl;
+      return 0;
+   }
+
+   const Parsley::OptionValues options = parser.options();
+   if (options["help"].flag) {
+      parser.optionHelp (std::cout);
+      return 0;
+   }
+
+   dump (options, "input");
+   for (const char* path : parser.matches ("input")) {
+      std::cout << "match: " << path << nl;
+   }
+   std::cout << "parameters: " << Parsley::join (parser.parameters()) << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// Prints each command's values, or its help.
+//
+class EchoHandler : public Parsley::Interpreter::Handler {
+public:
+   explicit EchoHandler (const std::vector<std::string>& names, const bool quiet = false) :
+      m_names (names), m_quiet (quiet) { }
+
+   bool onCommand (const char* verb, Parsley& parser, const Parsley::OptionValues& options)
+   {
+      if (this->m_quiet) return true;
+      std::cout << "command: " << verb << nl;
+      if (options.view ("help").flag) {
+         parser.optionHelp (std::cout);
+         return true;
+      }
+      for (const std::string& name : this->m_names) dump (options, name);
+      std::cout << "parameters:";
+      for (size_t j = 0; j < parser.parameterCount(); j++) {
+         std::cout << " '" << parser.parameter (j) << "'";
+      }
+      std::cout << nl;
+      return std::string (verb) != "fail";
+   }
+
+private:
+   const std::vector<std::string> m_names;
+   const bool m_quiet;
+};
+
+//------------------------------------------------------------------------------
+//
+static int group23 (const Parsley::Arguments& args)
+{
+   const Parsley::OptionSpecifications setSpec = {
+      Parsley::strSpec  ("key", 'k', "The key option description.", true),
+      Parsley::strSpec  ("value", 'v', "The value option description."),
+      Parsley::intSpec  ("ttl", 't', "The ttl option description.")->intRange (0, 3600),
+      Parsley::help ()
+   };
+   const Parsley::OptionSpecifications getSpec = {
+      Parsley::strSpec  ("key", 'k', "The key option description.", true),
+      Parsley::flagSpec ("json", 'j', "The json option description.")
+   };
+
+   const bool quiet = (args.size() > 1) && (args[1] == "steady");
+   EchoHandler setHandler ({ "key", "value", "ttl" }, quiet);
+   EchoHandler getHandler ({ "key", "json" }, quiet);
+   EchoHandler failHandler ({ }, quiet);
+
+   Parsley::Interpreter interpreter;
+   interpreter.addVerb ("set", setSpec, setHandler, "Sets a key's value.");
+   interpreter.addVerb ("get", getSpec, getHandler, "Gets a key's value.");
+   interpreter.addVerb ("fail", { }, failHandler, "Always fails.");
+   interpreter.addVerb ("get", getSpec, getHandler);     // duplicate
+   interpreter.addVerb ("bad verb", getSpec, getHandler);
+
+   if (args.size() < 3) {
+      interpreter.commandHelp (std::cout);
+      return 0;
+   }
+
+   // Runs a script repeatedly, the first time to warm up.
+   //
+   if (quiet) {
+      const std::string script = "set --key alpha --value 'one two' --ttl 60\n"
+                                 "# a comment\n"
+                                 "\n"
+                                 "get -k alpha -j\n"
+                                 "set -k beta -v \"say \\\"hi\\\"\" extra\n";
+      std::istringstream warm (script);
+      std::cout << "failures: " << interpreter.run (warm, std::cout) << nl;
+
+      Parsley::resetAllocationStats ();
+      size_t failures = 0;
+      for (int j = 0; j < 10; j++) {
+         std::istringstream input (script);
+         failures += interpreter.run (input, std::cout);
+      }
+      const Parsley::AllocationStats stats = Parsley::allocationStats();
+      std::cout << "steady state failures: " << failures
+                << " allocations: " << stats.allocations << nl;
+      return 0;
+   }
+
+   std::string line = args[1];
+   const bool status = interpreter.execute (&line[0]);
+   std::cout << "status: " << (status ? "okay" : "failed")
+             << " outcome: " << int (interpreter.outcome()) << nl;
+   if (!status) {
+      std::cout << "message: " << interpreter.errorMessage() << nl;
+   }
+   return 0;
+}
+
+// Like group 2 but with both program defined and environment variable
+// defined defaults
+
+
+
+//------------------------------------------------------------------------------
+// Run with PARSLEY_RECORD_FILE set to the (initially absent) corpus file name.
+//
+static int group24 (const Parsley::Arguments& args)
+{
+   static const Parsley::OptionSpecifications optionsSpec = {
+      Parsley::flagSpec ("flag",   'f', "The flag option description."),
+      Parsley::strSpec  ("string", 's', "The string option description.")->
+                                        envVar ("PARSLEY_REPLAY_STR"),
+      Parsley::intSpec  ("number", 'n', "The number option description.")->intRange (0, 99),
+      Parsley::help ()     // pre-defined singleton
+   };
+
+   const char* corpusFile = getenv ("PARSLEY_RECORD_FILE");
+   if (!corpusFile) {
+      std::cout << "PARSLEY_RECORD_FILE not set" << nl;
+      return 1;
+   }
+
+   // Record a few invocations, including one that fails, the first with the
+   // environment variable set.
+   //
+   const Parsley::Arguments recorded [] = {
+      { "-f", "xxx" },
+      { "--string", "a b\nc", "--number", "42" },
+      { "--number", "420" },
+      { "--", "-f", "" }
+   };
+
+   Parsley recorder (optionsSpec);
+   setenv ("PARSLEY_REPLAY_STR", "from env", 1);
+   for (const Parsley::Arguments& arguments : recorded) {
+      recorder.process (arguments, false);
+      unsetenv ("PARSLEY_REPLAY_STR");
+   }
+
+   Parsley::Invocations corpus;
+   bool status = Parsley::readCorpus (corpusFile, corpus);
+   std::cout << "read: " << (status ? "okay" : "failed") << " " << corpus.size() << nl;
+   for (const Parsley::Invocation& invocation : corpus) {
+      std::cout << "tool: " << invocation.tool
+                << " skip: " << (invocation.skipProgramName ? "yes" : "no")
+                << " arguments:";
+      for (const std::string& arg : invocation.arguments) std::cout << " '" << arg << "'";
+      for (const Parsley::Invocation::EnvironmentValue& ev : invocation.environment) {
+         std::cout << " env: " << ev.name << (ev.isDefined ? "='" + ev.value + "'" : " unset");
+      }
+      std::cout << nl;
+   }
+
+   // Replay with a new parser, plus an invocation by another tool, and check
+   // the outcomes are those of the recording parser.
+   //
+   Parsley::Invocation other;
+   other.tool = "other";
+   corpus.push_back (other);
+
+   // The caller's environment is restored.
+   //
+   setenv ("PARSLEY_REPLAY_STR", "caller", 1);
+
+   Parsley parser (optionsSpec);
+   Parsley::ReplayResult result;
+   status = parser.replay (corpus, "parsley_test", 3, result);
+   std::cout << "replay: " << (status ? "okay" : "failed")
+             << " replayed: " << result.replayed << " skipped: " << result.skipped
+             << " failed: " << result.failed << nl;
+   std::cout << "environment: " << getenv ("PARSLEY_REPLAY_STR") << nl;
+   unsetenv ("PARSLEY_REPLAY_STR");
+
+   Parsley::ReplayResult again;
+   recorder.replay (corpus, "", 1, again);
+   for (size_t j = 0; j < corpus.size(); j++) {
+      std::cout << "invocation " << j << ": "
+                << (result.digests[j] == 0 ? "skipped" :
+                    result.digests[j] == again.digests[j] ? "same" : "different") << nl;
+   }
+
+   // A truncated corpus is reported, as is a missing one.
+   //
+   const std::string truncated = std::string (corpusFile) + ".truncated";
+   FILE* in = fopen (corpusFile, "rb");
+   FILE* out = fopen (truncated.c_str(), "wb");
+   if (in && out) {
+      char buffer [4096];
+      const size_t n = fread (buffer, 1, sizeof (buffer), in);
+      fwrite (buffer, 1, n > 10 ? n - 10 : 0, out);
+   }
+   if (in) fclose (in);
+   if (out) fclose (out);
+
+   Parsley::Invocations partial;
+   status = Parsley::readCorpus (truncated, partial);
+   std::cout << "truncated: " << (status ? "okay" : "failed") << " " << partial.size() << nl;
+   remove (truncated.c_str());
+
+   status = Parsley::readCorpus ("/nonexistent/corpus", partial);
+   std::cout << "missing: " << (status ? "okay" : "failed") << nl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+//
+int main (int argc, char** argv)
+{
+   std::cout << "parsley test: ";
+
+   Parsley::Arguments args = Parsley::formArguments (argc, argv);
+   std::cout << Parsley::join (args) << nl;
+
+   // We use the last parameter to select which option specification
+   // group we are interested in.
+   //
+   int groupNumber;
+   if (!Parsley::str2int (argv[argc -1], groupNumber)) {
+      std::cerr << "parsley test invalid group number: " << argv[argc -1] <<  nl;
+      return 4;
+   }
+
+   int status;
+   switch (groupNumber) {
+
+      case 1:
+         status = group1 (args);
+         break;
+
+      case 2:
+         status = group2 (args);
+         break;
+
+      case 3:
+         status = group3 (args);
+         break;
+
+      case 4:
+         status = group4 (args);
+         break;
+
+      case 5:
+         status = group5 (args);
+         break;
+
+      case 6:
+         status = group6 (args);
+         break;
+
+      case 7:
+         status = group7 (args);
+         break;
+
+      case 8:
+         status = group8 (Parsley::Arguments (args.begin(), args.end() - 1), argc, argv);
+         break;
+
+      case 9:
+         status = group9 (args);
+         break;
+
+      case 10:
+         status = group10 (argc - 1, argv);
+         break;
+
+      case 11:
+         status = group11 (args);
+         break;
+
+      case 12:
+         status = group12 (args);
+         break;
+
+      case 13:
+         status = group13 (args);
+         break;
+
+      case 14:
+         status = group14 (args);
+         break;
+
+      case 15:
+         status = group15 (args);
+         break;
+
+      case 16:
+         status = group16 (args);
+         break;
+
+      case 17:
+         status = group17 (args);
+         break;
+
+      case 18:
+         status = group18 (args);
+         break;
+
+      case 19:
+         status = group19 (args);
+         break;
+
+      case 20:
+         status = group20 (args);
+         break;
+
+      case 21:
+         status = group21 (args);
+         break;
+
+      case 22:
+         status = group22 (args);
+         break;
+
+      case 23:
+         status = group23 (args);
+         break;
+
+      case 24:
+         status = group24 (args);
          break;
 
       default: